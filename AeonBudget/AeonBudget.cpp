@@ -0,0 +1,467 @@
+
+// AeonBudget - check an exported Aeon profile (see Inc/Export.h) against a performance budget and/or a baseline profile.
+//
+// Usage: AeonBudget <profile> [-budget <budget file>] [-baseline <baseline profile>] [-tolerance <percent>] [-mintime <microseconds>] [-phase <phase name>]
+//
+// The budget file has one limit per line ('#' starts a comment):
+//
+//    <metric>,<limit>,"<function symbol name>"
+//
+// where <metric> is 'avg' (average inclusive time in microseconds), 'pNN' (the NN'th percentile of the inclusive time in
+// microseconds, for example 'p99') or 'calls' (number of times called).  Functions are matched by symbol name (so that the budget
+// still applies after the code has been rebuilt) and their data is summed over all of the threads (and all of the phases unless
+// -phase is given).
+//
+// With -baseline, the average and 99th percentile inclusive time of every function in both profiles are compared and any that got
+// slower by more than the tolerance (the default is 10 percent) are reported.  Functions faster than -mintime (the default is 10
+// microseconds) in the baseline are ignored since their times are mostly noise.
+//
+// The exit code is 0 if everything is within budget, 1 if there were any violations and 2 if there was an error (so that this can
+// be used to fail a nightly build).
+
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "IntervalStats.h"
+
+#define MIN_EXPORT_FILE_VERSION 2  /* the first version with module offsets on the Function lines (so the symbol name is the 10th field) */
+#define DURATIONS_EXPORT_FILE_VERSION 7  /* the first version with the Durations lines (needed for the percentiles) */
+#define MAX_LINE_LENGTH 65536
+
+#define EXIT_PASSED 0
+#define EXIT_VIOLATIONS 1
+#define EXIT_ERROR 2
+
+struct FunctionStats_t  // one function's data summed over all threads (and phases)
+{
+	__int64 CallCount;
+	__int64 InclusiveTimeSum;  // in 100ns units
+	unsigned int DurationHistogram[INTERVAL_HISTOGRAM_BUCKETS];
+	bool bHasDurations;
+
+	FunctionStats_t() : CallCount(0), InclusiveTimeSum(0), bHasDurations(false)
+	{
+		memset(DurationHistogram, 0, sizeof(DurationHistogram));
+	}
+
+	double GetAverageMicroseconds() const
+	{
+		return (CallCount > 0) ? ((double)InclusiveTimeSum / (double)CallCount / 10.0) : 0.0;
+	}
+
+	double GetPercentileMicroseconds(float InPercentile) const
+	{
+		return (double)GetHistogramPercentile(DurationHistogram, InPercentile) / 10.0;
+	}
+};
+
+typedef std::map<std::string, FunctionStats_t> ProfileMap_t;  // keyed by symbol name
+
+struct BudgetEntry_t
+{
+	std::string SymbolName;
+	std::string Metric;  // (as written in the budget file, for the report)
+	float Percentile;  // 0 for 'avg' and 'calls'
+	bool bIsCalls;
+	double Limit;
+	int LineNumber;
+};
+
+
+static void SplitFields(char* InLine, std::vector<std::string>& OutFields)  // split a CSV line (fields in double quotes can contain commas and doubled up double quotes)
+{
+	OutFields.clear();
+
+	char* p = InLine;
+
+	while( true )
+	{
+		std::string Field;
+
+		if( *p == '"' )
+		{
+			p++;
+			while( *p )
+			{
+				if( *p == '"' )
+				{
+					if( *(p + 1) == '"' )
+					{
+						Field += '"';
+						p += 2;
+						continue;
+					}
+
+					p++;
+					break;
+				}
+
+				Field += *p++;
+			}
+		}
+
+		while( *p && (*p != ',') && (*p != '\n') && (*p != '\r') )
+		{
+			Field += *p++;
+		}
+
+		OutFields.push_back(Field);
+
+		if( *p != ',' )
+		{
+			break;
+		}
+
+		p++;
+	}
+}
+
+static bool ReadProfile(const char* InFilename, const char* InPhaseName, ProfileMap_t& OutProfile)
+{
+	FILE* fp = nullptr;
+	if( fopen_s(&fp, InFilename, "r") != 0 )
+	{
+		fprintf(stderr, "Can't open profile '%s'\n", InFilename);
+		return false;
+	}
+
+	static char Line[MAX_LINE_LENGTH];
+	std::vector<std::string> Fields;
+
+	int Version = 0;
+	bool bIsInPhase = (InPhaseName == nullptr);
+	FunctionStats_t* CurrentFunction = nullptr;  // the function from the last Function line (the Durations line that follows it goes with it)
+
+	while( fgets(Line, sizeof(Line), fp) )
+	{
+		SplitFields(Line, Fields);
+
+		if( Fields[0] == "AeonProfile" )
+		{
+			Version = (Fields.size() > 1) ? atoi(Fields[1].c_str()) : 0;
+		}
+		else if( Fields[0] == "Phase" )
+		{
+			bIsInPhase = (InPhaseName == nullptr) || ((Fields.size() > 2) && (Fields[2] == InPhaseName));
+			CurrentFunction = nullptr;
+		}
+		else if( Fields[0] == "Function" )
+		{
+			CurrentFunction = nullptr;
+
+			// Function,<address>,<module index>,<module offset>,<call count>,<exclusive time sum>,<inclusive time sum>,<max exclusive time>,<max recursion>,"<symbol name>"
+			if( bIsInPhase && (Fields.size() >= 10) )
+			{
+				FunctionStats_t& Function = OutProfile[Fields[9]];
+
+				Function.CallCount += _atoi64(Fields[4].c_str());
+				Function.InclusiveTimeSum += _atoi64(Fields[6].c_str());
+
+				CurrentFunction = &Function;
+			}
+		}
+		else if( Fields[0] == "Durations" )
+		{
+			if( CurrentFunction && (Fields.size() > INTERVAL_HISTOGRAM_BUCKETS) )
+			{
+				for( int Bucket = 0; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+				{
+					CurrentFunction->DurationHistogram[Bucket] += (unsigned int)strtoul(Fields[Bucket + 1].c_str(), nullptr, 10);
+				}
+
+				CurrentFunction->bHasDurations = true;
+			}
+		}
+	}
+
+	fclose(fp);
+
+	if( Version < MIN_EXPORT_FILE_VERSION )
+	{
+		fprintf(stderr, "'%s' is not an Aeon profile export file (or it's older than version %d)\n", InFilename, MIN_EXPORT_FILE_VERSION);
+		return false;
+	}
+
+	return true;
+}
+
+static bool ReadBudget(const char* InFilename, std::vector<BudgetEntry_t>& OutBudget)
+{
+	FILE* fp = nullptr;
+	if( fopen_s(&fp, InFilename, "r") != 0 )
+	{
+		fprintf(stderr, "Can't open budget file '%s'\n", InFilename);
+		return false;
+	}
+
+	static char Line[MAX_LINE_LENGTH];
+	std::vector<std::string> Fields;
+
+	bool bSuccess = true;
+	int LineNumber = 0;
+
+	while( fgets(Line, sizeof(Line), fp) )
+	{
+		LineNumber++;
+
+		char* p = Line;
+		while( (*p == ' ') || (*p == '\t') )
+		{
+			p++;
+		}
+
+		if( (*p == 0) || (*p == '#') || (*p == '\n') || (*p == '\r') )
+		{
+			continue;
+		}
+
+		SplitFields(p, Fields);
+
+		BudgetEntry_t Entry;
+		Entry.LineNumber = LineNumber;
+		Entry.Percentile = 0.f;
+		Entry.bIsCalls = false;
+
+		if( Fields.size() != 3 )
+		{
+			fprintf(stderr, "%s(%d): expected <metric>,<limit>,\"<function>\"\n", InFilename, LineNumber);
+			bSuccess = false;
+			continue;
+		}
+
+		Entry.Metric = Fields[0];
+		Entry.Limit = atof(Fields[1].c_str());
+		Entry.SymbolName = Fields[2];
+
+		if( Entry.Metric == "calls" )
+		{
+			Entry.bIsCalls = true;
+		}
+		else if( (Entry.Metric.size() > 1) && (Entry.Metric[0] == 'p') )
+		{
+			Entry.Percentile = (float)atof(Entry.Metric.c_str() + 1);
+
+			if( (Entry.Percentile <= 0.f) || (Entry.Percentile > 100.f) )
+			{
+				fprintf(stderr, "%s(%d): bad percentile '%s'\n", InFilename, LineNumber, Entry.Metric.c_str());
+				bSuccess = false;
+				continue;
+			}
+		}
+		else if( Entry.Metric != "avg" )
+		{
+			fprintf(stderr, "%s(%d): unknown metric '%s' (use avg, pNN or calls)\n", InFilename, LineNumber, Entry.Metric.c_str());
+			bSuccess = false;
+			continue;
+		}
+
+		OutBudget.push_back(Entry);
+	}
+
+	fclose(fp);
+
+	return bSuccess;
+}
+
+static int CheckBudget(const char* InBudgetFilename, const std::vector<BudgetEntry_t>& InBudget, const ProfileMap_t& InProfile, bool& bOutError)
+{
+	int NumViolations = 0;
+
+	for( size_t index = 0; index < InBudget.size(); index++ )
+	{
+		const BudgetEntry_t& Entry = InBudget[index];
+
+		ProfileMap_t::const_iterator it = InProfile.find(Entry.SymbolName);
+		if( it == InProfile.end() )
+		{
+			printf("WARNING: %s(%d): '%s' was not called\n", InBudgetFilename, Entry.LineNumber, Entry.SymbolName.c_str());
+			continue;
+		}
+
+		const FunctionStats_t& Function = it->second;
+
+		if( Entry.bIsCalls )
+		{
+			if( (double)Function.CallCount > Entry.Limit )
+			{
+				printf("BUDGET: %s called %I64d times (limit %.0f)\n", Entry.SymbolName.c_str(), Function.CallCount, Entry.Limit);
+				NumViolations++;
+			}
+		}
+		else if( Entry.Percentile > 0.f )
+		{
+			if( !Function.bHasDurations )
+			{
+				fprintf(stderr, "%s(%d): the profile has no call time histogram for '%s' (it needs export file version %d or later)\n", InBudgetFilename, Entry.LineNumber, Entry.SymbolName.c_str(), DURATIONS_EXPORT_FILE_VERSION);
+				bOutError = true;
+				continue;
+			}
+
+			double Value = Function.GetPercentileMicroseconds(Entry.Percentile);
+			if( Value > Entry.Limit )
+			{
+				printf("BUDGET: %s %s inclusive time %.3f us (limit %.3f us)\n", Entry.SymbolName.c_str(), Entry.Metric.c_str(), Value, Entry.Limit);
+				NumViolations++;
+			}
+		}
+		else
+		{
+			double Value = Function.GetAverageMicroseconds();
+			if( Value > Entry.Limit )
+			{
+				printf("BUDGET: %s avg inclusive time %.3f us (limit %.3f us)\n", Entry.SymbolName.c_str(), Value, Entry.Limit);
+				NumViolations++;
+			}
+		}
+	}
+
+	return NumViolations;
+}
+
+static int CheckBaseline(const ProfileMap_t& InBaseline, const ProfileMap_t& InProfile, double InTolerancePercent, double InMinTimeMicroseconds)
+{
+	int NumViolations = 0;
+	double MaxRatio = 1.0 + (InTolerancePercent / 100.0);
+
+	for( ProfileMap_t::const_iterator it = InProfile.begin(); it != InProfile.end(); ++it )
+	{
+		ProfileMap_t::const_iterator base_it = InBaseline.find(it->first);
+		if( base_it == InBaseline.end() )
+		{
+			continue;  // new function
+		}
+
+		const FunctionStats_t& Function = it->second;
+		const FunctionStats_t& BaseFunction = base_it->second;
+
+		double Average = Function.GetAverageMicroseconds();
+		double BaseAverage = BaseFunction.GetAverageMicroseconds();
+
+		if( (BaseAverage >= InMinTimeMicroseconds) && (Average > BaseAverage * MaxRatio) )
+		{
+			printf("BASELINE: %s avg inclusive time %.3f us (baseline %.3f us, +%.1f%%)\n", it->first.c_str(), Average, BaseAverage, ((Average / BaseAverage) - 1.0) * 100.0);
+			NumViolations++;
+		}
+
+		if( Function.bHasDurations && BaseFunction.bHasDurations )
+		{
+			double P99 = Function.GetPercentileMicroseconds(99.f);
+			double BaseP99 = BaseFunction.GetPercentileMicroseconds(99.f);
+
+			if( (BaseP99 >= InMinTimeMicroseconds) && (P99 > BaseP99 * MaxRatio) )
+			{
+				printf("BASELINE: %s p99 inclusive time %.3f us (baseline %.3f us, +%.1f%%)\n", it->first.c_str(), P99, BaseP99, ((P99 / BaseP99) - 1.0) * 100.0);
+				NumViolations++;
+			}
+		}
+	}
+
+	return NumViolations;
+}
+
+static void PrintUsage()
+{
+	fprintf(stderr, "Usage: AeonBudget <profile> [-budget <budget file>] [-baseline <baseline profile>] [-tolerance <percent>] [-mintime <microseconds>] [-phase <phase name>]\n");
+}
+
+int main(int argc, char* argv[])
+{
+	const char* ProfileFilename = nullptr;
+	const char* BudgetFilename = nullptr;
+	const char* BaselineFilename = nullptr;
+	const char* PhaseName = nullptr;
+	double TolerancePercent = 10.0;
+	double MinTimeMicroseconds = 10.0;
+
+	for( int arg = 1; arg < argc; arg++ )
+	{
+		bool bHasValue = (arg + 1 < argc);
+
+		if( (_stricmp(argv[arg], "-budget") == 0) && bHasValue )
+		{
+			BudgetFilename = argv[++arg];
+		}
+		else if( (_stricmp(argv[arg], "-baseline") == 0) && bHasValue )
+		{
+			BaselineFilename = argv[++arg];
+		}
+		else if( (_stricmp(argv[arg], "-tolerance") == 0) && bHasValue )
+		{
+			TolerancePercent = atof(argv[++arg]);
+		}
+		else if( (_stricmp(argv[arg], "-mintime") == 0) && bHasValue )
+		{
+			MinTimeMicroseconds = atof(argv[++arg]);
+		}
+		else if( (_stricmp(argv[arg], "-phase") == 0) && bHasValue )
+		{
+			PhaseName = argv[++arg];
+		}
+		else if( (argv[arg][0] != '-') && (ProfileFilename == nullptr) )
+		{
+			ProfileFilename = argv[arg];
+		}
+		else
+		{
+			PrintUsage();
+			return EXIT_ERROR;
+		}
+	}
+
+	if( (ProfileFilename == nullptr) || ((BudgetFilename == nullptr) && (BaselineFilename == nullptr)) )
+	{
+		PrintUsage();
+		return EXIT_ERROR;
+	}
+
+	ProfileMap_t Profile;
+	if( !ReadProfile(ProfileFilename, PhaseName, Profile) )
+	{
+		return EXIT_ERROR;
+	}
+
+	bool bError = false;
+	int NumViolations = 0;
+
+	if( BudgetFilename )
+	{
+		std::vector<BudgetEntry_t> Budget;
+		if( !ReadBudget(BudgetFilename, Budget) )
+		{
+			return EXIT_ERROR;
+		}
+
+		NumViolations += CheckBudget(BudgetFilename, Budget, Profile, bError);
+	}
+
+	if( BaselineFilename )
+	{
+		ProfileMap_t Baseline;
+		if( !ReadProfile(BaselineFilename, PhaseName, Baseline) )
+		{
+			return EXIT_ERROR;
+		}
+
+		NumViolations += CheckBaseline(Baseline, Profile, TolerancePercent, MinTimeMicroseconds);
+	}
+
+	if( bError )
+	{
+		return EXIT_ERROR;
+	}
+
+	if( NumViolations > 0 )
+	{
+		printf("%d violation%s\n", NumViolations, (NumViolations == 1) ? "" : "s");
+		return EXIT_VIOLATIONS;
+	}
+
+	printf("Passed\n");
+	return EXIT_PASSED;
+}
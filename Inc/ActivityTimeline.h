@@ -0,0 +1,146 @@
+#pragma once
+
+#include <Windows.h>
+#include <string.h>
+
+#define ACTIVITY_TIMELINE_BUCKETS 128  /* number of buckets in each thread's timeline */
+#define ACTIVITY_TIMELINE_BUCKET_TIME 10000  /* duration of a bucket before the timeline has grown (1ms in 100ns units) */
+
+extern DWORD64 ProfilerStartTime;  // the CPU ticks when the profiler was loaded
+extern ULONGLONG ProfilerStartFileTime;  // the system time when the profiler was loaded
+extern int TicksPerHundredNanoseconds;
+
+inline __int64 GetProfilerTime(DWORD64 InTicks)  // convert CPU ticks to 100ns units since the profiler was loaded
+{
+	return ((__int64)(InTicks - ProfilerStartTime)) / TicksPerHundredNanoseconds;
+}
+
+inline __int64 GetProfilerTime(const FILETIME& InFileTime)  // convert a system time to 100ns units since the profiler was loaded
+{
+	ULARGE_INTEGER Time;
+	Time.LowPart = InFileTime.dwLowDateTime;
+	Time.HighPart = InFileTime.dwHighDateTime;
+
+	return (__int64)(Time.QuadPart - ProfilerStartFileTime);
+}
+
+// How busy a thread was over time.  A thread is busy while its call stack isn't empty.  The timeline starts when the profiler is
+// loaded and is split into ACTIVITY_TIMELINE_BUCKETS buckets, each holding the busy time in that interval.  When a busy period ends
+// past the last bucket, pairs of buckets are merged (doubling the duration of each bucket), so the timeline always covers the whole
+// run using the same amount of memory.  All times are in 100ns units since the profiler was loaded (see ProfilerStartTime).
+struct ActivityTimeline_t
+{
+	int BucketShift;  // each bucket is ACTIVITY_TIMELINE_BUCKET_TIME << BucketShift long
+	__int64 BusyTimeSum;  // total busy time (the sum of all the buckets)
+	__int64 BusyTime[ACTIVITY_TIMELINE_BUCKETS];
+
+	void Reset()
+	{
+		memset(this, 0, sizeof(ActivityTimeline_t));
+	}
+
+	__int64 GetBucketDuration() const
+	{
+		return (__int64)ACTIVITY_TIMELINE_BUCKET_TIME << BucketShift;
+	}
+
+	void Grow()  // merge each pair of buckets (so the timeline covers twice as much time)
+	{
+		for( int index = 0; index < ACTIVITY_TIMELINE_BUCKETS / 2; index++ )
+		{
+			BusyTime[index] = BusyTime[index * 2] + BusyTime[(index * 2) + 1];
+		}
+
+		memset(&BusyTime[ACTIVITY_TIMELINE_BUCKETS / 2], 0, (ACTIVITY_TIMELINE_BUCKETS / 2) * sizeof(__int64));
+
+		BucketShift++;
+	}
+
+	void AddBusyTime(__int64 InStartTime, __int64 InEndTime)
+	{
+		if( InStartTime < 0 )
+		{
+			InStartTime = 0;
+		}
+
+		if( InEndTime <= InStartTime )
+		{
+			return;
+		}
+
+		while( InEndTime >= ACTIVITY_TIMELINE_BUCKETS * GetBucketDuration() )
+		{
+			Grow();
+		}
+
+		__int64 BucketDuration = GetBucketDuration();
+
+		for( int index = (int)(InStartTime / BucketDuration); (index < ACTIVITY_TIMELINE_BUCKETS) && (index * BucketDuration < InEndTime); index++ )
+		{
+			__int64 BucketStart = max(InStartTime, index * BucketDuration);
+			__int64 BucketEnd = min(InEndTime, (index + 1) * BucketDuration);
+
+			BusyTime[index] += BucketEnd - BucketStart;
+		}
+
+		BusyTimeSum += InEndTime - InStartTime;
+	}
+
+	void AddTimeline(const ActivityTimeline_t& InOther)  // add another timeline's busy time to this one (for thread groups)
+	{
+		while( BucketShift < InOther.BucketShift )
+		{
+			Grow();
+		}
+
+		int BucketsPerBucket = 1 << (BucketShift - InOther.BucketShift);  // each of our buckets covers this many of the other timeline's buckets
+
+		for( int index = 0; index < ACTIVITY_TIMELINE_BUCKETS; index++ )
+		{
+			BusyTime[index / BucketsPerBucket] += InOther.BusyTime[index];
+		}
+
+		BusyTimeSum += InOther.BusyTimeSum;
+	}
+
+	// Fill OutBusyFractions with how busy the thread was (0 to 1) in each of InNumColumns equal intervals from the start of the
+	// timeline to InEndTime (so that the timelines of different threads line up with each other).
+	void GetBusyFractions(__int64 InEndTime, float* OutBusyFractions, int InNumColumns) const
+	{
+		__int64 BucketDuration = GetBucketDuration();
+		double ColumnDuration = (double)InEndTime / (double)InNumColumns;
+
+		for( int Column = 0; Column < InNumColumns; Column++ )
+		{
+			double ColumnStart = Column * ColumnDuration;
+			double ColumnEnd = ColumnStart + ColumnDuration;
+			double Busy = 0.0;
+
+			// buckets are assumed to be evenly busy over their whole duration
+			for( int index = (int)(ColumnStart / BucketDuration); (index < ACTIVITY_TIMELINE_BUCKETS) && (index * BucketDuration < ColumnEnd); index++ )
+			{
+				double OverlapStart = max(ColumnStart, (double)(index * BucketDuration));
+				double OverlapEnd = min(ColumnEnd, (double)((index + 1) * BucketDuration));
+
+				if( OverlapEnd > OverlapStart )
+				{
+					Busy += (double)BusyTime[index] * (OverlapEnd - OverlapStart) / (double)BucketDuration;
+				}
+			}
+
+			OutBusyFractions[Column] = (ColumnDuration > 0.0) ? (float)min(Busy / ColumnDuration, 1.0) : 0.f;
+		}
+	}
+};
+
+struct ThreadActivity_t  // a thread's lifetime and activity (see CThreadIdRecord::GetThreadActivity())
+{
+	__int64 CreateTime;  // when the thread was created (negative if it was created before the profiler was loaded)
+	__int64 FirstCallTime;  // when the thread first called a profiled function
+	__int64 LastActivityTime;  // when the thread last entered or exited a profiled function
+	__int64 ExitTime;  // when the thread exited (-1 if it's still running)
+	__int64 CaptureTime;  // when this copy was made
+	__int64 BusyStartTime;  // when the busy period that hasn't ended yet started (-1 if the thread wasn't busy)
+
+	ActivityTimeline_t Timeline;  // (includes the current busy period if the thread is busy right now, once FinishThreadActivity() has been called)
+};
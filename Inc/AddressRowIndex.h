@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Windows.h>
+#include <string.h>
+
+#include "Allocator.h"
+#include "CallTreeRecord.h"
+
+// Index from function address to row for one of the ListView windows, so finding the row of a function (when jumping between the
+// windows, or restoring the selection after a sort) doesn't scan the whole array of records.  The index is rebuilt in the same
+// pass as each sort of the window's array (see ListViewSortCallTreeArray()), it's an open addressing hash table kept at most half full.
+struct AddressRowIndex_t
+{
+	CAllocator Allocator;  // holds the slots (freed and reallocated when the index needs more slots)
+
+	const void** SlotAddresses;  // nullptr is an empty slot
+	int* SlotRows;
+	unsigned int SlotBits;
+	unsigned int NumSlots;
+
+	void* const* IndexedArray;  // the array of DialogCallTreeRecord_t pointers the index was built from
+	unsigned int IndexedArraySize;
+
+	AddressRowIndex_t()
+		: SlotAddresses(nullptr)
+		, SlotRows(nullptr)
+		, SlotBits(0)
+		, NumSlots(0)
+		, IndexedArray(nullptr)
+		, IndexedArraySize(0)
+	{
+	}
+
+	unsigned int GetSlot(const void* InAddress) const
+	{
+		return (unsigned int)(((unsigned __int64)(size_t)InAddress * 0x9E3779B97F4A7C15ULL) >> (64 - SlotBits));  // (the low bits of function addresses are mostly zero)
+	}
+
+	void Build(void* const* InArray, unsigned int InArraySize)
+	{
+		unsigned int NewSlotBits = 4;
+		while( (1U << NewSlotBits) < InArraySize * 2 )
+		{
+			NewSlotBits++;
+		}
+
+		if( (1U << NewSlotBits) > NumSlots )  // only reallocate when growing (the same window is sorted over and over)
+		{
+			Allocator.FreeBlocks();
+
+			NumSlots = 1U << NewSlotBits;
+			SlotAddresses = (const void**)Allocator.AllocateBytes(NumSlots * sizeof(void*), sizeof(void*));
+			SlotRows = (int*)Allocator.AllocateBytes(NumSlots * sizeof(int), sizeof(int));
+		}
+
+		SlotBits = NewSlotBits;
+		memset(SlotAddresses, 0, (1U << SlotBits) * sizeof(void*));
+
+		unsigned int Mask = (1U << SlotBits) - 1;
+
+		for( unsigned int row = 0; row < InArraySize; row++ )
+		{
+			const DialogCallTreeRecord_t* CallTreeRec = (const DialogCallTreeRecord_t*)InArray[row];
+
+			if( (CallTreeRec == nullptr) || (CallTreeRec->Address == nullptr) )
+			{
+				continue;
+			}
+
+			unsigned int Slot = GetSlot(CallTreeRec->Address);
+			while( SlotAddresses[Slot] && (SlotAddresses[Slot] != CallTreeRec->Address) )
+			{
+				Slot = (Slot + 1) & Mask;
+			}
+
+			if( SlotAddresses[Slot] == nullptr )  // (if an address is in the array more than once, the first row wins)
+			{
+				SlotAddresses[Slot] = CallTreeRec->Address;
+				SlotRows[Slot] = row;
+			}
+		}
+
+		IndexedArray = InArray;
+		IndexedArraySize = InArraySize;
+	}
+
+	int FindRow(void* const* InArray, unsigned int InArraySize, const void* InAddress)  // returns -1 if the address isn't in the array
+	{
+		if( (InArray == nullptr) || (InAddress == nullptr) )
+		{
+			return -1;
+		}
+
+		if( (InArray != IndexedArray) || (InArraySize != IndexedArraySize) )  // the window is showing a different array than the index was built from
+		{
+			Build(InArray, InArraySize);
+		}
+
+		unsigned int Mask = (1U << SlotBits) - 1;
+
+		for( unsigned int Slot = GetSlot(InAddress); SlotAddresses[Slot]; Slot = (Slot + 1) & Mask )
+		{
+			if( SlotAddresses[Slot] == InAddress )
+			{
+				return SlotRows[Slot];
+			}
+		}
+
+		return -1;
+	}
+};
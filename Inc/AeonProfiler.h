@@ -9,8 +9,57 @@
 
 #pragma once
 
-#ifdef _M_X64
-	#pragma comment(lib, "AeonProfiler64.lib")
+#ifdef AEON_EXPORTS  // (defined when building the profiler itself, which also includes this header)
+	#define AEON_API
 #else
-	#pragma comment(lib, "AeonProfiler.lib")
+	#define AEON_API __declspec(dllimport)
+
+	#ifdef _M_X64
+		#pragma comment(lib, "AeonProfiler64.lib")
+	#else
+		#pragma comment(lib, "AeonProfiler.lib")
+	#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Start a new phase named PhaseName (i.e. "Startup", "Loading", "Gameplay").  All threads switch over to collecting data for the
+// new phase (each phase has its own set of counters).  Starting a phase that was already used adds to that phase's counters.
+// A function that is still running when the phase changes is counted as a call in both phases, with its time split between them.
+AEON_API void AeonPhaseBegin(const char* PhaseName);
+
+// Flows measure how long work waits in a queue between threads.  Call AeonFlowBegin() when an item is enqueued and AeonFlowEnd()
+// with the same FlowType and FlowId when it is dequeued (FlowId only has to be unique among the items of that type still in the
+// queue, the item's address works).  The queueing delay is added to the flow type and to the functions that enqueued and dequeued
+// the item, and the flows are drawn as arrows between the threads in the trace export (File -> Export Trace).
+AEON_API void AeonFlowBegin(const char* FlowType, unsigned long long FlowId);
+AEON_API void AeonFlowEnd(const char* FlowType, unsigned long long FlowId);
+
+// Memory used by the profiler for one thread, in bytes (the fields other than ThreadId add up to AllocatedBytes).
+struct AeonMemoryStats
+{
+	unsigned long ThreadId;
+
+	size_t CallTreeRecordBytes;  // the per thread records for each function
+	size_t ColdRecordBytes;  // the rarely written part of each of those records
+	size_t HashNodeBytes;  // hash table nodes of the thread's function tables
+	size_t RecycledHashNodeBytes;  // hash table nodes that reuse the memory of old bucket arrays
+	size_t BucketArrayBytes;  // bucket arrays of the thread's function tables
+	size_t OldBucketArrayBytes;  // bucket arrays left behind when a table grew (not yet reused for nodes)
+	size_t ParentChildTableBytes;  // the parent and children tables of each function
+	size_t StackNodeBytes;  // the thread's call stack
+	size_t OtherBytes;  // everything else (alignment padding, allocator block headers, etc.)
+
+	size_t AllocatedBytes;  // total memory allocated for this thread
+	size_t SlackBytes;  // memory allocated for this thread that hasn't been used yet
+};
+
+// Fill OutStats with the memory used by up to MaxThreads threads and return the total number of threads (which can be more than
+// MaxThreads).  Pass a null OutStats to get the number of threads.
+AEON_API int AeonGetMemoryStats(struct AeonMemoryStats* OutStats, int MaxThreads);
+
+#ifdef __cplusplus
+}
 #endif
@@ -1,6 +1,9 @@
 
 #pragma once
 
+#define CACHE_LINE_SIZE 64
+#define CACHE_LINE_ALIGNED_SIZE(x) ((((x) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE) * CACHE_LINE_SIZE)  /* round a size up to a whole number of cache lines */
+
 class CAllocator  // super simple allocator that uses VirtualAlloc to allocate memory
 {
 private:
@@ -13,18 +16,27 @@ private:
 	};
 
 	char* FirstBlock;			// pointer to first block that was allocated (head of list)
-	char* CurrentBlock;			// pointer to current block (tail of list)
+	char* CurrentBlock;			// pointer to current block (tail of list, apart from any spare blocks linked after it by Reserve())
 
 	HANDLE ghAllocatorMutex;
 	int WaitOnMutex;			// whether this allocator needs a threading mutex (to keep it thread safe)
 
+	DWORD NumaNode;				// the NUMA node to allocate blocks on (NUMA_NO_PREFERRED_NODE to let the operating system choose)
+	bool bUseBlockPool;			// whether to get blocks from the warm block pool (for allocators that are used while handling a call)
+
+	char* AllocateBlock(size_t& InOutBlockSize);  // (the block size is updated if the block pool hands out a bigger block)
+
 public:
 	CAllocator(int InWaitOnMutex = 0);
 	~CAllocator();
 
+	void SetNumaNode(DWORD InNumaNode);
+	void SetUseBlockPool(bool bInUseBlockPool);
+
 	void FreeBlocks();			// free all the allocations by freeing the blocks allocated from the operating system
 	void GetAllocationStats(size_t& TotalSize, size_t& FreeSize);
 	void PrintStats(char* Header, int NestLevel);
 
 	void* AllocateBytes(size_t NumBytes, int Alignment);
+	void Reserve(size_t NumBytes);  // make sure the next NumBytes of allocations can be made without allocating another block (a spare block is linked after the current one if needed)
 };
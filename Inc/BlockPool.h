@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Windows.h>
+
+// The block pool is a pool of "warm" blocks (committed and already touched, so using them never causes a page fault) for the
+// allocators that are used while handling a call (see CAllocator::SetUseBlockPool).  A background thread keeps the pool for
+// each NUMA node topped up, so that a new thread (or a thread that has filled its current block) gets a new block without any
+// system calls or page faults while it's in the middle of an instrumented function.
+
+#define BLOCK_POOL_BLOCK_SIZE 65536  /* size of each block in the pool (this is the size of a normal CAllocator block) */
+#define BLOCK_POOL_MAX_LARGE_BLOCK_SIZE (16 * 1024 * 1024)  /* largest block the pool will get ready for an allocation that doesn't fit in a normal block */
+#define MAX_BLOCK_POOL_NODES 64  /* NUMA nodes higher than this share the pool for NUMA_NO_PREFERRED_NODE */
+
+void StartBlockPool(int InNumBlocks);  // start the background thread that fills the pools (InNumBlocks is the number of blocks to keep in each pool)
+void StopBlockPool();
+
+char* GetPoolBlock(DWORD InNumaNode);  // returns a zeroed BLOCK_POOL_BLOCK_SIZE block (or nullptr if the pool is empty)
+char* GetPoolLargeBlock(DWORD InNumaNode, size_t InMinSize, size_t& OutSize);  // returns a zeroed block of at least InMinSize bytes (or nullptr if one isn't ready, the next one asked for on this node will be)
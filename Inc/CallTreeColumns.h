@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "Allocator.h"
+
+struct DialogCallTreeRecord_t;
+struct DialogThreadIdRecord_t;
+
+// Columnar copy of one thread's captured call tree records (made once per capture, see BuildCallTreeColumns()).  Each column is
+// a parallel array in function address order, so the lookups by address and the per-thread totals read a contiguous array instead
+// of following a pointer to each record.  Only the columns that are scanned are copied, everything else is read from Records (the
+// ListView sorts and the export use most of a record's fields, so they go through the records).
+struct CallTreeColumns_t
+{
+	unsigned int NumRecords;
+
+	const void** Address;  // sorted (so FindIndex() can do a binary search)
+	int* CallCount;
+	__int64* ExclusiveTime;  // CallDurationExclusiveTimeSum
+
+	DialogCallTreeRecord_t** Records;  // the record each row was made from (for the values that don't have a column)
+
+	int FindIndex(const void* InAddress) const  // returns the row of the function at InAddress (-1 if the thread didn't call it)
+	{
+		int min_index = 0;
+		int max_index = (int)NumRecords - 1;
+
+		while( max_index >= min_index )
+		{
+			int mid_index = (max_index + min_index) / 2;
+
+			if( Address[mid_index] == InAddress )
+			{
+				return mid_index;
+			}
+			else if( (size_t)Address[mid_index] < (size_t)InAddress )
+			{
+				min_index = mid_index + 1;
+			}
+			else
+			{
+				max_index = mid_index - 1;
+			}
+		}
+
+		return -1;
+	}
+
+	void GetTotals(__int64& OutCallCount, __int64& OutExclusiveTime) const  // totals over all of the thread's functions
+	{
+		__int64 TotalCallCount = 0;
+		__int64 TotalExclusiveTime = 0;
+
+		for( unsigned int index = 0; index < NumRecords; index++ )
+		{
+			TotalCallCount += CallCount[index];
+			TotalExclusiveTime += ExclusiveTime[index];
+		}
+
+		OutCallCount = TotalCallCount;
+		OutExclusiveTime = TotalExclusiveTime;
+	}
+};
+
+// Make the columns for a thread from its CallTreeArray (which must be sorted by address).  The columns are allocated from InAllocator.
+CallTreeColumns_t* BuildCallTreeColumns(CAllocator* InAllocator, const DialogThreadIdRecord_t* InThreadRec);
@@ -7,12 +7,23 @@
 
 #include "Allocator.h"
 #include "Hash.h"
+#include "FunctionRecord.h"
+#include "Plugin.h"
+#include "IntervalStats.h"
+#include "DurationShape.h"
+#include "FaultCounters.h"
 
 #define CALLRECORD_HASH_TABLE_SIZE 256  /* default size of hash table for all callrecords within a thread */
 #define PARENT_CALLRECORD_HASH_TABLE_SIZE 8  /* default size of hash table for parents within a child callrecord */
 #define CHILDREN_CALLRECORD_HASH_TABLE_SIZE 8  /* default size of hash table for children within a parent callrecord */
 
+#define COLD_STATS_EXACT_CALLS 256  /* the first calls to a function all update the stats in the CallTreeRecordCold_t... */
+#define COLD_STATS_SAMPLE_RATE 16  /* ...after that only every Nth call does (must be a power of 2 that COLD_STATS_EXACT_CALLS is a multiple of) */
+
+#define CALLTREERECORD_ALLOCATION_SIZE CACHE_LINE_ALIGNED_SIZE(sizeof(CCallTreeRecord) + AEON_PLUGIN_PAYLOAD_SIZE)  /* the record plus the plugin's payload */
+
 extern int NumCallTreeRecords;
+extern int TicksPerHundredNanoseconds;
 
 // forward declarations
 class CCallTreeRecord;
@@ -30,7 +41,7 @@ struct DialogCallTreeRecord_t  // "static" copy of CCallTreeRecord for the Dialo
 
 	const void* Address;
 
-	DWORD64 EnterTime;  // the time the function called the Enter handler (this gets zeroed out on Exit, so we can tell which functions on the stack were entered but haven't exited yet)
+	DWORD64 EnterTime;  // the time the function called the Enter handler (this is zero if the function isn't on the stack, so we can tell which functions on the stack were entered but haven't exited yet)
 
 	__int64 CallDurationInclusiveTimeSum;  // the sum of all durations calling this function and its children (so we can calc the average call time)
 	__int64 CallDurationExclusiveTimeSum;  // the sum of all durations calling this function (minus the CallDurationInclusiveTimeSum of the children)
@@ -42,17 +53,52 @@ struct DialogCallTreeRecord_t  // "static" copy of CCallTreeRecord for the Dialo
 	int MaxRecursionLevel;
 
 	char* SymbolName;
+
+	float CallsPerSecond;  // from the IntervalStats_t (see GetCallsPerSecond())
+	float Burstiness;  // from the IntervalStats_t (see GetBurstiness())
+	unsigned int IntervalHistogram[INTERVAL_HISTOGRAM_BUCKETS];
+	unsigned int DurationHistogram[INTERVAL_HISTOGRAM_BUCKETS];  // log2 bucketed count of the inclusive call durations (for percentiles)
+	DurationShape_t Shape;  // modes and tail of the DurationHistogram (see GetDurationShape())
+	OutlierStats_t Outliers;
+
+	__int64 SelfTimeSum;  // the part of CallDurationExclusiveTimeSum spent in instrumented code (from the sampler, see Sampler.h)
+	__int64 ExternalTimeSum;  // the part of CallDurationExclusiveTimeSum spent in code that isn't instrumented
+	LONG SelfSamples;
+	LONG ExternalSamples;
+
+	unsigned int FaultMeasuredCalls;  // number of calls the fault counters were read for (see FaultCounters.h)
+	__int64 ProcessPageFaults;  // estimated for all of the calls (inclusive, these are the whole process's page faults while the calls ran)
+	__int64 OffCpuTime;  // estimated for all of the calls (inclusive, in 100ns units)
+
+	__int64* PluginColumnValues;  // CAeonPlugin::NumColumns values (null if there is no plugin)
 };
 
-class CCallTreeRecord
+struct CallTreeRecordCold_t  // the part of a CCallTreeRecord that most calls don't write to (kept out of the CCallTreeRecord cache line)
 {
-public:
-	CHash<CCallTreeRecord>* ParentHashTable;		// parent functions that called this function
-	CHash<CCallTreeRecord>* ChildrenHashTable;		// child functions that this function calls
+	CFunctionRecord* Function;  // the process wide record for this function (address, symbol name, source code location)
 
-	const void* Address;
+	CHash<CCallTreeRecord, FunctionKey_t>* ParentHashTable;		// parent functions that called this function (looked up on every exit unless AEON_DEFERRED_EDGES is set, see EdgeLog.h)
+	CHash<CCallTreeRecord, FunctionKey_t>* ChildrenHashTable;	// child functions that this function calls
 
-	DWORD64 EnterTime;  // the time the function called the Enter handler (this gets zeroed out on Exit, so we can tell which functions on the stack were entered but haven't exited yet)
+	IntervalStats_t Intervals;  // time between successive calls (updated on the sampled enters, see GetColdStatsWeight())
+	unsigned int DurationHistogram[INTERVAL_HISTOGRAM_BUCKETS];  // log2 bucketed count of the inclusive call durations (updated on the sampled exits, weighted)
+	OutlierStats_t Outliers;  // calls much slower than the average and the callers that made them (only written when a call is an outlier, see IsOutlierCall())
+	FaultStats_t Faults;  // process page faults and off-CPU time of the measured calls (only written on the exit of a measured call)
+
+	volatile LONG SelfSamples;  // number of times the sampler found this function on top of the stack executing instrumented code
+	volatile LONG ExternalSamples;  // number of times the sampler found this function on top of the stack executing code that isn't instrumented
+};
+
+// The CCallTreeRecord is the per thread data for a function.  It only contains the counters that are updated on every call (so that
+// updating them only touches one cache line), everything else is in the CallTreeRecordCold_t.  The cold block is still read on exit to
+// find the parent and child records (unless AEON_DEFERRED_EDGES is set), but the statistics in it are only written on some of the calls
+// (see GetColdStatsWeight()), when a call is an outlier and when the fault counters are read.  These must be allocated
+// with CACHE_LINE_SIZE alignment and CALLTREERECORD_ALLOCATION_SIZE bytes (see CThreadIdRecord::CallTreeRecordAllocator), the plugin's
+// payload (if there is one) is right after the record.
+__declspec(align(CACHE_LINE_SIZE)) class CCallTreeRecord
+{
+public:
+	DWORD64 EnterTime;  // the time of the most recent call to the Enter handler (0 if there hasn't been one), the next enter uses this for the time between calls (StackDepth tells us whether the function is still on the stack)
 
 	__int64 CallDurationInclusiveTimeSum;  // the sum of all durations calling this function and its children (so we can calc the average call time)
 	__int64 CallDurationExclusiveTimeSum;  // the sum of all durations calling this function (minus the CallDurationInclusiveTimeSum of the children)
@@ -63,12 +109,10 @@ public:
 	int StackDepth;
 	int MaxRecursionLevel;
 
-	char* SymbolName;
+	CallTreeRecordCold_t* Cold;
 
-	CCallTreeRecord(const void* InAddress) :
-		Address( InAddress )
-		,SymbolName( nullptr )
-		,CallCount( 0 )
+	CCallTreeRecord(FunctionKey_t InFunctionKey, const void* InAddress, CAllocator* InColdAllocator) :  // InColdAllocator is the allocator for the CallTreeRecordCold_t
+		CallCount( 0 )
 		,CallDurationInclusiveTimeSum( 0 )
 		,CallDurationExclusiveTimeSum( 0 )
 		,MaxCallDurationExclusiveTime( 0 )
@@ -76,20 +120,62 @@ public:
 		,MaxRecursionLevel( 0 )
 		,CurrentChildrenInclusiveTime( 0 )
 	{
-		ParentHashTable = nullptr;
-		ChildrenHashTable = nullptr;
+		EnterTime = 0;
+
+		Cold = (CallTreeRecordCold_t*)InColdAllocator->AllocateBytes(sizeof(CallTreeRecordCold_t), sizeof(void*));
+
+		Cold->ParentHashTable = nullptr;
+		Cold->ChildrenHashTable = nullptr;
+
+		Cold->Intervals.Reset();
+
+		Cold->SelfSamples = 0;
+		Cold->ExternalSamples = 0;
+
+		memset(Cold->DurationHistogram, 0, sizeof(Cold->DurationHistogram));
+		Cold->Outliers.Reset();
+		Cold->Faults.Reset();
+
+		Cold->Function = LookupFunctionRecord(InFunctionKey, InAddress);  // call tree records are only created while holding gCriticalSection
+
+		if( CAeonPlugin::NumColumns > 0 )
+		{
+			memset(&GetPluginPayload(), 0, sizeof(CAeonPlugin::Payload_t));
+		}
 
 		NumCallTreeRecords++;
 	}
 
 	~CCallTreeRecord()
 	{
-		Address = NULL;
-		SymbolName = NULL;
+		Cold = nullptr;
 
 		NumCallTreeRecords--;
 	}
 
+	CAeonPlugin::Payload_t& GetPluginPayload()
+	{
+		return *(CAeonPlugin::Payload_t*)(this + 1);
+	}
+
+	unsigned int GetColdStatsWeight() const  // how many calls this call stands for in the sampled stats in the Cold block (0 if this call isn't sampled)
+	{
+		if( CallCount <= COLD_STATS_EXACT_CALLS )
+		{
+			return 1;
+		}
+
+		return ((CallCount & (COLD_STATS_SAMPLE_RATE - 1)) == 0) ? COLD_STATS_SAMPLE_RATE : 0;
+	}
+
+	bool IsOutlierCall(__int64 InCallDuration) const  // is this call much slower than the average of the previous calls?  (this only reads this cache line, call it before CallDurationInclusiveTimeSum is updated)
+	{
+		int PreviousCallCount = CallCount - 1;
+
+		return (PreviousCallCount >= MIN_OUTLIER_CALLS) &&
+			((double)InCallDuration * (double)PreviousCallCount > (double)OUTLIER_FACTOR * (double)CallDurationInclusiveTimeSum);
+	}
+
 	void PrintStats(char* Header, int NestLevel)
 	{
 	}
@@ -117,21 +203,21 @@ public:
 
 		if( bCopyMemberHashTables )
 		{
-			if( ParentHashTable )
+			if( Cold->ParentHashTable )
 			{
 				// when copying the hash table elements, don't copy their hash table elements as well (otherwise this causes recursion hell)
-				pRec->ParentArray = ParentHashTable->CopyHashToArray(InCopyAllocator, pRec->ParentArraySize, false);
+				pRec->ParentArray = Cold->ParentHashTable->CopyHashToArray(InCopyAllocator, pRec->ParentArraySize, false);
 			}
-			if( ChildrenHashTable )
+			if( Cold->ChildrenHashTable )
 			{
 				// when copying the hash table elements, don't copy their hash table elements as well (otherwise this causes recursion hell)
-				pRec->ChildrenArray = ChildrenHashTable->CopyHashToArray(InCopyAllocator, pRec->ChildrenArraySize, false);
+				pRec->ChildrenArray = Cold->ChildrenHashTable->CopyHashToArray(InCopyAllocator, pRec->ChildrenArraySize, false);
 			}
 		}
 
-		pRec->Address = Address;
+		pRec->Address = Cold->Function->GetAddress();
 
-		pRec->EnterTime = EnterTime;
+		pRec->EnterTime = (StackDepth > 0) ? EnterTime : 0;  // the copy's EnterTime is only set for functions that haven't exited yet
 
 		pRec->CallDurationInclusiveTimeSum = CallDurationInclusiveTimeSum;
 		pRec->CallDurationExclusiveTimeSum = CallDurationExclusiveTimeSum;
@@ -142,7 +228,41 @@ public:
 		pRec->StackDepth = StackDepth;
 		pRec->MaxRecursionLevel = MaxRecursionLevel;
 
-		pRec->SymbolName = SymbolName;
+		pRec->SymbolName = Cold->Function->SymbolName;
+
+		pRec->CallsPerSecond = Cold->Intervals.GetCallsPerSecond(TicksPerHundredNanoseconds);
+		pRec->Burstiness = Cold->Intervals.GetBurstiness();
+		memcpy(pRec->IntervalHistogram, Cold->Intervals.Histogram, sizeof(pRec->IntervalHistogram));
+		memcpy(pRec->DurationHistogram, Cold->DurationHistogram, sizeof(pRec->DurationHistogram));
+		GetDurationShape(pRec->DurationHistogram, pRec->Shape);
+		pRec->Outliers = Cold->Outliers;
+
+		pRec->FaultMeasuredCalls = Cold->Faults.MeasuredCalls;
+		pRec->ProcessPageFaults = Cold->Faults.EstimateTotal((double)Cold->Faults.ProcessPageFaults, CallCount);
+		pRec->OffCpuTime = Cold->Faults.EstimateTotal(Cold->Faults.OffCpuTime, CallCount);
+
+		// split the exclusive time by the ratio of the samples (if there aren't any samples, it's all self time)
+		pRec->SelfSamples = Cold->SelfSamples;
+		pRec->ExternalSamples = Cold->ExternalSamples;
+
+		pRec->ExternalTimeSum = 0;
+		if( (pRec->SelfSamples + pRec->ExternalSamples) > 0 )
+		{
+			pRec->ExternalTimeSum = (__int64)((double)CallDurationExclusiveTimeSum * (double)pRec->ExternalSamples / (double)(pRec->SelfSamples + pRec->ExternalSamples));
+		}
+		pRec->SelfTimeSum = CallDurationExclusiveTimeSum - pRec->ExternalTimeSum;
+
+		pRec->PluginColumnValues = nullptr;
+
+		if( CAeonPlugin::NumColumns > 0 )
+		{
+			pRec->PluginColumnValues = (__int64*)InCopyAllocator->AllocateBytes((CAeonPlugin::NumColumns + 1) * sizeof(__int64), sizeof(__int64));
+
+			for( int Column = 0; Column < CAeonPlugin::NumColumns; Column++ )
+			{
+				pRec->PluginColumnValues[Column] = CAeonPlugin::GetColumnValue(GetPluginPayload(), Column);
+			}
+		}
 
 		return (void*)pRec;
 	}
@@ -157,11 +277,26 @@ public:
 		CallCount = 0;
 		StackDepth = 0;
 		MaxRecursionLevel = 0;
+
+		EnterTime = 0;  // (so the first interval after the reset doesn't start before it)
+		Cold->Intervals.Reset();
+
+		Cold->SelfSamples = 0;
+		Cold->ExternalSamples = 0;
+
+		memset(Cold->DurationHistogram, 0, sizeof(Cold->DurationHistogram));
+		Cold->Outliers.Reset();
+		Cold->Faults.Reset();
+
+		if( CAeonPlugin::NumColumns > 0 )
+		{
+			memset(&GetPluginPayload(), 0, sizeof(CAeonPlugin::Payload_t));
+		}
 	}
 
 	void SetSymbolName(char* InSymbolName)
 	{
-		SymbolName = InSymbolName;
+		Cold->Function->SetSymbolName(InSymbolName);
 	}
 
 private:
@@ -175,3 +310,5 @@ private:
 		assert(false);
 	}
 };
+
+static_assert(sizeof(CCallTreeRecord) == CACHE_LINE_SIZE, "CCallTreeRecord should fit in exactly one cache line");
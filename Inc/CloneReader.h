@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Windows.h>
+
+// Reads the memory of a copy-on-write clone of this process (see PssCaptureSnapshot() with PSS_CAPTURE_VA_CLONE).  Making the clone
+// only takes as long as copying the page tables, so the profiler's data structures can be cloned while holding gCriticalSection
+// for a very short time, then read from the clone (at the same addresses they had when the clone was made) while the application
+// keeps running and changing the originals.  This is the Windows version of fork()ing a child process to write out a consistent
+// copy of the data.  Reads are cached in CLONE_READER_CHUNK_SIZE chunks, since the records are allocated close together.
+
+#define CLONE_READER_CHUNK_SIZE 65536
+#define CLONE_READER_CACHED_CHUNKS 256  /* (16MB of cached clone memory) */
+
+class CCloneReader
+{
+private:
+	HANDLE hSnapshot;  // the HPSS from PssCaptureSnapshot()
+	HANDLE hCloneProcess;  // the clone process (from PssQuerySnapshot())
+
+	char* ChunkMemory;  // CLONE_READER_CACHED_CHUNKS chunks (allocated when the clone is made)
+	size_t ChunkAddress[CLONE_READER_CACHED_CHUNKS];  // the address of the chunk in each cache slot (0 if the slot is empty)
+
+	bool ReadChunk(size_t InChunkAddress, int InSlot);
+
+public:
+	CCloneReader();
+	~CCloneReader();
+
+	bool CreateClone();  // clone this process (call this while holding gCriticalSection, so the profiler's data is consistent in the clone)
+	void FreeClone();
+
+	bool IsCloned() const
+	{
+		return (hCloneProcess != nullptr);
+	}
+
+	bool Read(const void* InAddress, void* OutBuffer, size_t InNumBytes);  // read from the clone's memory (returns false if the memory isn't readable)
+
+	template <typename T>
+	bool Read(const T* InAddress, T& OutValue)  // (only for plain structs and pointers, no constructor is called)
+	{
+		return Read((const void*)InAddress, (void*)&OutValue, sizeof(T));
+	}
+};
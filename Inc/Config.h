@@ -52,6 +52,34 @@ struct ConfigValueStruct
 
 extern ConfigValueStruct ConfigValues[];
 
+enum ProfilerOptionId  // this is the list of the known profiler options (these are read from environment variables when the DLL is loaded)
+{
+	OPTION_COVERAGE_MODE,
+	OPTION_COVERAGE_FILE,
+	OPTION_SIZING_HINTS_FILE,
+	OPTION_BLOCK_POOL_SIZE,
+	OPTION_EXTERNAL_SAMPLE_INTERVAL,
+	OPTION_FAULT_COUNTER_SAMPLE_RATE,
+	OPTION_THREAD_GROUP_PREFIXES,
+	OPTION_EXPORT_BACKEND,
+	OPTION_DEFERRED_EDGES,
+	OPTION_LINE_SAMPLES,
+};
+
+struct ProfilerOptionStruct
+{
+	ProfilerOptionId Id;
+	char* EnvironmentVariable;  // name of the environment variable used to set this option
+	char* DefaultValue;
+	char Value[MAX_PATH];  // the current value of this option (as a string)
+};
+
+extern ProfilerOptionStruct ProfilerOptions[];
+
+void ReadProfilerOptions();  // read the profiler options from the environment (this needs to be done before any caller data is tracked)
+int GetProfilerOptionInt(ProfilerOptionId Id);  // return value of -1 indicates Id was not found
+char* GetProfilerOptionString(ProfilerOptionId Id);  // return value of nullptr indicates Id was not found
+
 class CConfig
 {
 private:
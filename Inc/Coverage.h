@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Windows.h>
+
+// Function coverage mode (see OPTION_COVERAGE_MODE).  In this mode no call tree data is collected, the only thing tracked is
+// whether a function has been called at least once.  Each module gets a bitmap with one bit per byte offset in the module and
+// the bit for a function is set the first time that function is entered.
+
+#define COVERAGE_MODE_OFF 0
+#define COVERAGE_MODE_BITMAP 1  /* only set the bit in the bitmap (every call still goes through _penter and _pexit) */
+#define COVERAGE_MODE_PATCH 2  /* set the bit in the bitmap then patch out the call to _penter/_pexit (so subsequent calls are free) */
+
+#define COVERAGE_FILE_MAGIC "AEONCOV1"
+
+extern int CoverageMode;
+
+void InitCoverage();  // (called when the DLL is loaded, before any call can be patched)
+
+void CoverageEnter(const void* InCallerAddress);
+void CoverageExit(const void* InCallerAddress);
+
+void WriteCoverageFile(const char* InFilename);  // merge this process's coverage bitmaps into the coverage file
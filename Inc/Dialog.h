@@ -26,6 +26,15 @@ enum SortType
 	SORT_Decreasing
 };
 
+struct ListViewColumnsDefaults  // ListView default settings for a column
+{
+	TCHAR* ColumnName;
+	SortType ColumnSortType;
+	bool bIsDefaultSortColumn;
+	int ColumnWidth;
+	bool bLeftJustify;
+};
+
 extern HMODULE ModuleHandle;
 extern CRITICAL_SECTION gCriticalSection;
 
@@ -38,6 +47,7 @@ extern DWORD DialogCallTreeThreadId;  // the thread id of the thread to display
 
 extern void** CaptureCallTreeThreadArrayPointer;
 extern unsigned int CaptureCallTreeThreadArraySize;
+extern int CaptureCallTreePhaseIndex;  // the phase that the captured call tree data is for
 
 extern int DialogListViewThreadIndex;  // the index of the thread currently selected from the ThreadArray (-1 means invalid thread)
 
@@ -62,6 +72,9 @@ void WINAPI ProcessCallTreeDataThread(LPVOID lpData);
 void ResetCallTreeData();
 void DisplayCallTreeData();
 
+void InitializeSymbolLookup();
+char* LookupAddressSymbolName(DWORD64 dw64Address);
+
 void ConvertTicksToTime(char* Buffer, size_t buffer_len, __int64 Ticks);
 void ConvertTicksToTime(TCHAR* Buffer, size_t buffer_len, __int64 Ticks);
 void ConvertTicksToTime(char* Buffer, size_t buffer_len, float AvgTicks);
@@ -82,4 +95,5 @@ void ListViewSetRowSelected(HWND hWnd, int row, DialogThreadIdRecord_t* ListView
 int ListView_SortCallTree(const void* arg1, const void* arg2);
 void ListViewNotify(HWND hWnd, LPARAM lParam);
 
-int FindRowForAddress(HWND hWnd, const void* Address);
+int FindRowForAddress(HWND hWnd, const void* Address);  // (uses the window's address to row index, see AddressRowIndex.h)
+void ListViewSortCallTreeArray(HWND hWnd, void** Array, unsigned int ArraySize);
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <Windows.h>
+#include <string.h>
+
+#include "IntervalStats.h"
+
+class CFunctionRecord;
+
+#define DURATION_SHAPE_BIMODAL 0x1  /* the call times have more than one mode (the function has a fast path and a slow path) */
+#define DURATION_SHAPE_HEAVY_TAIL 0x2  /* more calls than expected are much slower than the slowest mode */
+
+#define MAX_DURATION_MODES 4
+#define MIN_SHAPE_CALLS 50  /* functions called fewer times than this aren't classified */
+#define MIN_MODE_PERCENT 5  /* a mode must have at least this percentage of the calls */
+#define HEAVY_TAIL_BUCKETS 3  /* calls this many buckets (8x) above the slowest mode are in the tail */
+#define HEAVY_TAIL_PERCENT 1  /* the tail must have at least this percentage of the calls to be heavy */
+
+#define MAX_OUTLIER_CALLERS 4
+#define MIN_OUTLIER_CALLS 20  /* don't look for outliers until the function's average is meaningful */
+#define OUTLIER_FACTOR 8  /* a call is an outlier if it takes this many times longer than the average */
+
+struct DurationShape_t  // the shape of a function's inclusive call time histogram (see GetDurationShape())
+{
+	int Flags;  // DURATION_SHAPE_ flags
+	int NumModes;
+	__int64 Modes[MAX_DURATION_MODES];  // the middle of each mode's histogram bucket (in 100ns units, fastest first)
+};
+
+// Classify a histogram of call times (bucketed by GetHistogramBucket()).  The modes are the buckets holding at least MIN_MODE_PERCENT
+// of the calls that are higher than the buckets on either side, two neighbouring modes only count separately if the bucket between
+// them has less than half as many calls as the smaller one.
+inline void GetDurationShape(const unsigned int* InHistogram, DurationShape_t& OutShape)
+{
+	memset(&OutShape, 0, sizeof(DurationShape_t));
+
+	unsigned __int64 Count = 0;
+	for( int Bucket = 0; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+	{
+		Count += InHistogram[Bucket];
+	}
+
+	if( Count < MIN_SHAPE_CALLS )
+	{
+		return;
+	}
+
+	int ModeBuckets[MAX_DURATION_MODES];
+
+	for( int Bucket = 0; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+	{
+		unsigned int Value = InHistogram[Bucket];
+		unsigned int Left = (Bucket > 0) ? InHistogram[Bucket - 1] : 0;
+		unsigned int Right = (Bucket < INTERVAL_HISTOGRAM_BUCKETS - 1) ? InHistogram[Bucket + 1] : 0;
+
+		if( ((unsigned __int64)Value * 100 < Count * MIN_MODE_PERCENT) || (Value <= Left) || (Value < Right) )
+		{
+			continue;
+		}
+
+		if( OutShape.NumModes > 0 )
+		{
+			int PrevBucket = ModeBuckets[OutShape.NumModes - 1];
+
+			unsigned int Valley = Value;
+			for( int index = PrevBucket + 1; index < Bucket; index++ )
+			{
+				Valley = min(Valley, InHistogram[index]);
+			}
+
+			if( (unsigned __int64)Valley * 2 >= min(Value, InHistogram[PrevBucket]) )  // not separated from the previous mode
+			{
+				if( Value > InHistogram[PrevBucket] )
+				{
+					ModeBuckets[OutShape.NumModes - 1] = Bucket;
+				}
+				continue;
+			}
+		}
+
+		if( OutShape.NumModes < MAX_DURATION_MODES )
+		{
+			ModeBuckets[OutShape.NumModes++] = Bucket;
+		}
+	}
+
+	for( int index = 0; index < OutShape.NumModes; index++ )
+	{
+		int Bucket = ModeBuckets[index];
+		OutShape.Modes[index] = (Bucket > 0) ? (((__int64)3 << Bucket) >> 2) : 0;  // 1.5 * 2^(Bucket-1) (bucket N covers 2^(N-1) to 2^N)
+	}
+
+	if( OutShape.NumModes > 1 )
+	{
+		OutShape.Flags |= DURATION_SHAPE_BIMODAL;
+	}
+
+	if( OutShape.NumModes > 0 )
+	{
+		unsigned __int64 TailCount = 0;
+		for( int Bucket = ModeBuckets[OutShape.NumModes - 1] + HEAVY_TAIL_BUCKETS; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+		{
+			TailCount += InHistogram[Bucket];
+		}
+
+		if( TailCount * 100 >= Count * HEAVY_TAIL_PERCENT )
+		{
+			OutShape.Flags |= DURATION_SHAPE_HEAVY_TAIL;
+		}
+	}
+}
+
+// Outlier calls (calls more than OUTLIER_FACTOR times slower than the average so far) and which callers made them.  The callers are
+// tracked with the "space saving" algorithm, so the callers with the most outliers are kept (their counts can be over estimated by
+// at most the count of the caller that was replaced).
+struct OutlierStats_t
+{
+	unsigned int NumOutliers;
+	__int64 MaxOutlierDuration;  // in 100ns units
+
+	CFunctionRecord* Callers[MAX_OUTLIER_CALLERS];  // null for calls with no caller (the bottom of the thread's stack)
+	unsigned int CallerCounts[MAX_OUTLIER_CALLERS];
+
+	void Reset()
+	{
+		memset(this, 0, sizeof(OutlierStats_t));
+	}
+
+	void AddOutlier(CFunctionRecord* InCaller, __int64 InDuration)
+	{
+		NumOutliers++;
+		MaxOutlierDuration = max(MaxOutlierDuration, InDuration);
+
+		AddCaller(InCaller, 1);
+	}
+
+	void Merge(const OutlierStats_t& InOther)  // add another record's outliers to this one (for thread groups)
+	{
+		NumOutliers += InOther.NumOutliers;
+		MaxOutlierDuration = max(MaxOutlierDuration, InOther.MaxOutlierDuration);
+
+		for( int index = 0; index < MAX_OUTLIER_CALLERS; index++ )
+		{
+			if( InOther.CallerCounts[index] > 0 )
+			{
+				AddCaller(InOther.Callers[index], InOther.CallerCounts[index]);
+			}
+		}
+	}
+
+	void AddCaller(CFunctionRecord* InCaller, unsigned int InCount)
+	{
+		int MinIndex = 0;
+
+		for( int index = 0; index < MAX_OUTLIER_CALLERS; index++ )
+		{
+			if( (Callers[index] == InCaller) && (CallerCounts[index] > 0) )
+			{
+				CallerCounts[index] += InCount;
+				return;
+			}
+
+			if( CallerCounts[index] < CallerCounts[MinIndex] )
+			{
+				MinIndex = index;
+			}
+		}
+
+		Callers[MinIndex] = InCaller;
+		CallerCounts[MinIndex] += InCount;
+	}
+
+	int GetTopCaller() const  // returns the index of the caller with the most outliers (-1 if there aren't any)
+	{
+		int TopIndex = -1;
+
+		for( int index = 0; index < MAX_OUTLIER_CALLERS; index++ )
+		{
+			if( (CallerCounts[index] > 0) && ((TopIndex < 0) || (CallerCounts[index] > CallerCounts[TopIndex])) )
+			{
+				TopIndex = index;
+			}
+		}
+
+		return TopIndex;
+	}
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "Allocator.h"
+
+// Deferred edge recording (see OPTION_DEFERRED_EDGES).  Normally CallerExit() adds the parent to the child's ParentHashTable and the
+// child to the parent's ChildrenHashTable on every exit, which is two hash lookups (and sometimes creating or growing a table) just to
+// keep up the call graph, which is only looked at when the data is captured.  When this is turned on, CallerExit() appends the
+// (parent, child) pair of call tree records to a small log for the thread instead.  A direct mapped filter of the recently logged
+// edges drops the repeats (a loop that calls the same functions over and over only logs each edge once), and the logged edges are
+// added to the hash tables in a batch when the log fills up and before the data is captured (see FlushAllEdgeLogs()).
+
+#define EDGE_LOG_SIZE 1024  /* edges a thread can log before they are added to the call graph */
+#define EDGE_LOG_FILTER_SIZE 64  /* recently logged edges that are dropped when they're logged again (must be a power of 2) */
+
+class CCallTreeRecord;
+class CThreadIdRecord;
+
+extern bool bDeferredEdges;
+
+struct CallTreeEdge_t
+{
+	CCallTreeRecord* Parent;
+	CCallTreeRecord* Child;
+};
+
+struct EdgeLog_t
+{
+	unsigned int NumEdges;
+	CallTreeEdge_t Edges[EDGE_LOG_SIZE];
+	CallTreeEdge_t RecentEdges[EDGE_LOG_FILTER_SIZE];  // the last edge logged in each slot (these stay valid after the log is flushed)
+
+	void Reset()
+	{
+		NumEdges = 0;
+		memset(RecentEdges, 0, sizeof(RecentEdges));
+	}
+
+	bool Add(CCallTreeRecord* InParent, CCallTreeRecord* InChild)  // returns true when the log is full (and needs to be flushed)
+	{
+		// the records are cache line aligned, so the low bits are always zero
+		CallTreeEdge_t& Recent = RecentEdges[(((size_t)InParent ^ (size_t)InChild) / CACHE_LINE_SIZE) & (EDGE_LOG_FILTER_SIZE - 1)];
+
+		if( (Recent.Parent == InParent) && (Recent.Child == InChild) )
+		{
+			return false;  // this edge is already in the log (or the call graph)
+		}
+
+		Recent.Parent = InParent;
+		Recent.Child = InChild;
+
+		Edges[NumEdges++] = Recent;
+
+		return (NumEdges == EDGE_LOG_SIZE);
+	}
+};
+
+void AddCallTreeEdge(CThreadIdRecord* InThreadIdRecord, CCallTreeRecord* InParent, CCallTreeRecord* InChild);  // add the edge to the call graph right away (must be called while holding gCriticalSection)
+void FlushEdgeLog(CThreadIdRecord* InThreadIdRecord);  // add the thread's logged edges to the call graph (must be called while holding gCriticalSection)
+void FlushAllEdgeLogs();  // flush the edge log of every thread (must be called while holding gCriticalSection)
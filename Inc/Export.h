@@ -0,0 +1,46 @@
+#pragma once
+
+// The export file is a text file with one record per line and comma separated fields (symbol names are in double quotes).
+// All times are in 100 nanosecond units.
+//
+//    AeonProfile,<version>,<application filename>
+//    PluginColumns,"<column name>",...  (only if the profiler was built with a plugin, see Plugin.h)
+//    Module,<module index>,"<module name>",<image size>,<timestamp>
+//    ThreadActivity,<thread id>,<created>,<first call>,<last activity>,<exited>,<captured>,<busy time>,<bucket duration>,<bucket 0 busy time>,...,<bucket 127 busy time>
+//    Memory,<thread id>,<call tree records>,<cold records>,<hash nodes>,<recycled hash nodes>,<bucket arrays>,<old bucket arrays>,<parent/children tables>,<stack nodes>,<other>,<slack>,<allocated>
+//    Flow,"<flow type>",<flows>,<queue delay sum>,<max queue delay>,<pending flows>,<dropped flows>
+//    FlowFunction,"<flow type>",<Begin|End>,"<symbol name>",<flows>,<queue delay sum>,<max queue delay>
+//    Phase,<phase index>,"<phase name>"
+//    Thread,<thread id>,"<thread symbol name>"
+//    Function,<address>,<module index>,<module offset>,<call count>,<exclusive time sum>,<inclusive time sum>,<max exclusive time>,<max recursion>,"<symbol name>"[,<plugin column value>...]
+//    Intervals,<calls per second>,<burstiness>,<histogram bucket 0 count>,...,<histogram bucket 31 count>
+//    External,<self time sum>,<external time sum>,<self samples>,<external samples>
+//    Durations,<histogram bucket 0 count>,...,<histogram bucket 31 count>
+//    Faults,<measured calls>,<process page faults>,<off-CPU time>
+//    Shape,<shape flags>[,<mode>...]
+//    Outliers,<outlier count>,<max outlier time>[,"<caller symbol name>",<caller outlier count>...]
+//
+// The Module lines come first (one for every module the profiler has seen), followed by a ThreadActivity line for each thread (see
+// ActivityTimeline.h, the times on these lines are since the profiler was loaded and <exited> is -1 if the thread is still running)
+// and a Memory line for each thread with the bytes used by each kind of data structure (see MemoryStats.h).
+// Each Flow line has the queueing delay of the flows of one type that have ended (see Flow.h) and is followed by a FlowFunction line
+// for each function that began those flows and each function that ended them ("(Thread)" if the thread wasn't in an instrumented
+// function).
+// Each Phase line is followed by the Thread lines for the threads that ran during that phase and each Thread line is followed by the
+// Function lines for that thread in that phase.
+// Each Function line is followed by an Intervals line with the statistics about the time between calls (see IntervalStats.h)
+// and an External line with the exclusive time split into time in instrumented code and time in code that isn't (see Sampler.h,
+// the sample counts are 0 if the sampler wasn't running and then all of the exclusive time is self time) and a Durations line with
+// a histogram of the function's inclusive call times (bucketed the same way as the intervals, for percentiles, the counts are estimates
+// once a function has been called more than COLD_STATS_EXACT_CALLS times, see CallTreeRecord.h).  The Faults line has
+// the page faults and off-CPU time of the calls, estimated from the measured calls (all 0 if AEON_FAULT_COUNTERS is off, see
+// FaultCounters.h).  The Shape line has the DURATION_SHAPE_ flags and the modes of that histogram, and the Outliers line has the
+// calls that were much slower than the average and the callers that made most of them ("(Thread)" is the bottom of the thread's
+// stack, see DurationShape.h).
+// The address of a function changes from run to run (ASLR), so files should be compared or merged using the module name,
+// timestamp and module offset of the functions.  The module index is -1 (and the offset is 0) if the function isn't in a module.
+
+#define EXPORT_FILE_VERSION 11
+
+bool ExportProfileData(const char* InFilename);  // export the call tree data for every phase of every thread (returns false on failure)
+bool ExportFlowTrace(const char* InFilename);  // export the flows that have ended as a Chrome trace with flow arrows between the threads (returns false on failure)
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <Windows.h>
+#include <Psapi.h>
+#include <intrin.h>
+
+// Page fault and off-CPU attribution (see OPTION_FAULT_COUNTER_SAMPLE_RATE).  Latency spikes often come from page faults or from the
+// thread being switched out rather than from the code itself.  When this is turned on, the profiler reads the counters when a
+// function is entered and again when it exits and adds the difference to the function's call tree record (these are inclusive of
+// the function's children, like the inclusive time).  Windows doesn't keep a page fault count for each thread, so the page faults are
+// the whole process's page faults during the call (exact for a single busy thread, an upper bound when other threads are faulting at the
+// same time), which is why they are called "process page faults" everywhere they are shown.  The off-CPU time is the wall clock time of
+// the call minus the time the thread actually ran for, which is the time the thread spent switched out (waiting or preempted).  The
+// wall clock time is in RDTSC ticks and QueryThreadCycleTime() counts the thread's own cycles (which don't have to tick at the same
+// rate), so both are converted to 100ns units before they are subtracted (see CalibrateThreadCycles()).
+// Reading the counters takes two system calls, so only every Nth call of each function is measured and the totals are estimated from
+// the measured calls (1 measures every call).  The counters read on enter are kept on a small stack in the CThreadIdRecord (instead of
+// in every StackCallerData_t) and the totals are only written to the CallTreeRecordCold_t on the exit of a measured call.
+
+#define FAULT_COUNTER_STACK_SIZE 64  /* measured calls that can be nested on one thread (calls nested deeper than this aren't measured) */
+#define FAULT_COUNTER_CALIBRATION_SPINS 5  /* CalibrateThreadCycles() keeps the best of this many spins... */
+#define FAULT_COUNTER_CALIBRATION_MS 2  /* ...of this many milliseconds each */
+
+extern int FaultCounterSampleRate;  // measure every Nth call of each function (0 = off)
+extern double ThreadCyclesPerHundredNanoseconds;  // how many cycles QueryThreadCycleTime() counts in 100ns of running (0 if it couldn't be calibrated)
+
+struct FaultCounters_t
+{
+	DWORD64 Ticks;  // RDTSC when the counters were read
+	DWORD64 ThreadCycles;  // from QueryThreadCycleTime()
+	DWORD ProcessPageFaults;  // the whole process's page fault count
+};
+
+inline void ReadFaultCounters(FaultCounters_t& OutCounters)
+{
+	PROCESS_MEMORY_COUNTERS MemoryCounters;
+
+	OutCounters.ProcessPageFaults = GetProcessMemoryInfo(GetCurrentProcess(), &MemoryCounters, sizeof(MemoryCounters)) ? MemoryCounters.PageFaultCount : 0;
+
+	if( !QueryThreadCycleTime(GetCurrentThread(), &OutCounters.ThreadCycles) )
+	{
+		OutCounters.ThreadCycles = 0;
+	}
+
+	OutCounters.Ticks = __rdtsc();
+}
+
+inline double CalibrateThreadCycles(int InTicksPerHundredNanoseconds)  // spin to find how many cycles QueryThreadCycleTime() counts in 100ns (0 if it can't)
+{
+	double BestCyclesPerHundredNanoseconds = 0.0;
+
+	for( int Spin = 0; Spin < FAULT_COUNTER_CALIBRATION_SPINS; Spin++ )
+	{
+		DWORD64 CyclesBefore, CyclesAfter;
+
+		if( !QueryThreadCycleTime(GetCurrentThread(), &CyclesBefore) )
+		{
+			return 0.0;
+		}
+
+		DWORD64 TicksBefore = __rdtsc();
+		DWORD64 TicksAfter = TicksBefore;
+		while( (TicksAfter - TicksBefore) < (DWORD64)InTicksPerHundredNanoseconds * 10000 * FAULT_COUNTER_CALIBRATION_MS )
+		{
+			TicksAfter = __rdtsc();
+		}
+
+		if( !QueryThreadCycleTime(GetCurrentThread(), &CyclesAfter) )
+		{
+			return 0.0;
+		}
+
+		// if the thread was switched out during the spin it counted fewer cycles, so the largest rate is the closest one
+		double CyclesPerHundredNanoseconds = (double)(CyclesAfter - CyclesBefore) * (double)InTicksPerHundredNanoseconds / (double)(TicksAfter - TicksBefore);
+		BestCyclesPerHundredNanoseconds = max(BestCyclesPerHundredNanoseconds, CyclesPerHundredNanoseconds);
+	}
+
+	return BestCyclesPerHundredNanoseconds;
+}
+
+struct FaultCounterStack_t  // the counters read on enter for the measured calls of one thread that haven't exited yet
+{
+	int NumEntries;
+	FaultCounters_t Entries[FAULT_COUNTER_STACK_SIZE];
+
+	void Reset()
+	{
+		NumEntries = 0;
+	}
+
+	bool Push()  // reads the counters for a call that's being entered (returns false if the stack is full and the call can't be measured)
+	{
+		if( NumEntries >= FAULT_COUNTER_STACK_SIZE )
+		{
+			return false;
+		}
+
+		ReadFaultCounters(Entries[NumEntries++]);
+		return true;
+	}
+
+	bool Pop(FaultCounters_t& OutEnterCounters)
+	{
+		if( NumEntries <= 0 )
+		{
+			return false;
+		}
+
+		OutEnterCounters = Entries[--NumEntries];
+		return true;
+	}
+};
+
+struct FaultStats_t  // the counters for one call tree record (only updated for the measured calls)
+{
+	unsigned int MeasuredCalls;
+	__int64 ProcessPageFaults;
+	double OffCpuTime;  // in 100ns units (a double so that calls switched out for less than 100ns still add to it)
+
+	void Reset()
+	{
+		MeasuredCalls = 0;
+		ProcessPageFaults = 0;
+		OffCpuTime = 0.0;
+	}
+
+	void AddCall(const FaultCounters_t& InEnter, const FaultCounters_t& InExit, int InTicksPerHundredNanoseconds, double InThreadCyclesPerHundredNanoseconds)
+	{
+		MeasuredCalls++;
+
+		ProcessPageFaults += (InExit.ProcessPageFaults >= InEnter.ProcessPageFaults) ? (InExit.ProcessPageFaults - InEnter.ProcessPageFaults) : 0;
+
+		if( (InThreadCyclesPerHundredNanoseconds > 0.0) && InEnter.ThreadCycles && InExit.ThreadCycles )
+		{
+			// convert both to time before subtracting (RDTSC ticks and thread cycles aren't the same unit)
+			double WallTime = (double)(InExit.Ticks - InEnter.Ticks) / (double)InTicksPerHundredNanoseconds;
+			double RunTime = (double)(InExit.ThreadCycles - InEnter.ThreadCycles) / InThreadCyclesPerHundredNanoseconds;
+
+			if( WallTime > RunTime )
+			{
+				OffCpuTime += WallTime - RunTime;
+			}
+		}
+	}
+
+	__int64 EstimateTotal(double InMeasuredValue, int InCallCount) const  // scale a measured value up to all of the calls
+	{
+		if( MeasuredCalls == 0 )
+		{
+			return 0;
+		}
+
+		return (__int64)((double)InMeasuredValue * (double)InCallCount / (double)MeasuredCalls);
+	}
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "Allocator.h"
+
+// Flow events (see AeonFlowBegin() and AeonFlowEnd() in AeonProfiler.h).  Work that is handed from one thread to another through a
+// queue has its time split across the threads with nothing linking them together.  The application calls AeonFlowBegin() when the
+// work is enqueued and AeonFlowEnd() with the same flow type and id when it's dequeued, and the time in between (the queueing delay)
+// is added to the flow type and to the instrumented functions that made each call (the function on the top of the calling thread's
+// call stack).  Flows that have begun but not ended are kept in an open addressing table (keyed by flow type and id), and the last
+// MAX_FLOW_EVENTS flows that ended are kept for the Chrome trace export (see ExportFlowTrace()).  All times are in 100ns units.
+
+#define MAX_FLOW_TYPES 64  /* maximum number of unique flow type names */
+#define FLOW_TYPE_NAME_SIZE 64
+#define MAX_FLOW_FUNCTIONS 32  /* enqueuing (or dequeuing) functions tracked for each flow type (flows from any more are only counted in the type) */
+#define MAX_PENDING_FLOWS 65536  /* size of the table of flows that have begun but not ended (must be a power of 2, only 3/4 of it is used) */
+#define MAX_FLOW_EVENTS 65536  /* number of ended flows kept for the trace export (the oldest ones are dropped) */
+
+class CFunctionRecord;
+
+struct FlowFunctionStats_t  // the flows of one type that one function began (or ended)
+{
+	CFunctionRecord* Function;  // null if the thread's call stack was empty
+	unsigned int NumFlows;
+	__int64 QueueDelaySum;
+	__int64 MaxQueueDelay;
+};
+
+struct FlowType_t
+{
+	char Name[FLOW_TYPE_NAME_SIZE];
+
+	unsigned int NumFlows;  // number of flows that have ended
+	__int64 QueueDelaySum;
+	__int64 MaxQueueDelay;
+
+	unsigned int NumPendingFlows;  // flows that have begun but not ended yet
+	unsigned int NumDroppedFlows;  // flows that began when the pending table was full (and so weren't measured)
+
+	int NumBeginFunctions;
+	FlowFunctionStats_t BeginFunctions[MAX_FLOW_FUNCTIONS];
+	int NumEndFunctions;
+	FlowFunctionStats_t EndFunctions[MAX_FLOW_FUNCTIONS];
+};
+
+struct FlowEvent_t  // one flow that has ended
+{
+	int TypeIndex;
+	unsigned __int64 FlowId;
+
+	DWORD BeginThreadId;
+	DWORD EndThreadId;
+	__int64 BeginTime;  // (since the profiler was loaded)
+	__int64 EndTime;
+
+	CFunctionRecord* BeginFunction;
+	CFunctionRecord* EndFunction;
+};
+
+extern FlowType_t FlowTypes[MAX_FLOW_TYPES];
+extern int NumFlowTypes;
+
+extern "C" void AeonFlowBegin(const char* FlowType, unsigned __int64 FlowId);
+extern "C" void AeonFlowEnd(const char* FlowType, unsigned __int64 FlowId);
+
+int CopyFlowEvents(CAllocator* InAllocator, FlowEvent_t*& OutEvents);  // copy the ended flows (oldest first) and return the number of them (must be called while holding gCriticalSection)
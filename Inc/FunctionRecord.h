@@ -0,0 +1,92 @@
+#pragma once
+
+// C RunTime Header Files
+#include <assert.h>
+#include <new>
+
+#include "Allocator.h"
+#include "Hash.h"
+#include "ModuleTable.h"
+
+#define FUNCTION_HASH_TABLE_SIZE 1024  /* default size of hash table for the function records (shared by all threads) */
+
+extern int NumFunctionRecords;
+
+// The CFunctionRecord holds the information about a function that is the same for every thread (the address, the symbol name and
+// the source code location).  There is only one of these for each function in the process, the call tree records of each thread
+// point to it (so the symbol name only has to be looked up and stored once no matter how many threads call the function).
+// Function records are keyed by module relative FunctionKey_t (see CModuleTable) instead of by address, so the key is only
+// 32 bits and stays the same if the module is unloaded and reloaded somewhere else (and the module + offset can be compared
+// between different runs even with ASLR).
+class CFunctionRecord
+{
+public:
+	FunctionKey_t FunctionKey;
+
+	ModuleRecord_t* Module;  // the module that contains this function (null if the address wasn't in any module)
+	unsigned int Offset;  // offset of this function from the start of the module
+
+	const void* Address;  // the address of the function when it was first seen (only used if Module is null)
+
+	char* SymbolName;  // set by the Dialog the first time this function is captured (stored in the SymbolAllocator)
+
+	char* SourceFileName;  // set by the Dialog the first time this function is selected (stored in the SymbolAllocator)
+	int SourceLineNumber;
+
+	CFunctionRecord(FunctionKey_t InFunctionKey, const void* InAddress, ModuleRecord_t* InModule) :
+		FunctionKey( InFunctionKey )
+		,Module( InModule )
+		,Offset( InModule ? (unsigned int)((const char*)InAddress - InModule->BaseAddress) : 0 )
+		,Address( InAddress )
+		,SymbolName( nullptr )
+		,SourceFileName( nullptr )
+		,SourceLineNumber( 0 )
+	{
+		NumFunctionRecords++;
+	}
+
+	~CFunctionRecord()
+	{
+		Module = NULL;
+		Address = NULL;
+		SymbolName = NULL;
+		SourceFileName = NULL;
+
+		NumFunctionRecords--;
+	}
+
+	const void* GetAddress()  // the current address of the function (the module may have been reloaded at a different base address)
+	{
+		return Module ? (const void*)(Module->BaseAddress + Offset) : Address;
+	}
+
+	void PrintStats(char* Header, int NestLevel)
+	{
+	}
+
+	void SetSymbolName(char* InSymbolName)
+	{
+		SymbolName = InSymbolName;
+	}
+
+	void SetSourceLocation(char* InSourceFileName, int InSourceLineNumber)
+	{
+		SourceLineNumber = InSourceLineNumber;
+		SourceFileName = InSourceFileName;
+	}
+
+private:
+	CFunctionRecord(const CFunctionRecord& other)  // copy constructor (this should never get called)
+	{
+		assert(false);
+	}
+
+	CFunctionRecord& operator=(const CFunctionRecord&)  // assignment operator (this should never get called)
+	{
+		assert(false);
+	}
+};
+
+extern CHash<CFunctionRecord, FunctionKey_t>* FunctionHashTable;
+
+CFunctionRecord* LookupFunctionRecord(FunctionKey_t InFunctionKey, const void* InAddress);  // find (or add) the function record for a function key (must be called while holding gCriticalSection)
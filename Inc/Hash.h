@@ -4,13 +4,13 @@
 #include "Allocator.h"
 #include <new>
 
-template <typename T>
+template <typename T, typename K = const void*>  // K is the type of the key (a pointer or an integer no larger than a pointer)
 class CHash
 {
 public:
 	struct Hash_t
 	{
-		const void* key;	// pointer that we have hashed in the hash table (the 'key' of the key/value pair)
+		K key;				// pointer (or integer) that we have hashed in the hash table (the 'key' of the key/value pair)
 		T* value;			// pointer to the record that we are hashing (the 'value' of the key/value pair)
 		Hash_t* Next;		// pointer to the next Hash_t structure in the linked list for this slot (to handle hash collisions)
 	};
@@ -27,12 +27,17 @@ public:
 	unsigned int MaxListLength;		// the length of the longest linked list currently in the hash table
 	unsigned int NumTotalRecords;	// the total number of hash records we have in this hash table
 
+	size_t OldHashTableBytes;		// total size of the arrays left behind by IncreaseHashTableSize() (for memory accounting)
+	unsigned int NumRecycledRecords;	// number of Hash_t structs allocated from those arrays (see AllocateFromOldHashTable())
+
 	CHash(CAllocator* InHashAllocator, int InHashTableSize, bool bInWaitOnMutex = false) :
 		HashAllocator(InHashAllocator)
 		,HashTableSize(InHashTableSize)
 		,NumUsedSlots(0)
 		,MaxListLength(0)
 		,NumTotalRecords(0)
+		,OldHashTableBytes(0)
+		,NumRecycledRecords(0)
 	{
 		HashTable = nullptr;
 		if( HashAllocator && HashTableSize )
@@ -72,6 +77,17 @@ public:
 		}
 	}
 
+	// Get the number of bytes used by this hash table's bucket array and Hash_t structs.  OutOldTableBytes is the part of the old
+	// bucket arrays (left behind when the hash table grew) that hasn't been reused for Hash_t structs and OutRecycledNodeBytes is the
+	// part that has, so none of the bytes are counted twice (the CHash itself isn't included).
+	void GetMemoryUsage(size_t& OutTableBytes, size_t& OutNodeBytes, size_t& OutOldTableBytes, size_t& OutRecycledNodeBytes)
+	{
+		OutTableBytes = HashTable ? (HashTableSize * sizeof(Hash_t*)) : 0;
+		OutRecycledNodeBytes = NumRecycledRecords * sizeof(Hash_t);
+		OutNodeBytes = (NumTotalRecords - NumRecycledRecords) * sizeof(Hash_t);
+		OutOldTableBytes = (OldHashTableBytes > OutRecycledNodeBytes) ? (OldHashTableBytes - OutRecycledNodeBytes) : 0;
+	}
+
 	void** CopyHashToArray(CAllocator* InCopyAllocator, unsigned int& OutArraySize, bool bCopyMemberHashTables)  // copy this hash table to a fixed size array
 	{
 		OutArraySize = 0;
@@ -149,7 +165,7 @@ public:
 		}
 	}
 
-	unsigned long HashPointer(const void* p)  // computes a hash value for a pointer value
+	unsigned long HashPointer(K p)  // computes a hash value for a pointer (or integer) value
 	{
 		unsigned long long a, b, c;
 
@@ -157,7 +173,7 @@ public:
 		a = b = 0x9e3779b9;
 		c = 0;
 
-		a += reinterpret_cast<unsigned long long>(p);
+		a += (unsigned long long)(uintptr_t)p;
 
 		// from https://gist.github.com/badboy/6267743
 		a -= b; a -= c; a ^= (c>>13);
@@ -198,7 +214,7 @@ public:
 		return (void*)FreePointer;
 	}
 
-	T** LookupPointer(const void* InPointer)  // for the given InPointer, return the address of the 'value' pointer in the Hash_t struct
+	T** LookupPointer(K InPointer)  // for the given InPointer, return the address of the 'value' pointer in the Hash_t struct
 	{
 		// hash the input pointer and find the record, if it doesn't exist then add a new record to the hash table
 		unsigned long hash = HashPointer(InPointer);
@@ -234,6 +250,7 @@ public:
 		if( OldHashTable )  // if we have an old hash table (after re-sizing), use that space to allocate a new Hash_t record
 		{
 			pNewHashRec = (Hash_t*)AllocateFromOldHashTable();
+			NumRecycledRecords++;
 		}
 		else
 		{
@@ -295,11 +312,27 @@ public:
 		return &pNewHashRec->value;
 	}
 
+	void ResizeEmptyHashTable(int InHashTableSize)  // make a hash table that nothing has been added to yet bigger (the old array is used for Hash_t records, like after IncreaseHashTableSize())
+	{
+		if( (NumTotalRecords != 0) || (InHashTableSize <= HashTableSize) || (HashAllocator == nullptr) )
+		{
+			return;
+		}
+
+		OldHashTableFreeRemaining = HashTableSize * sizeof(Hash_t*);
+		OldHashTable = HashTable;
+		OldHashTableBytes += OldHashTableFreeRemaining;
+
+		HashTableSize = InHashTableSize;
+		HashTable = (volatile Hash_t**)HashAllocator->AllocateBytes(HashTableSize * sizeof(Hash_t*), sizeof(void*));
+	}
+
 	void IncreaseHashTableSize()  // increase the size of this hash table to reduce collisions
 	{
 		volatile int OldHashTableSize = HashTableSize;
 		OldHashTableFreeRemaining = OldHashTableSize * sizeof(Hash_t*);
 		OldHashTable = HashTable;
+		OldHashTableBytes += OldHashTableFreeRemaining;  // (whatever was left of the previous old hash table is lost)
 
 		HashTableSize = HashTableSize * 2;
 		HashTable = (volatile Hash_t**)HashAllocator->AllocateBytes(HashTableSize * sizeof(Hash_t*), sizeof(void*));
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Windows.h>
+#include <intrin.h>
+#include <math.h>
+
+#define INTERVAL_HISTOGRAM_BUCKETS 32  /* bucket 0 is less than 100ns, bucket N is 2^(N-1) to 2^N times 100ns (the last bucket also holds anything longer) */
+
+inline unsigned long GetHistogramBucket(__int64 InValue)  // log2 bucket for a value in 100ns units (see INTERVAL_HISTOGRAM_BUCKETS)
+{
+	unsigned long Bucket = 0;
+
+	if( InValue > 0 )
+	{
+#if _M_X64
+		_BitScanReverse64(&Bucket, (unsigned __int64)InValue);
+#else
+		if( _BitScanReverse(&Bucket, (unsigned long)((unsigned __int64)InValue >> 32)) )
+		{
+			Bucket += 32;
+		}
+		else
+		{
+			_BitScanReverse(&Bucket, (unsigned long)InValue);
+		}
+#endif
+		Bucket = min(Bucket + 1, (unsigned long)(INTERVAL_HISTOGRAM_BUCKETS - 1));
+	}
+
+	return Bucket;
+}
+
+// Statistics about the time between one call to a function and the next (from entry to entry).  These tell us whether a
+// function is called at a steady rate or in bursts (functions that are called in bursts are good candidates for batching).
+// The intervals are summed in CPU ticks and only converted when they are read, so intervals shorter than 100ns still add to the sums.
+// Only some of the calls add their interval (see CCallTreeRecord::GetColdStatsWeight()), each one is added with the number of calls it stands for.
+struct IntervalStats_t
+{
+	unsigned int NumIntervals;  // (weighted)
+	unsigned __int64 IntervalTickSum;  // in CPU ticks
+	double IntervalTickSumOfSquares;  // in CPU ticks squared (for the standard deviation)
+
+	unsigned int Histogram[INTERVAL_HISTOGRAM_BUCKETS];  // log2 bucketed count of the intervals (in 100ns units, weighted)
+
+	void AddInterval(DWORD64 InIntervalTicks, unsigned int InWeight, int InTicksPerHundredNanoseconds)
+	{
+		Histogram[GetHistogramBucket((__int64)InIntervalTicks / InTicksPerHundredNanoseconds)] += InWeight;
+
+		NumIntervals += InWeight;
+		IntervalTickSum += InIntervalTicks * InWeight;
+		IntervalTickSumOfSquares += (double)InIntervalTicks * (double)InIntervalTicks * (double)InWeight;
+	}
+
+	void Reset()
+	{
+		memset(this, 0, sizeof(IntervalStats_t));
+	}
+
+	float GetCallsPerSecond(int InTicksPerHundredNanoseconds) const  // the average call rate (while the function was being called, not over the whole run)
+	{
+		if( (NumIntervals == 0) || (IntervalTickSum == 0) )
+		{
+			return 0.f;
+		}
+
+		return (float)((double)NumIntervals * 10000000.0 * (double)InTicksPerHundredNanoseconds / (double)IntervalTickSum);
+	}
+
+	float GetBurstiness() const  // (stddev - mean) / (stddev + mean) of the intervals: -1 is perfectly regular, 0 is random, approaching 1 is bursty
+	{
+		if( NumIntervals < 2 )
+		{
+			return 0.f;
+		}
+
+		double Mean = (double)IntervalTickSum / (double)NumIntervals;  // (the burstiness doesn't depend on the units)
+		double Variance = (IntervalTickSumOfSquares / (double)NumIntervals) - (Mean * Mean);
+		double StdDev = (Variance > 0.0) ? sqrt(Variance) : 0.0;
+
+		if( (StdDev + Mean) <= 0.0 )
+		{
+			return 0.f;
+		}
+
+		return (float)((StdDev - Mean) / (StdDev + Mean));
+	}
+};
+
+// Percentile of a histogram of values bucketed by GetHistogramBucket() (InPercentile is 0 to 100).  The value is interpolated within
+// the bucket it falls in, so it's only accurate to within a factor of 2.
+inline __int64 GetHistogramPercentile(const unsigned int* InHistogram, float InPercentile)
+{
+	unsigned __int64 Count = 0;
+	for( int Bucket = 0; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+	{
+		Count += InHistogram[Bucket];
+	}
+
+	if( Count == 0 )
+	{
+		return 0;
+	}
+
+	double Target = (double)Count * (double)InPercentile / 100.0;
+	double Cumulative = 0.0;
+
+	for( int Bucket = 0; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+	{
+		if( InHistogram[Bucket] && (Cumulative + InHistogram[Bucket] >= Target) )
+		{
+			if( Bucket == 0 )
+			{
+				return 0;
+			}
+
+			double BucketStart = (double)(1ULL << (Bucket - 1));
+			double Fraction = (Target - Cumulative) / (double)InHistogram[Bucket];
+
+			return (__int64)(BucketStart + (BucketStart * Fraction));  // (bucket N covers 2^(N-1) to 2^N)
+		}
+
+		Cumulative += InHistogram[Bucket];
+	}
+
+	return (__int64)1 << (INTERVAL_HISTOGRAM_BUCKETS - 1);
+}
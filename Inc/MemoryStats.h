@@ -0,0 +1,7 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "AeonProfiler.h"  // (AeonMemoryStats and AeonGetMemoryStats() are part of the application's header, see CThreadIdRecord::GetMemoryStats() for what each field counts)
+
+int GetMemoryStats(AeonMemoryStats* OutStats, int InMaxThreads, DWORD64& OutPauseTime);  // AeonGetMemoryStats() that also returns how long the threads were blocked (in CPU ticks)
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "Allocator.h"
+
+#define MODULE_NAME_SIZE 64  /* length of the module base name that we store (the path is not stored) */
+#define MAX_MODULES 4096  /* maximum number of modules (including unloaded ones) that we will track */
+#define MODULE_KEY_ALIGNMENT 0x10000  /* each module's range of function keys starts on a 64KB boundary */
+#define UNTRACKED_KEY_BASE 0xF0000000  /* module keys are below this, keys from here up are for addresses that aren't in a module we can track (one key per address) */
+#define UNTRACKED_ADDRESS_TABLE_SIZE 0x10000  /* number of untracked addresses that get their own key (must be a power of 2) */
+#define UNTRACKED_OVERFLOW_KEY (UNTRACKED_KEY_BASE + UNTRACKED_ADDRESS_TABLE_SIZE)  /* shared by all of the untracked addresses once the table is full */
+#define DYNAMIC_MODULE_CHECK_MS 100  /* how often (at most) a range of dynamic code is checked to see if it has been freed */
+
+typedef unsigned int FunctionKey_t;  // module relative function key (the module's KeyBase plus the offset of the function in the module), 0 is never a valid key
+
+inline bool IsUntrackedFunctionKey(FunctionKey_t InFunctionKey)  // true if the key isn't module relative (see CModuleTable::GetUntrackedKey())
+{
+	return InFunctionKey >= UNTRACKED_KEY_BASE;
+}
+
+struct ModuleRecord_t
+{
+	const char* BaseAddress;  // the address the module was loaded at
+	size_t Size;  // SizeOfImage from the module's PE header
+	DWORD TimeDateStamp;  // from the module's PE header (so we can tell different builds of the same module apart)
+	char Name[MODULE_NAME_SIZE];  // base name of the module (i.e. "MyGame.exe")
+
+	int Index;  // index of this module in the table (modules are never removed from the table, so this never changes)
+	FunctionKey_t KeyBase;  // function keys for this module are KeyBase + offset (this stays the same if the module is unloaded and reloaded at a different address)
+	bool bIsLoaded;  // false once the module has been unloaded (the record is kept so that it can be reused if the module is loaded again)
+	bool bIsDynamic;  // true if this is a range of dynamically allocated code rather than a loaded image
+	volatile ULONGLONG CheckedTime;  // GetTickCount64() when the dynamic range was last checked to see if it's still allocated (see IsDynamicModuleValid())
+
+	volatile unsigned char* CoverageBitmap;  // one bit for each byte offset in the module (bit is set when a function at that offset has been called)
+	volatile unsigned char* CoverageExitBitmap;  // one bit for each byte offset in the module (bit is set when the _pexit call at that offset has been handled)
+};
+
+struct ModuleArray_t  // a sorted (by BaseAddress) array of module record pointers, this is never modified once it has been published
+{
+	int NumModules;
+	ModuleRecord_t* Modules[1];  // variable length array of NumModules pointers
+};
+
+class CModuleTable  // table of the modules that contain profiled code (lookups are lock free, adding a module takes a lock)
+{
+private:
+	CAllocator ModuleAllocator;  // allocator for the module records (memory is never freed, so old ModuleArray_t arrays remain valid for readers)
+
+	CRITICAL_SECTION ModuleCriticalSection;  // only held while adding or removing a module
+
+	volatile ModuleArray_t* SortedModules;  // the currently loaded modules
+
+	ModuleRecord_t* AllModules[MAX_MODULES];  // every module that we have seen (in the order they were added), indexed by ModuleRecord_t::Index
+	volatile int NumAllModules;
+
+	unsigned long long NextKeyBase;  // KeyBase for the next new module (64 bits so that we can detect running out of keys below UNTRACKED_KEY_BASE)
+
+	const void* volatile* UntrackedAddresses;  // open addressed table of the addresses that aren't in a module, the key is UNTRACKED_KEY_BASE plus the index (allocated when first needed)
+	bool bIsUntrackedTableFull;
+
+	bool bAllocateCoverageBitmaps;  // whether each new module needs coverage bitmaps allocated for it
+
+	void* DllNotificationCookie;  // from LdrRegisterDllNotification (so we can tell when a module has been unloaded)
+
+	ModuleRecord_t* AddModule(const void* Address);
+	bool IsDynamicModuleValid(ModuleRecord_t* Module);  // false if the range of dynamic code has been freed
+	FunctionKey_t GetUntrackedKey(const void* Address);
+	void PublishSortedModules(ModuleRecord_t* InsertModule, ModuleRecord_t* RemoveModule);  // must be called with ModuleCriticalSection held
+
+	static void CALLBACK DllNotification(ULONG NotificationReason, const void* NotificationData, void* Context);
+
+public:
+	CModuleTable(bool bInAllocateCoverageBitmaps = false);
+	~CModuleTable();
+
+	ModuleRecord_t* FindModule(const void* Address, bool bAddModule = true);  // find the module that contains Address (the module is added to the table if it's not there yet and bAddModule is true, ModuleCriticalSection is never taken if bAddModule is false)
+
+	FunctionKey_t GetFunctionKey(const void* Address, ModuleRecord_t** OutModule = nullptr);  // if Address isn't in any module, this returns a key from GetUntrackedKey() (and OutModule is null)
+
+	void RemoveModule(const void* BaseAddress);  // called when a module is unloaded (the record stays in the table, but it's no longer found by address)
+
+	int GetNumModules();  // number of modules that we have seen (including unloaded ones)
+	ModuleRecord_t* GetModule(int Index);
+};
+
+extern CModuleTable* gModuleTable;
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Windows.h>
+
+#define MAX_PHASES 64  /* maximum number of unique phase names (each thread keeps a separate set of call tree records for each phase) */
+#define PHASE_NAME_SIZE 64
+
+struct PhaseRecord_t
+{
+	char Name[PHASE_NAME_SIZE];
+	DWORD64 StartTime;  // the time (in CPU ticks) that this phase was most recently started
+};
+
+extern PhaseRecord_t Phases[MAX_PHASES];
+extern int NumPhases;
+extern int CurrentPhaseIndex;  // the phase that all threads are currently collecting call tree data for
+
+extern int DialogPhaseIndex;  // the phase to display in the Dialog (-1 means whatever phase is current when the data is captured)
+
+extern "C" void AeonPhaseBegin(const char* PhaseName);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "CallerData.h"
+
+// Compile time collector plugin.  To add your own per function metrics, write a header that defines a class named CAeonPlugin
+// (with everything that the default one below has) and build the profiler with AEON_PLUGIN_HEADER defined as the name of that
+// header (for example, /DAEON_PLUGIN_HEADER=\"MyPlugin.h\").  The plugin's functions are called directly (there are no virtual
+// functions), so a plugin costs only what its OnEnter()/OnExit() cost and the default plugin costs nothing at all.
+//
+// Every call tree record (one per function, per thread, per phase) gets its own Payload_t, stored right after the
+// CCallTreeRecord (in the thread's CallTreeRecordAllocator).  The payload starts out zeroed and is zeroed again when the
+// counters are reset.  OnEnter() and OnExit() are called with gCriticalSection held, on the thread making the call (except when
+// the phase changes, then the thread that called AeonPhaseBegin() calls OnExit() and OnEnter() for the calls on every thread's stack).
+//
+// Each of the plugin's columns is shown (after the built in columns) in the Functions and Children windows of the viewer and
+// is added to the Function lines of the export file.  Column values are 64 bit integers (so they can be sorted).
+
+#ifdef AEON_PLUGIN_HEADER
+
+#include AEON_PLUGIN_HEADER
+
+#else
+
+class CAeonPlugin  // the default plugin (doesn't do anything)
+{
+public:
+	struct Payload_t
+	{
+	};
+
+	static const int NumColumns = 0;
+
+	static const char* GetColumnName(int Column) { return nullptr; }
+	static __int64 GetColumnValue(const Payload_t& Payload, int Column) { return 0; }
+
+	static void OnEnter(Payload_t& Payload, const CallerData_t& Call) {}
+	static void OnExit(Payload_t& Payload, const CallerData_t& Call, __int64 CallDuration) {}  // CallDuration is in 100ns units
+};
+
+#endif
+
+#define AEON_PLUGIN_PAYLOAD_SIZE ((CAeonPlugin::NumColumns > 0) ? sizeof(CAeonPlugin::Payload_t) : 0)  /* the default plugin doesn't use any memory */
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Windows.h>
+
+// External time sampler (see OPTION_EXTERNAL_SAMPLE_INTERVAL).  Time spent in code that isn't instrumented (the C runtime, the
+// Windows DLLs, the kernel, etc.) shows up as exclusive time of the instrumented function that called it.  To tell these apart, a
+// thread periodically suspends each profiled thread, reads the thread's instruction pointer and counts a "self" sample for the
+// function on the top of the thread's call stack if the instruction pointer is in an instrumented module, or an "external" sample
+// if it isn't.  The function's exclusive time is then split between self time and external time by the ratio of those samples.
+// Samples taken while the thread is in the profiler itself are thrown away.
+//
+// Line samples (see OPTION_LINE_SAMPLES).  Exclusive time says which function is slow but not which loop in it.  When this is turned
+// on, the sampler also counts the self samples by instruction pointer for the function on the top of the call stack, and the
+// TextViewer shows the number of samples next to each line of the function's source (the instruction pointers are only looked up
+// in the symbols when the source is displayed, see LoadTextLineSamples()).
+
+class CFunctionRecord;
+class CAllocator;
+
+struct LineSample_t  // the self samples of one function at one instruction pointer
+{
+	const void* Address;  // the instruction pointer
+	CFunctionRecord* Function;  // the instrumented function that was on the top of the call stack
+	LONG Samples;
+	LineSample_t* Next;  // the next function sampled at the same instruction pointer (a function that isn't instrumented can be called from several)
+};
+
+extern DWORD SamplerTlsIndex;  // TLS slot holding a pointer to the current thread's CThreadIdRecord::bIsInProfiler (TLS_OUT_OF_INDEXES if the sampler isn't running)
+
+void StartSampler(int InIntervalMilliseconds, bool bInSampleLines);  // start the sampler thread (does nothing if InIntervalMilliseconds is 0)
+void StopSampler();  // tell the sampler thread to stop (called when the DLL is unloaded)
+
+int CopyLineSamples(CFunctionRecord* InFunction, CAllocator* InAllocator, LineSample_t*& OutSamples);  // copy the function's line samples to an array (returns the number of entries)
+
+inline volatile LONG* GetInProfilerFlag()  // returns null if the sampler isn't running or this thread doesn't have a CThreadIdRecord yet
+{
+	return (SamplerTlsIndex != TLS_OUT_OF_INDEXES) ? (volatile LONG*)TlsGetValue(SamplerTlsIndex) : nullptr;
+}
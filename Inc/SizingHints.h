@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Windows.h>
+
+// Sizing hints (see OPTION_SIZING_HINTS_FILE).  At exit we record how big each thread's call tree hash table got (by the thread's
+// entry function) and how many parents and children each function had.  On the next run the hash tables are created at that size
+// (and the thread's allocators reserve the memory they used last time) so we don't keep growing them while the program starts up.
+// Functions are matched by module name, size, timestamp and module offset, so the hints for a module are ignored once it's rebuilt.
+
+#define SIZING_HINTS_FILE_MAGIC "AEONSZH1"
+
+class CThreadIdRecord;
+class CFunctionRecord;
+
+void ReadSizingHintsFile(const char* InFilename);  // read the hints from the previous run (called once when the DLL is loaded)
+void WriteSizingHintsFile(const char* InFilename);  // write the hints for this run (called when the DLL is unloaded)
+
+void ApplyThreadSizingHints(CThreadIdRecord* InThreadIdRecord, CFunctionRecord* InEntryFunction);  // called on a thread's first call (must be called while holding gCriticalSection)
+int GetParentHashTableSize(CFunctionRecord* InFunction, int InDefaultSize);  // returns the size for a new ParentHashTable (must be called while holding gCriticalSection)
+int GetChildrenHashTableSize(CFunctionRecord* InFunction, int InDefaultSize);  // returns the size for a new ChildrenHashTable (must be called while holding gCriticalSection)
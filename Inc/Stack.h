@@ -20,9 +20,11 @@ struct DialogStackCallerData_t
 struct StackCallerData_t
 {
 	DWORD ThreadId;
+	bool bFaultCountersRead;  // whether this call is one of the calls measured for FaultCounters.h (the counters are on the CThreadIdRecord's FaultCounterStack)
 	DWORD64 Counter;
 	__int64 ProfilerOverhead;  // the total amount of time spent in the profiler tracking this call
 	const void* CallerAddress;
+	FunctionKey_t FunctionKey;  // module relative key for CallerAddress (this is what the call tree records are hashed by)
 	class CCallTreeRecord* CurrentCallTreeRecord;  // pointer to the current function's CallTreeRecord_t (so child can update parent's inclusive time for the current call)
 };
 
@@ -184,6 +186,7 @@ public:
 			pNode->value.CurrentCallTreeRecord->CallCount = 1;
 			pNode->value.CurrentCallTreeRecord->StackDepth = 1;
 			pNode->value.CurrentCallTreeRecord->MaxRecursionLevel = 1;
+			pNode->value.CurrentCallTreeRecord->EnterTime = TimeNow;  // (CCallTreeRecord::ResetCounters() cleared it, the capture only adds the in progress time of records with an EnterTime)
 
 			index++;
 			pNode = pNode->Next;
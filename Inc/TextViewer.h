@@ -1,6 +1,8 @@
 
 #pragma once
 
+#define TEXTVIEWER_SAMPLES_GUTTER_CHARS 8  /* width of the column of line samples on the left of the text (when there are line samples) */
+
 struct TextLineNode  // linked list pointing to the start of each line
 {
 	char* text;
@@ -13,8 +15,13 @@ struct TextLineBuffer
 	int num_lines;  // number of text lines in the buffer
 	int max_line_length;  // length of the longest line (with tabs replaced by 4 spaces), so we know how wide to make the horizontal scroll bar
 	int current_line_index;  // the line that should be displayed at the center of the window
+	int* line_samples;  // number of samples on each line (null if there aren't any line samples for the file, see LoadTextLineSamples())
+	int max_line_samples;  // the most samples on any line (for the heat color)
 };
 
+class CFunctionRecord;
+
 void LoadTextFile(char* filename);
 void InitializeTextLineBuffer(char* buffer, int length);
+void LoadTextLineSamples(CFunctionRecord* InFunction);  // add up the function's line samples (see Sampler.h) on each line of the loaded file
 
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Windows.h>
+
+// Thread groups.  Thread pools have many threads that all run the same code, so looking at them one at a time isn't very useful.
+// After each capture, the threads are grouped by the function at the bottom of their stack (their entry function), or by the
+// start of their thread name (SetThreadDescription()) if it matches one of the prefixes in OPTION_THREAD_GROUP_PREFIXES, and a
+// combined copy of the call tree data is made for each group (each group is merged on its own thread pool thread).  The groups
+// are added to the end of the CaptureCallTreeThreadArrayPointer array with a ThreadId of THREAD_GROUP_ID_BASE or more, so they
+// can be selected in the ThreadID dialog just like a thread.  Each group gets the next id the first time it is seen, and keeps
+// that id in later captures.
+
+#define THREAD_GROUP_ID_BASE 0xFFFF0000  /* thread ids of the thread groups start here (Windows thread ids are never this big) */
+#define THREAD_GROUP_NAME_SIZE 256
+#define MIN_ENTRY_FUNCTION_GROUP_THREADS 2  /* only group threads by their entry function if at least this many threads have it */
+
+void BuildThreadGroups();  // add the thread groups for the captured call tree data (called after the symbols have been looked up)
+void FreeThreadGroups();  // free the memory used by the thread groups (called before the DialogAllocator is freed)
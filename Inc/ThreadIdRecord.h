@@ -8,8 +8,14 @@
 #include "Allocator.h"
 #include "Stack.h"
 #include "Hash.h"
+#include "Phase.h"
+#include "ActivityTimeline.h"
+#include "MemoryStats.h"
+#include "CallTreeColumns.h"
+#include "EdgeLog.h"
 
 extern int NumThreads;
+extern int TicksPerHundredNanoseconds;
 
 struct DialogThreadIdRecord_t  // "static" copy of CThreadIdRecord for the Dialog to display data that's not constantly changing
 {
@@ -25,35 +31,102 @@ struct DialogThreadIdRecord_t  // "static" copy of CThreadIdRecord for the Dialo
 
 	DWORD ThreadId;
 	char* SymbolName;
+
+	ThreadActivity_t* Activity;  // the thread's lifetime and activity timeline
+
+	unsigned int NumGroupThreads;  // 0 for a thread, the number of threads for a thread group (see ThreadGroups.h)
+
+	CallTreeColumns_t* Columns;  // columnar copy of the CallTreeArray (null until the capture has been processed, see CallTreeColumns.h)
 };
 
 class CThreadIdRecord
 {
 public:
 	CAllocator* ThreadIdRecordAllocator;  // allocator for this specific thread
+	CAllocator* CallTreeRecordAllocator;  // allocator for this thread's CCallTreeRecords (nothing else is allocated from this, so the records are packed one per cache line)
 
 	CStack* CallStack;  // the current call stack for this thread
-	CHash<CCallTreeRecord>* CallTreeHashTable;
+	CHash<CCallTreeRecord, FunctionKey_t>* CallTreeHashTable;  // the call tree records for the current phase (this is one of the PhaseCallTreeHashTables)
+
+	CHash<CCallTreeRecord, FunctionKey_t>* PhaseCallTreeHashTables[MAX_PHASES];  // the call tree records for each phase (null if this thread hasn't run during that phase)
+	int PhaseIndex;  // the phase this thread is currently collecting data for
+	int CallTreeHashTableSize;  // initial size of the call tree hash table for each phase (see ApplySizingHints)
+
+	CFunctionRecord* EntryFunction;  // the first function this thread called (this identifies the thread in the sizing hints file)
+
+	EdgeLog_t* EdgeLog;  // edges that haven't been added to the call graph yet (null unless bDeferredEdges is set, see EdgeLog.h)
+	FaultCounterStack_t* FaultCounterStack;  // the enter counters of the measured calls (null unless FaultCounterSampleRate is set, see FaultCounters.h)
+
+	volatile LONG bIsInProfiler;  // set while this thread is in CallerEnter()/CallerExit() (so the sampler doesn't count those samples, see Sampler.h)
+	HANDLE SamplerThreadHandle;  // handle the sampler uses to suspend this thread (null until the sampler opens it)
+	bool bSamplerSawExit;  // set by the sampler once it has seen this thread exit (so it stops opening the thread)
+
+	HANDLE ThreadHandle;  // kept open until we've seen the thread exit (use TakeThreadHandle() and ReturnThreadHandle(), see UpdateThreadTimes())
+	bool bHasCreateTime;  // whether CreateTime has been read from the thread yet
+	__int64 CreateTime;  // when the thread was created (in 100ns units since the profiler was loaded)
+	__int64 ExitTime;  // when the thread exited (-1 until UpdateThreadTimes() has seen it exit)
+	DWORD64 FirstCallTime;  // CPU ticks of the thread's first call
+	DWORD64 LastActivityTime;  // CPU ticks of the thread's last enter or exit
+	DWORD64 BusyStartTime;  // CPU ticks when the thread's call stack last went from empty to not empty
+	ActivityTimeline_t* Timeline;  // (allocated from the ThreadIdRecordAllocator)
 
 	DWORD ThreadId;
 	char* SymbolName;
 
-	CThreadIdRecord(DWORD InThreadId, CAllocator& InAllocator) :
+	CThreadIdRecord(DWORD InThreadId, CAllocator* InThreadIdRecordAllocator, CAllocator* InCallTreeRecordAllocator) :
 		ThreadId( InThreadId )
 	{
 		CallStack = nullptr;
 		CallTreeHashTable = nullptr;
 
-		// create an allocator specifically for this thread
-		ThreadIdRecordAllocator = (CAllocator*)InAllocator.AllocateBytes(sizeof(CAllocator), sizeof(void*));
+		memset(PhaseCallTreeHashTables, 0, sizeof(PhaseCallTreeHashTables));
+		PhaseIndex = CurrentPhaseIndex;  // new threads start out in whatever phase the other threads are in
+		CallTreeHashTableSize = CALLRECORD_HASH_TABLE_SIZE;
+		EntryFunction = nullptr;
+		EdgeLog = nullptr;
+		FaultCounterStack = nullptr;
+
+		bIsInProfiler = 0;
+		SamplerThreadHandle = nullptr;
+		bSamplerSawExit = false;
+
+		ThreadHandle = nullptr;
+		bHasCreateTime = false;
+		CreateTime = 0;
+		ExitTime = -1;
+		FirstCallTime = 0;
+		LastActivityTime = 0;
+		BusyStartTime = 0;
+		Timeline = nullptr;
+
+		ThreadIdRecordAllocator = InThreadIdRecordAllocator;
+		CallTreeRecordAllocator = InCallTreeRecordAllocator;
 
 		if( ThreadIdRecordAllocator )
 		{
-			CallStack = (CStack*)ThreadIdRecordAllocator->AllocateBytes(sizeof(CStack), sizeof(void*));
+			// the stack's pTop and StackSize are written on every call, so keep them on a cache line of their own
+			CallStack = (CStack*)ThreadIdRecordAllocator->AllocateBytes(CACHE_LINE_ALIGNED_SIZE(sizeof(CStack)), CACHE_LINE_SIZE);
 			new(CallStack) CStack(ThreadIdRecordAllocator);
 
-			CallTreeHashTable = (CHash<CCallTreeRecord>*)ThreadIdRecordAllocator->AllocateBytes(sizeof(CHash<CCallTreeRecord>), sizeof(void*));
-			new(CallTreeHashTable) CHash<CCallTreeRecord>(ThreadIdRecordAllocator, CALLRECORD_HASH_TABLE_SIZE);
+			CallTreeHashTable = (CHash<CCallTreeRecord, FunctionKey_t>*)ThreadIdRecordAllocator->AllocateBytes(sizeof(CHash<CCallTreeRecord, FunctionKey_t>), sizeof(void*));
+			new(CallTreeHashTable) CHash<CCallTreeRecord, FunctionKey_t>(ThreadIdRecordAllocator, CALLRECORD_HASH_TABLE_SIZE);
+
+			PhaseCallTreeHashTables[PhaseIndex] = CallTreeHashTable;
+
+			Timeline = (ActivityTimeline_t*)ThreadIdRecordAllocator->AllocateBytes(sizeof(ActivityTimeline_t), sizeof(__int64));
+			Timeline->Reset();
+
+			if( bDeferredEdges )
+			{
+				EdgeLog = (EdgeLog_t*)ThreadIdRecordAllocator->AllocateBytes(sizeof(EdgeLog_t), sizeof(void*));
+				EdgeLog->Reset();
+			}
+
+			if( FaultCounterSampleRate > 0 )
+			{
+				FaultCounterStack = (FaultCounterStack_t*)ThreadIdRecordAllocator->AllocateBytes(sizeof(FaultCounterStack_t), sizeof(DWORD64));
+				FaultCounterStack->Reset();
+			}
 		}
 
 		NumThreads++;
@@ -71,6 +144,13 @@ public:
 
 		ThreadIdRecordAllocator = nullptr;
 
+		if( CallTreeRecordAllocator )
+		{
+			CallTreeRecordAllocator->FreeBlocks();
+		}
+
+		CallTreeRecordAllocator = nullptr;
+
 		NumThreads--;
 	}
 
@@ -91,9 +171,22 @@ public:
 			ThreadIdRecordAllocator->PrintStats("ThreadIdRecordAllocator - ", NestLevel + 1);
 		}
 
-		if( CallTreeHashTable )
+		if( CallTreeRecordAllocator )
 		{
-			CallTreeHashTable->PrintStats("CallTreeHashTable - ", NestLevel + 1);
+			CallTreeRecordAllocator->PrintStats("CallTreeRecordAllocator - ", NestLevel + 1);
+		}
+
+		for( int index = 0; index < NumPhases; index++ )
+		{
+			if( PhaseCallTreeHashTables[index] )
+			{
+				char PhaseHeader[PHASE_NAME_SIZE + 32];
+				strcpy_s(PhaseHeader, sizeof(PhaseHeader), "CallTreeHashTable (");
+				strcat_s(PhaseHeader, sizeof(PhaseHeader), Phases[index].Name);
+				strcat_s(PhaseHeader, sizeof(PhaseHeader), ") - ");
+
+				PhaseCallTreeHashTables[index]->PrintStats(PhaseHeader, NestLevel + 1);
+			}
 		}
 	}
 
@@ -116,10 +209,18 @@ public:
 
 		pRec->ThreadId = ThreadId;
 		pRec->SymbolName = SymbolName;
+		pRec->NumGroupThreads = 0;
+		pRec->Columns = nullptr;
+
+		int CopyPhaseIndex = (DialogPhaseIndex >= 0) ? DialogPhaseIndex : PhaseIndex;
 
 		if( CallStack && CallStack->pBottom )  // copy the thread's Stack
 		{
-			pRec->StackArray = CallStack->CopyStackToArray(InCopyAllocator, pRec->StackArraySize);
+			// the records on the stack belong to the current phase, so only copy the stack when copying the current phase
+			if( CopyPhaseIndex == PhaseIndex )
+			{
+				pRec->StackArray = CallStack->CopyStackToArray(InCopyAllocator, pRec->StackArraySize);
+			}
 
 			StackCallerData_t& StackBottomCallerData = CallStack->pBottom->value;
 			pRec->Address = StackBottomCallerData.CallerAddress;
@@ -129,20 +230,26 @@ public:
 			pRec->Address = nullptr;
 		}
 
-		if( CallTreeHashTable )  // copy the thread's CallTreeHashTable
+		if( PhaseCallTreeHashTables[CopyPhaseIndex] )  // copy the thread's CallTreeHashTable for the phase
 		{
-			pRec->CallTreeArray = CallTreeHashTable->CopyHashToArray(InCopyAllocator, pRec->CallTreeArraySize, true);
+			pRec->CallTreeArray = PhaseCallTreeHashTables[CopyPhaseIndex]->CopyHashToArray(InCopyAllocator, pRec->CallTreeArraySize, true);
 		}
 
+		pRec->Activity = (ThreadActivity_t*)InCopyAllocator->AllocateBytes(sizeof(ThreadActivity_t), sizeof(__int64));
+		GetThreadActivity(*pRec->Activity, __rdtsc());
+
 		return (void*)pRec;
 	}
 
 	void ResetCounters(DWORD64 TimeNow)
 	{
-		// reset the calltree records in the hash table first (the calltree records on the stack need special handling)
-		if( CallTreeHashTable )
+		// reset the calltree records in the hash tables first (the calltree records on the stack need special handling)
+		for( int index = 0; index < NumPhases; index++ )
 		{
-			CallTreeHashTable->ResetCounters(TimeNow);
+			if( PhaseCallTreeHashTables[index] )
+			{
+				PhaseCallTreeHashTables[index]->ResetCounters(TimeNow);
+			}
 		}
 
 		// reset the calltree records on the stack last (to set the proper CallCount and MaxRecursionLevel)
@@ -152,11 +259,334 @@ public:
 		}
 	}
 
+	void EndBusyPeriod(DWORD64 TimeNow)  // called when the thread's call stack becomes empty
+	{
+		if( Timeline )
+		{
+			Timeline->AddBusyTime(GetProfilerTime(BusyStartTime), GetProfilerTime(TimeNow));
+		}
+	}
+
+	void GetThreadActivity(ThreadActivity_t& OutActivity, DWORD64 TimeNow)  // (must be called while holding gCriticalSection, call FinishThreadActivity() after leaving it)
+	{
+		OutActivity.CaptureTime = GetProfilerTime(TimeNow);
+		OutActivity.FirstCallTime = GetProfilerTime(FirstCallTime);
+		OutActivity.LastActivityTime = GetProfilerTime(LastActivityTime);
+		OutActivity.CreateTime = OutActivity.FirstCallTime;  // (FinishThreadActivity() fills in the thread's times)
+		OutActivity.ExitTime = -1;
+		OutActivity.BusyStartTime = (CallStack && !CallStack->IsEmpty()) ? GetProfilerTime(BusyStartTime) : -1;
+
+		if( Timeline )
+		{
+			OutActivity.Timeline = *Timeline;
+		}
+		else
+		{
+			OutActivity.Timeline.Reset();
+		}
+	}
+
+	// The thread's handle is only used outside of gCriticalSection (GetThreadTimes() and the like are system calls).  Whoever uses it takes
+	// it out of the record first, so two threads never use it at the same time and it can't be closed while another thread is using it.
+	HANDLE TakeThreadHandle()
+	{
+		return (HANDLE)InterlockedExchangePointer(&ThreadHandle, nullptr);
+	}
+
+	void ReturnThreadHandle(HANDLE InThreadHandle)
+	{
+		InterlockedExchangePointer(&ThreadHandle, InThreadHandle);
+	}
+
+	void UpdateThreadTimes()  // read the thread's creation and exit times (call without holding gCriticalSection), this closes the handle once the thread has exited
+	{
+		HANDLE Handle = TakeThreadHandle();
+		if( Handle == nullptr )  // the thread has exited (or another thread is reading its times right now)
+		{
+			return;
+		}
+
+		FILETIME CreationFileTime, ExitFileTime, KernelFileTime, UserFileTime;
+		if( GetThreadTimes(Handle, &CreationFileTime, &ExitFileTime, &KernelFileTime, &UserFileTime) )
+		{
+			CreateTime = GetProfilerTime(CreationFileTime);
+			bHasCreateTime = true;
+
+			DWORD ExitCode;
+			if( GetExitCodeThread(Handle, &ExitCode) && (ExitCode != STILL_ACTIVE) )
+			{
+				ExitTime = GetProfilerTime(ExitFileTime);
+
+				CloseHandle(Handle);  // we don't need the handle any more
+				return;
+			}
+		}
+
+		ReturnThreadHandle(Handle);
+	}
+
+	void FinishThreadActivity(ThreadActivity_t& InOutActivity)  // fill in the thread's times and the busy period that hasn't ended yet (call after GetThreadActivity(), without holding gCriticalSection)
+	{
+		UpdateThreadTimes();
+
+		if( bHasCreateTime )
+		{
+			InOutActivity.CreateTime = CreateTime;
+		}
+
+		InOutActivity.ExitTime = ExitTime;
+
+		if( InOutActivity.BusyStartTime >= 0 )  // add the busy period that hasn't ended yet (up to when the thread exited if it has)
+		{
+			__int64 BusyEndTime = (InOutActivity.ExitTime >= 0) ? min(InOutActivity.ExitTime, InOutActivity.CaptureTime) : InOutActivity.CaptureTime;
+			InOutActivity.Timeline.AddBusyTime(InOutActivity.BusyStartTime, BusyEndTime);
+			InOutActivity.BusyStartTime = -1;
+		}
+	}
+
+	void GetMemoryStats(AeonMemoryStats& OutStats)  // (must be called while holding gCriticalSection)
+	{
+		memset(&OutStats, 0, sizeof(AeonMemoryStats));
+
+		OutStats.ThreadId = ThreadId;
+
+		size_t TableBytes, NodeBytes, OldTableBytes, RecycledNodeBytes;
+
+		for( int index = 0; index < NumPhases; index++ )
+		{
+			CHash<CCallTreeRecord, FunctionKey_t>* PhaseHashTable = PhaseCallTreeHashTables[index];
+
+			if( PhaseHashTable == nullptr )
+			{
+				continue;
+			}
+
+			PhaseHashTable->GetMemoryUsage(TableBytes, NodeBytes, OldTableBytes, RecycledNodeBytes);
+
+			OutStats.BucketArrayBytes += TableBytes;
+			OutStats.HashNodeBytes += NodeBytes;
+			OutStats.OldBucketArrayBytes += OldTableBytes;
+			OutStats.RecycledHashNodeBytes += RecycledNodeBytes;
+
+			for( int i = 0; i < PhaseHashTable->HashTableSize; i++ )
+			{
+				CHash<CCallTreeRecord, FunctionKey_t>::Hash_t* p = (CHash<CCallTreeRecord, FunctionKey_t>::Hash_t*)PhaseHashTable->HashTable[i];
+				while( p )
+				{
+					if( p->value )
+					{
+						OutStats.CallTreeRecordBytes += CALLTREERECORD_ALLOCATION_SIZE;
+						OutStats.ColdRecordBytes += sizeof(CallTreeRecordCold_t);
+
+						CHash<CCallTreeRecord, FunctionKey_t>* MemberHashTables[2] = { p->value->Cold->ParentHashTable, p->value->Cold->ChildrenHashTable };
+
+						for( int member = 0; member < 2; member++ )
+						{
+							if( MemberHashTables[member] )
+							{
+								MemberHashTables[member]->GetMemoryUsage(TableBytes, NodeBytes, OldTableBytes, RecycledNodeBytes);
+								OutStats.ParentChildTableBytes += sizeof(CHash<CCallTreeRecord, FunctionKey_t>) + TableBytes + NodeBytes + OldTableBytes + RecycledNodeBytes;
+							}
+						}
+					}
+
+					p = p->Next;
+				}
+			}
+		}
+
+		if( CallStack )
+		{
+			for( CStack::Stack_t* pNode = CallStack->pBottom; pNode; pNode = pNode->Next )
+			{
+				OutStats.StackNodeBytes += sizeof(CStack::Stack_t);
+			}
+		}
+
+		size_t TotalSize, FreeSize;
+
+		if( ThreadIdRecordAllocator )
+		{
+			ThreadIdRecordAllocator->GetAllocationStats(TotalSize, FreeSize);
+			OutStats.AllocatedBytes += TotalSize;
+			OutStats.SlackBytes += FreeSize;
+		}
+
+		if( CallTreeRecordAllocator )
+		{
+			CallTreeRecordAllocator->GetAllocationStats(TotalSize, FreeSize);
+			OutStats.AllocatedBytes += TotalSize;
+			OutStats.SlackBytes += FreeSize;
+		}
+
+		size_t AccountedBytes = OutStats.CallTreeRecordBytes + OutStats.ColdRecordBytes + OutStats.HashNodeBytes + OutStats.RecycledHashNodeBytes +
+			OutStats.BucketArrayBytes + OutStats.OldBucketArrayBytes + OutStats.ParentChildTableBytes + OutStats.StackNodeBytes + OutStats.SlackBytes;
+
+		OutStats.OtherBytes = (OutStats.AllocatedBytes > AccountedBytes) ? (OutStats.AllocatedBytes - AccountedBytes) : 0;
+	}
+
 	void SetSymbolName(char* InSymbolName)
 	{
 		SymbolName = InSymbolName;
 	}
 
+	void ApplySizingHints(int InCallTreeHashTableSize, size_t InThreadIdRecordBytes, size_t InCallTreeRecordBytes)  // use the sizes from a previous run of this thread
+	{
+		if( (ThreadIdRecordAllocator == nullptr) || (CallTreeRecordAllocator == nullptr) )
+		{
+			return;
+		}
+
+		// reserve the memory first, so the new hash table comes from the reserved block
+		ThreadIdRecordAllocator->Reserve(InThreadIdRecordBytes);
+		CallTreeRecordAllocator->Reserve(InCallTreeRecordBytes);
+
+		if( InCallTreeHashTableSize > CallTreeHashTableSize )
+		{
+			CallTreeHashTableSize = InCallTreeHashTableSize;
+
+			if( CallTreeHashTable )
+			{
+				CallTreeHashTable->ResizeEmptyHashTable(CallTreeHashTableSize);  // (only if nothing has been added to it yet)
+			}
+		}
+	}
+
+	// Switch this thread over to collecting data for a different phase.  A function that is on the stack when the phase changes
+	// counts as one call in each phase (it is exited in the old phase and entered again in the new one), and its time is split
+	// between them at TimeNow, so adding the phases together counts the call more than once but doesn't count its time twice.  The
+	// call's edge to its parent is added in both phases and the plugin sees it exit the old phase and enter the new one.  The fault
+	// counters can only be read on the thread itself, so a measured call's faults and off-CPU time all go to the new phase.
+	void SetPhase(int InPhaseIndex, DWORD64 TimeNow)
+	{
+		if( (InPhaseIndex == PhaseIndex) || (ThreadIdRecordAllocator == nullptr) || (CallTreeRecordAllocator == nullptr) )
+		{
+			return;
+		}
+
+		if( PhaseCallTreeHashTables[InPhaseIndex] == nullptr )
+		{
+			PhaseCallTreeHashTables[InPhaseIndex] = (CHash<CCallTreeRecord, FunctionKey_t>*)ThreadIdRecordAllocator->AllocateBytes(sizeof(CHash<CCallTreeRecord, FunctionKey_t>), sizeof(void*));
+			new(PhaseCallTreeHashTables[InPhaseIndex]) CHash<CCallTreeRecord, FunctionKey_t>(ThreadIdRecordAllocator, CallTreeHashTableSize);
+		}
+
+		CHash<CCallTreeRecord, FunctionKey_t>* NewCallTreeHashTable = PhaseCallTreeHashTables[InPhaseIndex];
+
+		if( CallStack && CallStack->pTop )
+		{
+			// the functions on the stack haven't exited yet, add the time they have spent so far to the old phase (the same way
+			// that CallerExit() does, working from the top of the stack down to the bottom)...
+			for( CStack::Stack_t* pNode = CallStack->pTop; pNode; pNode = pNode->Prev )
+			{
+				StackCallerData_t& StackData = pNode->value;
+				CCallTreeRecord* OldCallTreeRec = StackData.CurrentCallTreeRecord;
+
+				__int64 CallDuration = (TimeNow - StackData.Counter) - StackData.ProfilerOverhead;
+				if( CallDuration < 0 )
+				{
+					CallDuration = 0;
+				}
+				CallDuration = CallDuration / TicksPerHundredNanoseconds;  // duration is in 100ns units
+
+				OldCallTreeRec->CallDurationInclusiveTimeSum += CallDuration;
+
+				__int64 CallDurationExclusiveTime = CallDuration - OldCallTreeRec->CurrentChildrenInclusiveTime;
+				if( CallDurationExclusiveTime < 0 )
+				{
+					CallDurationExclusiveTime = 0;
+				}
+				OldCallTreeRec->CallDurationExclusiveTimeSum += CallDurationExclusiveTime;
+
+				if( CallDurationExclusiveTime > OldCallTreeRec->MaxCallDurationExclusiveTime )
+				{
+					OldCallTreeRec->MaxCallDurationExclusiveTime = CallDurationExclusiveTime;
+				}
+
+				CallerData_t Call;
+				Call.Counter = TimeNow;
+				Call.CallerAddress = StackData.CallerAddress;
+				Call.ThreadId = StackData.ThreadId;
+
+				if( pNode->Prev )  // if we have a parent function
+				{
+					CCallTreeRecord* ParentCallTreeRec = pNode->Prev->value.CurrentCallTreeRecord;
+
+					ParentCallTreeRec->CurrentChildrenInclusiveTime += CallDuration;
+
+					// add the edge to the old phase's call graph (CallerExit() adds it to the new phase's when the call exits)
+					if( EdgeLog )
+					{
+						if( EdgeLog->Add(ParentCallTreeRec, OldCallTreeRec) )
+						{
+							FlushEdgeLog(this);  // the log is full
+						}
+					}
+					else
+					{
+						AddCallTreeEdge(this, ParentCallTreeRec, OldCallTreeRec);
+					}
+				}
+
+				if( CAeonPlugin::NumColumns > 0 )
+				{
+					CAeonPlugin::OnExit(OldCallTreeRec->GetPluginPayload(), Call, CallDuration);
+				}
+
+				OldCallTreeRec->StackDepth--;
+				if( OldCallTreeRec->StackDepth < 0 )
+				{
+					OldCallTreeRec->StackDepth = 0;
+				}
+
+				OldCallTreeRec->EnterTime = 0;  // this function has "exited" from the old phase
+			}
+
+			// ...then "enter" them again in the new phase (working from the bottom of the stack up to the top)
+			int index = 0;
+			for( CStack::Stack_t* pNode = CallStack->pBottom; pNode && (index < CallStack->StackSize); pNode = pNode->Next, index++ )
+			{
+				StackCallerData_t& StackData = pNode->value;
+
+				CCallTreeRecord** pCallTreeRecPtr = NewCallTreeHashTable->LookupPointer(StackData.FunctionKey);
+				CCallTreeRecord* pCallTreeRec = *pCallTreeRecPtr;
+				if( pCallTreeRec == nullptr )
+				{
+					pCallTreeRec = (CCallTreeRecord*)CallTreeRecordAllocator->AllocateBytes(CALLTREERECORD_ALLOCATION_SIZE, CACHE_LINE_SIZE);
+					new(pCallTreeRec) CCallTreeRecord(StackData.FunctionKey, StackData.CallerAddress, ThreadIdRecordAllocator);
+					*pCallTreeRecPtr = pCallTreeRec;  // store the pointer to the new record in the hash
+				}
+
+				pCallTreeRec->EnterTime = TimeNow;
+				pCallTreeRec->CallCount++;
+				pCallTreeRec->StackDepth++;
+
+				if( pCallTreeRec->StackDepth > pCallTreeRec->MaxRecursionLevel )
+				{
+					pCallTreeRec->MaxRecursionLevel = pCallTreeRec->StackDepth;
+				}
+
+				pCallTreeRec->CurrentChildrenInclusiveTime = 0;
+
+				if( CAeonPlugin::NumColumns > 0 )
+				{
+					CallerData_t Call;
+					Call.Counter = TimeNow;
+					Call.CallerAddress = StackData.CallerAddress;
+					Call.ThreadId = StackData.ThreadId;
+
+					CAeonPlugin::OnEnter(pCallTreeRec->GetPluginPayload(), Call);
+				}
+
+				StackData.Counter = TimeNow;
+				StackData.ProfilerOverhead = 0;
+				StackData.CurrentCallTreeRecord = pCallTreeRec;
+			}
+		}
+
+		CallTreeHashTable = NewCallTreeHashTable;
+		PhaseIndex = InPhaseIndex;
+	}
+
 private:
 	CThreadIdRecord(const CThreadIdRecord& other, CAllocator* InThreadIdRecordAllocator = nullptr)  // copy constructor (this should never get called)
 	{
@@ -14,6 +14,10 @@
 #include "ThreadIdRecord.h"
 #include "Dialog.h"
 #include "Config.h"
+#include "Coverage.h"
+#include "SizingHints.h"
+#include "BlockPool.h"
+#include "Sampler.h"
 
 extern CConfig* gConfig;
 extern CDebugLog* GDebugLog;
@@ -26,11 +30,33 @@ extern CAllocator DialogAllocator;  // allocator for the Profiler Dialog window
 #define THREADID_HASH_TABLE_SIZE 32
 CHash<CThreadIdRecord>* ThreadIdHashTable = nullptr;
 
+CHash<CFunctionRecord, FunctionKey_t>* FunctionHashTable = nullptr;
+
 extern int TicksPerHundredNanoseconds;
 
+int FaultCounterSampleRate = 0;
+double ThreadCyclesPerHundredNanoseconds = 0.0;
+
+struct ThreadRecordSlab_t  // the block that the thread records for one NUMA node are being packed into (see NewThreadIdRecord())
+{
+	char* NextRecord;
+	size_t BytesLeft;
+};
+
+static ThreadRecordSlab_t ThreadRecordSlabs[MAX_BLOCK_POOL_NODES + 1];  // the last one is for NUMA_NO_PREFERRED_NODE (only used while holding gCriticalSection)
+
 
 void HandleExit()
 {
+	if( CoverageMode != COVERAGE_MODE_OFF )
+	{
+		WriteCoverageFile(GetProfilerOptionString(OPTION_COVERAGE_FILE));
+	}
+	else
+	{
+		WriteSizingHintsFile(GetProfilerOptionString(OPTION_SIZING_HINTS_FILE));  // (coverage mode doesn't collect any call tree data to write hints for)
+	}
+
 	GlobalAllocator.PrintStats("GlobalAllocator - ", 0);
 	DebugLog("");
 
@@ -46,6 +72,12 @@ void HandleExit()
 		DebugLog("");
 	}
 
+	if( FunctionHashTable )
+	{
+		FunctionHashTable->PrintStats("FunctionHashTable - ", 0);
+		DebugLog("");
+	}
+
 	// call the destructor for any global classes
 	if( gConfig )
 	{
@@ -55,8 +87,107 @@ void HandleExit()
 }
 
 
+CFunctionRecord* LookupFunctionRecord(FunctionKey_t InFunctionKey, const void* InAddress)
+{
+	if( FunctionHashTable == nullptr )
+	{
+		FunctionHashTable = (CHash<CFunctionRecord, FunctionKey_t>*)GlobalAllocator.AllocateBytes(sizeof(CHash<CFunctionRecord, FunctionKey_t>), sizeof(void*));
+		new(FunctionHashTable) CHash<CFunctionRecord, FunctionKey_t>(&GlobalAllocator, FUNCTION_HASH_TABLE_SIZE);
+	}
+
+	CFunctionRecord** pFunctionRecPtr = FunctionHashTable->LookupPointer(InFunctionKey);
+	CFunctionRecord* pFunctionRec = *pFunctionRecPtr;
+	if( pFunctionRec == nullptr )
+	{
+		pFunctionRec = (CFunctionRecord*)GlobalAllocator.AllocateBytes(sizeof(CFunctionRecord), sizeof(void*));
+		ModuleRecord_t* Module = !IsUntrackedFunctionKey(InFunctionKey) ? gModuleTable->FindModule(InAddress) : nullptr;  // (the module was already found when the key was made, so this won't add one)
+		new(pFunctionRec) CFunctionRecord(InFunctionKey, InAddress, Module);
+		*pFunctionRecPtr = pFunctionRec;  // store the pointer to the new record in the hash
+	}
+
+	return pFunctionRec;
+}
+
+// Each thread's record and the thread's allocators are packed into a shared slab for the NUMA node the thread is running on (each
+// one on its own cache lines, about 1KB for each thread, so a 64KB slab holds the records of dozens of threads) and the thread's
+// allocators allocate all of their blocks from that node.  The thread's stack and hash tables come from the thread's allocator, so
+// the data that a thread writes on every call never shares a cache line with the data of another thread.  This must be called by
+// the thread itself (so that we get the thread's NUMA node) while holding gCriticalSection.
+CThreadIdRecord* NewThreadIdRecord(DWORD ThreadId)
+{
+	DWORD NumaNode = NUMA_NO_PREFERRED_NODE;
+
+	PROCESSOR_NUMBER ProcessorNumber;
+	USHORT ProcessorNumaNode;
+
+	GetCurrentProcessorNumberEx(&ProcessorNumber);
+	if( GetNumaProcessorNodeEx(&ProcessorNumber, &ProcessorNumaNode) )
+	{
+		NumaNode = ProcessorNumaNode;
+	}
+
+	size_t RecordSize = CACHE_LINE_ALIGNED_SIZE(sizeof(CThreadIdRecord));
+	size_t AllocatorSize = CACHE_LINE_ALIGNED_SIZE(sizeof(CAllocator));
+
+	size_t ThreadRecordSize = RecordSize + (2 * AllocatorSize);  // (a multiple of CACHE_LINE_SIZE)
+
+	ThreadRecordSlab_t& Slab = ThreadRecordSlabs[(NumaNode < MAX_BLOCK_POOL_NODES) ? NumaNode : MAX_BLOCK_POOL_NODES];
+
+	if( Slab.BytesLeft < ThreadRecordSize )  // start a new slab for this node
+	{
+		Slab.NextRecord = GetPoolBlock(NumaNode);  // (blocks are page aligned)
+
+		if( (Slab.NextRecord == nullptr) && (NumaNode != NUMA_NO_PREFERRED_NODE) )
+		{
+			Slab.NextRecord = (char*)VirtualAllocExNuma(GetCurrentProcess(), NULL, BLOCK_POOL_BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, NumaNode);
+		}
+
+		if( Slab.NextRecord == nullptr )
+		{
+			Slab.NextRecord = (char*)GlobalAllocator.AllocateBytes(BLOCK_POOL_BLOCK_SIZE, CACHE_LINE_SIZE);
+		}
+
+		Slab.BytesLeft = BLOCK_POOL_BLOCK_SIZE;
+	}
+
+	char* Ptr = Slab.NextRecord;
+
+	Slab.NextRecord += ThreadRecordSize;
+	Slab.BytesLeft -= ThreadRecordSize;
+
+	CAllocator* ThreadIdRecordAllocator = (CAllocator*)(Ptr + RecordSize);
+	new(ThreadIdRecordAllocator) CAllocator();
+	ThreadIdRecordAllocator->SetNumaNode(NumaNode);
+	ThreadIdRecordAllocator->SetUseBlockPool(true);
+
+	CAllocator* CallTreeRecordAllocator = (CAllocator*)(Ptr + RecordSize + AllocatorSize);
+	new(CallTreeRecordAllocator) CAllocator();
+	CallTreeRecordAllocator->SetNumaNode(NumaNode);
+	CallTreeRecordAllocator->SetUseBlockPool(true);
+
+	CThreadIdRecord* pThreadIdRec = (CThreadIdRecord*)Ptr;
+	new(pThreadIdRec) CThreadIdRecord(ThreadId, ThreadIdRecordAllocator, CallTreeRecordAllocator);
+
+	// (we're running on the thread, so GetCurrentThread() is this thread's pseudo handle)
+	if( !DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &pThreadIdRec->ThreadHandle, THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0) )
+	{
+		pThreadIdRec->ThreadHandle = nullptr;
+	}
+
+	if( SamplerTlsIndex != TLS_OUT_OF_INDEXES )
+	{
+		pThreadIdRec->bIsInProfiler = 1;  // (we're in CallerEnter() or CallerExit() right now)
+		TlsSetValue(SamplerTlsIndex, (LPVOID)&pThreadIdRec->bIsInProfiler);
+	}
+
+	return pThreadIdRec;
+}
+
 void CallerEnter(CallerData_t& Call)
 {
+	// look up the function key before taking the lock (the module lookup is lock free unless this is the first call into a new module)
+	FunctionKey_t FunctionKey = gModuleTable->GetFunctionKey(Call.CallerAddress);
+
 	if( TryEnterCriticalSection(&gCriticalSection) == 0 )
 	{
 		EnterCriticalSection(&gCriticalSection);
@@ -76,8 +207,7 @@ void CallerEnter(CallerData_t& Call)
 	CThreadIdRecord* pThreadIdRec = *pThreadIdRecPtr;
 	if( pThreadIdRec == nullptr )
 	{
-		pThreadIdRec = (CThreadIdRecord*)GlobalAllocator.AllocateBytes(sizeof(CThreadIdRecord), sizeof(void*));
-		new(pThreadIdRec) CThreadIdRecord(Call.ThreadId, GlobalAllocator);
+		pThreadIdRec = NewThreadIdRecord(Call.ThreadId);
 		*pThreadIdRecPtr = pThreadIdRec;  // store the pointer to the new record in the hash
 	}
 
@@ -85,17 +215,34 @@ void CallerEnter(CallerData_t& Call)
 
 	if( pThreadIdRec && Call.CallerAddress )
 	{
-		CCallTreeRecord** pCallTreeRecPtr = pThreadIdRec->CallTreeHashTable->LookupPointer((void*)Call.CallerAddress);
+		if( pThreadIdRec->EntryFunction == nullptr )  // first call on this thread?
+		{
+			pThreadIdRec->EntryFunction = LookupFunctionRecord(FunctionKey, Call.CallerAddress);
+			ApplyThreadSizingHints(pThreadIdRec, pThreadIdRec->EntryFunction);
+
+			pThreadIdRec->FirstCallTime = Call.Counter;
+		}
+
+		if( pThreadIdRec->CallStack->IsEmpty() )  // the thread is becoming busy
+		{
+			pThreadIdRec->BusyStartTime = Call.Counter;
+		}
+
+		pThreadIdRec->LastActivityTime = Call.Counter;
+
+		CCallTreeRecord** pCallTreeRecPtr = pThreadIdRec->CallTreeHashTable->LookupPointer(FunctionKey);
 		CCallTreeRecord* pCallTreeRec = *pCallTreeRecPtr;
 		if( pCallTreeRec == nullptr )
 		{
-			pCallTreeRec = (CCallTreeRecord*)pThreadIdRec->ThreadIdRecordAllocator->AllocateBytes(sizeof(CCallTreeRecord), sizeof(void*));
-			new(pCallTreeRec) CCallTreeRecord(Call.CallerAddress);
+			pCallTreeRec = (CCallTreeRecord*)pThreadIdRec->CallTreeRecordAllocator->AllocateBytes(CALLTREERECORD_ALLOCATION_SIZE, CACHE_LINE_SIZE);
+			new(pCallTreeRec) CCallTreeRecord(FunctionKey, Call.CallerAddress, pThreadIdRec->ThreadIdRecordAllocator);
 			*pCallTreeRecPtr = pCallTreeRec;  // store the pointer to the new record in the hash
 		}
 
 		assert(pCallTreeRec);
 
+		DWORD64 PreviousEnterTime = pCallTreeRec->EnterTime;
+
 		pCallTreeRec->EnterTime = Call.Counter;  // keep track of when we entered this function (so the profiler can identify functions that haven't exited yet, things like "main()")
 		pCallTreeRec->CallCount++;
 		pCallTreeRec->StackDepth++;
@@ -108,13 +255,32 @@ void CallerEnter(CallerData_t& Call)
 
 		pCallTreeRec->CurrentChildrenInclusiveTime = 0;
 
+		// only the sampled calls write the interval to the Cold block (the previous enter time comes from this cache line)
+		unsigned int ColdStatsWeight = pCallTreeRec->GetColdStatsWeight();
+		if( ColdStatsWeight && (PreviousEnterTime != 0) && (Call.Counter > PreviousEnterTime) )
+		{
+			pCallTreeRec->Cold->Intervals.AddInterval(Call.Counter - PreviousEnterTime, ColdStatsWeight, TicksPerHundredNanoseconds);
+		}
+
+		if( CAeonPlugin::NumColumns > 0 )
+		{
+			CAeonPlugin::OnEnter(pCallTreeRec->GetPluginPayload(), Call);
+		}
+
 		// add this call record to the thread's call stack
 		StackCallerData_t CurrentCallerData;
 		CurrentCallerData.ThreadId = Call.ThreadId;
 		CurrentCallerData.Counter = Call.Counter;
 		CurrentCallerData.CallerAddress = Call.CallerAddress;
+		CurrentCallerData.FunctionKey = FunctionKey;
 		CurrentCallerData.CurrentCallTreeRecord = pCallTreeRec;
 
+		CurrentCallerData.bFaultCountersRead = false;
+		if( pThreadIdRec->FaultCounterStack && ((pCallTreeRec->CallCount % FaultCounterSampleRate) == 0) )
+		{
+			CurrentCallerData.bFaultCountersRead = pThreadIdRec->FaultCounterStack->Push();  // (this is part of the profiler overhead below)
+		}
+
 		int registers[4];
 		__cpuid(registers, 0);  // slower but more accurate across multiple threads running on different cores
 		DWORD64 CurrentTime = __rdtsc();  // get the "current time" in CPU ticks (do this as late as possible before returning to the program being profiled)
@@ -159,8 +325,7 @@ void CallerExit(CallerData_t& Call)
 	CThreadIdRecord* pThreadIdRec = *pThreadIdRecPtr;
 	if( pThreadIdRec == nullptr )  // this should never happen (thread id should have been added in the Enter handler)
 	{
-		pThreadIdRec = (CThreadIdRecord*)GlobalAllocator.AllocateBytes(sizeof(CThreadIdRecord), sizeof(void*));
-		new(pThreadIdRec) CThreadIdRecord(Call.ThreadId, GlobalAllocator);
+		pThreadIdRec = NewThreadIdRecord(Call.ThreadId);
 		*pThreadIdRecPtr = pThreadIdRec;
 	}
 
@@ -177,6 +342,22 @@ void CallerExit(CallerData_t& Call)
 
 		pThreadIdRec->CallStack->Pop(&CurrentCallerData);
 
+		FaultCounters_t EnterFaultCounters;
+		if( CurrentCallerData.bFaultCountersRead && pThreadIdRec->FaultCounterStack->Pop(EnterFaultCounters) )
+		{
+			FaultCounters_t ExitFaultCounters;
+			ReadFaultCounters(ExitFaultCounters);
+
+			CurrentCallerData.CurrentCallTreeRecord->Cold->Faults.AddCall(EnterFaultCounters, ExitFaultCounters, TicksPerHundredNanoseconds, ThreadCyclesPerHundredNanoseconds);
+		}
+
+		pThreadIdRec->LastActivityTime = Call.Counter;
+
+		if( pThreadIdRec->CallStack->IsEmpty() )  // the thread is going idle
+		{
+			pThreadIdRec->EndBusyPeriod(Call.Counter);
+		}
+
 		assert( CurrentCallerData.CurrentCallTreeRecord );
 
 		CurrentCallerData.CurrentCallTreeRecord->StackDepth--;
@@ -191,27 +372,35 @@ void CallerExit(CallerData_t& Call)
 
 		// if we have a parent, then set up the relationship between parent(s) and children...
 		// (each parent has a hash table listing their children and each child has a hash table listing their parents)
-		if( ParentCallerData )
+		if( ParentCallerData && pThreadIdRec->EdgeLog )  // log the edge, it gets added to the hash tables later (see EdgeLog.h)
+		{
+			if( pThreadIdRec->EdgeLog->Add(ParentCallerData->CurrentCallTreeRecord, CurrentCallerData.CurrentCallTreeRecord) )
+			{
+				FlushEdgeLog(pThreadIdRec);  // the log is full
+			}
+		}
+		else if( ParentCallerData )
 		{
 			// find the parent calltree record for this child...
-			if( CurrentCallerData.CurrentCallTreeRecord->ParentHashTable == nullptr )  // create the parent hash table if needed
+			if( CurrentCallerData.CurrentCallTreeRecord->Cold->ParentHashTable == nullptr )  // create the parent hash table if needed
 			{
-				CurrentCallerData.CurrentCallTreeRecord->ParentHashTable = (CHash<CCallTreeRecord>*)pThreadIdRec->ThreadIdRecordAllocator->AllocateBytes(sizeof(CHash<CCallTreeRecord>), sizeof(void*));
-				new(CurrentCallerData.CurrentCallTreeRecord->ParentHashTable) CHash<CCallTreeRecord>(pThreadIdRec->ThreadIdRecordAllocator, PARENT_CALLRECORD_HASH_TABLE_SIZE);
+				CurrentCallerData.CurrentCallTreeRecord->Cold->ParentHashTable = (CHash<CCallTreeRecord, FunctionKey_t>*)pThreadIdRec->ThreadIdRecordAllocator->AllocateBytes(sizeof(CHash<CCallTreeRecord, FunctionKey_t>), sizeof(void*));
+				new(CurrentCallerData.CurrentCallTreeRecord->Cold->ParentHashTable) CHash<CCallTreeRecord, FunctionKey_t>(pThreadIdRec->ThreadIdRecordAllocator,
+					GetParentHashTableSize(CurrentCallerData.CurrentCallTreeRecord->Cold->Function, PARENT_CALLRECORD_HASH_TABLE_SIZE));
 			}
 
 			// see if the parent already exists in this child's ParentHashTable
-			CCallTreeRecord** pParentCallTreeRecPtr = CurrentCallerData.CurrentCallTreeRecord->ParentHashTable->LookupPointer((void*)ParentCallerData->CallerAddress);
+			CCallTreeRecord** pParentCallTreeRecPtr = CurrentCallerData.CurrentCallTreeRecord->Cold->ParentHashTable->LookupPointer(ParentCallerData->FunctionKey);
 			CCallTreeRecord* pParentCallTreeRec = *pParentCallTreeRecPtr;
 			if( pParentCallTreeRec == nullptr )  // if parent doesn't already exist...
 			{
 				// see if the parent already exists in the Thread's CallTreeHashTable...
-				CCallTreeRecord** pCallTreeRecPtr = pThreadIdRec->CallTreeHashTable->LookupPointer((void*)ParentCallerData->CallerAddress);
+				CCallTreeRecord** pCallTreeRecPtr = pThreadIdRec->CallTreeHashTable->LookupPointer(ParentCallerData->FunctionKey);
 				CCallTreeRecord* pCallTreeRec = *pCallTreeRecPtr;
 				if( pCallTreeRec == nullptr )  // if not, add the new parent
 				{
-					pParentCallTreeRec = (CCallTreeRecord*)pThreadIdRec->ThreadIdRecordAllocator->AllocateBytes(sizeof(CCallTreeRecord), sizeof(void*));
-					new(pParentCallTreeRec) CCallTreeRecord(ParentCallerData->CallerAddress);
+					pParentCallTreeRec = (CCallTreeRecord*)pThreadIdRec->CallTreeRecordAllocator->AllocateBytes(CALLTREERECORD_ALLOCATION_SIZE, CACHE_LINE_SIZE);
+					new(pParentCallTreeRec) CCallTreeRecord(ParentCallerData->FunctionKey, ParentCallerData->CallerAddress, pThreadIdRec->ThreadIdRecordAllocator);
 					*pCallTreeRecPtr = pParentCallTreeRec;  // store the pointer to the new record in the Thread's CallTreeHashTable
 					*pParentCallTreeRecPtr = pParentCallTreeRec;  // store the pointer to the new record in this child's ParentHashTable
 				}
@@ -226,25 +415,26 @@ void CallerExit(CallerData_t& Call)
 
 
 			// find the child calltree record in this child's parent...
-			if( ParentCallerData->CurrentCallTreeRecord->ChildrenHashTable == nullptr )
+			if( ParentCallerData->CurrentCallTreeRecord->Cold->ChildrenHashTable == nullptr )
 			{
-				ParentCallerData->CurrentCallTreeRecord->ChildrenHashTable = (CHash<CCallTreeRecord>*)pThreadIdRec->ThreadIdRecordAllocator->AllocateBytes(sizeof(CHash<CCallTreeRecord>), sizeof(void*));
-				new(ParentCallerData->CurrentCallTreeRecord->ChildrenHashTable) CHash<CCallTreeRecord>(pThreadIdRec->ThreadIdRecordAllocator, PARENT_CALLRECORD_HASH_TABLE_SIZE);
+				ParentCallerData->CurrentCallTreeRecord->Cold->ChildrenHashTable = (CHash<CCallTreeRecord, FunctionKey_t>*)pThreadIdRec->ThreadIdRecordAllocator->AllocateBytes(sizeof(CHash<CCallTreeRecord, FunctionKey_t>), sizeof(void*));
+				new(ParentCallerData->CurrentCallTreeRecord->Cold->ChildrenHashTable) CHash<CCallTreeRecord, FunctionKey_t>(pThreadIdRec->ThreadIdRecordAllocator,
+					GetChildrenHashTableSize(ParentCallerData->CurrentCallTreeRecord->Cold->Function, CHILDREN_CALLRECORD_HASH_TABLE_SIZE));
 			}
 
 			// see if this child already exists in the parent's ChildrenHashTable
-			CCallTreeRecord** pChildCallTreeRecPtr = ParentCallerData->CurrentCallTreeRecord->ChildrenHashTable->LookupPointer((void*)CurrentCallerData.CallerAddress);
+			CCallTreeRecord** pChildCallTreeRecPtr = ParentCallerData->CurrentCallTreeRecord->Cold->ChildrenHashTable->LookupPointer(CurrentCallerData.FunctionKey);
 			CCallTreeRecord* pChildCallTreeRec = *pChildCallTreeRecPtr;
 			if( pChildCallTreeRec == nullptr )  // if this child doesn't already exist...
 			{
 				// see if this child already exists in the Thread's CallTreeHashTable (it should)...
-				CCallTreeRecord** pCallTreeRecPtr = pThreadIdRec->CallTreeHashTable->LookupPointer((void*)CurrentCallerData.CallerAddress);
+				CCallTreeRecord** pCallTreeRecPtr = pThreadIdRec->CallTreeHashTable->LookupPointer(CurrentCallerData.FunctionKey);
 				CCallTreeRecord* pCallTreeRec = *pCallTreeRecPtr;
 				if( pCallTreeRec == nullptr )  // if not, add the new child (this should NEVER happen)
 				{
 					assert(false);
-					pChildCallTreeRec = (CCallTreeRecord*)pThreadIdRec->ThreadIdRecordAllocator->AllocateBytes(sizeof(CCallTreeRecord), sizeof(void*));
-					new(pChildCallTreeRec) CCallTreeRecord(CurrentCallerData.CallerAddress);
+					pChildCallTreeRec = (CCallTreeRecord*)pThreadIdRec->CallTreeRecordAllocator->AllocateBytes(CALLTREERECORD_ALLOCATION_SIZE, CACHE_LINE_SIZE);
+					new(pChildCallTreeRec) CCallTreeRecord(CurrentCallerData.FunctionKey, CurrentCallerData.CallerAddress, pThreadIdRec->ThreadIdRecordAllocator);
 					*pCallTreeRecPtr = pChildCallTreeRec;  // store the pointer to the new record in the Thread's CallTreeHashTable
 					*pChildCallTreeRecPtr = pChildCallTreeRec;  // store the pointer to the new record in the parent's ChildrenHashTable
 				}
@@ -266,9 +456,23 @@ void CallerExit(CallerData_t& Call)
 		}
 		CallDuration = CallDuration / TicksPerHundredNanoseconds;  // duration is in 100ns units
 
+		// is this call an outlier (much slower than the average of the previous calls)?  if so, remember which function called it
+		// (the check only uses the counters in the CCallTreeRecord, the Cold block is only touched for the outliers)
+		if( CurrentCallerData.CurrentCallTreeRecord->IsOutlierCall(CallDuration) )
+		{
+			CFunctionRecord* OutlierCaller = ParentCallerData ? ParentCallerData->CurrentCallTreeRecord->Cold->Function : nullptr;
+			CurrentCallerData.CurrentCallTreeRecord->Cold->Outliers.AddOutlier(OutlierCaller, CallDuration);
+		}
+
 		// update the total call duration inclusive time for this function...
 		CurrentCallerData.CurrentCallTreeRecord->CallDurationInclusiveTimeSum += CallDuration;
 
+		unsigned int ColdStatsWeight = CurrentCallerData.CurrentCallTreeRecord->GetColdStatsWeight();  // (only the sampled calls write to the Cold block)
+		if( ColdStatsWeight )
+		{
+			CurrentCallerData.CurrentCallTreeRecord->Cold->DurationHistogram[GetHistogramBucket(CallDuration)] += ColdStatsWeight;
+		}
+
 		// calculate the call duration exclusive time for this function (subtract the children's inclusive time from this call's duration)
 		__int64 CallDurationExclusiveTime = CallDuration - CurrentCallerData.CurrentCallTreeRecord->CurrentChildrenInclusiveTime;
 		if( CallDurationExclusiveTime < 0 )
@@ -290,7 +494,10 @@ void CallerExit(CallerData_t& Call)
 			ParentCallerData->CurrentCallTreeRecord->CurrentChildrenInclusiveTime += CallDuration;
 		}
 
-		CurrentCallerData.CurrentCallTreeRecord->EnterTime = 0;  // indicate to the profiler dialog that this function has exited
+		if( CAeonPlugin::NumColumns > 0 )
+		{
+			CAeonPlugin::OnExit(CurrentCallerData.CurrentCallTreeRecord->GetPluginPayload(), Call, CallDuration);
+		}
 
 		int registers[4];
 		__cpuid(registers, 0);  // slower but more accurate across multiple threads running on different cores
@@ -5,11 +5,14 @@
 #include "DebugLog.h"
 
 #include "Allocator.h"
+#include "BlockPool.h"
 
-const int DEFAULT_PAGESIZE = 65536;
+const int DEFAULT_PAGESIZE = BLOCK_POOL_BLOCK_SIZE;  // (so that normal sized blocks can come from the block pool)
 
 CAllocator::CAllocator(int InWaitOnMutex) :
 	WaitOnMutex(InWaitOnMutex)
+	,NumaNode(NUMA_NO_PREFERRED_NODE)
+	,bUseBlockPool(false)
 {
 	ghAllocatorMutex = nullptr;
 
@@ -40,6 +43,50 @@ CAllocator::~CAllocator()
 	}
 }
 
+void CAllocator::SetNumaNode(DWORD InNumaNode)
+{
+	NumaNode = InNumaNode;
+}
+
+void CAllocator::SetUseBlockPool(bool bInUseBlockPool)
+{
+	bUseBlockPool = bInUseBlockPool;
+}
+
+char* CAllocator::AllocateBlock(size_t& InOutBlockSize)
+{
+	if( bUseBlockPool )
+	{
+		char* Ptr = nullptr;
+
+		if( InOutBlockSize == BLOCK_POOL_BLOCK_SIZE )
+		{
+			Ptr = GetPoolBlock(NumaNode);
+		}
+		else
+		{
+			Ptr = GetPoolLargeBlock(NumaNode, InOutBlockSize, InOutBlockSize);  // (the pool's block may be bigger than what we asked for)
+		}
+
+		if( Ptr )
+		{
+			return Ptr;
+		}
+	}
+
+	if( NumaNode != NUMA_NO_PREFERRED_NODE )
+	{
+		char* Ptr = (char*)VirtualAllocExNuma( GetCurrentProcess(), NULL, InOutBlockSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, NumaNode );
+
+		if( Ptr )
+		{
+			return Ptr;
+		}
+	}
+
+	return (char*)VirtualAlloc( NULL, InOutBlockSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+}
+
 void CAllocator::FreeBlocks()
 {
 	// free all the blocks...
@@ -99,6 +146,60 @@ void CAllocator::PrintStats(char* Header, int NestLevel)
 	DebugLog("%s%sCAllocator stats: number of blocks = %d, free remaining = %d, total size = %d, total used = %d", buffer, Header, number_blocks, (int)free_remaining, (int)total_size, (int)(total_size - free_remaining));
 }
 
+void CAllocator::Reserve(size_t NumBytes)
+{
+	if( NumBytes <= 0 )
+	{
+		return;
+	}
+
+	DWORD dwWaitResult = WAIT_OBJECT_0;
+
+	if( WaitOnMutex )
+	{
+		dwWaitResult = WaitForSingleObject( ghAllocatorMutex, INFINITE);  // wait for the mutex, no time-out interval
+	}
+
+	if( dwWaitResult == WAIT_OBJECT_0 )
+	{
+		// the current block keeps being used until it's full, then AllocateBytes() moves on to the spare block linked after it
+		size_t FreeRemaining = CurrentBlock ? ((AllocHeader*)CurrentBlock)->FreeRemaining : 0;
+		char* SpareBlock = CurrentBlock ? ((AllocHeader*)CurrentBlock)->NextBlock : nullptr;
+		size_t SpareFreeRemaining = SpareBlock ? ((AllocHeader*)SpareBlock)->FreeRemaining : 0;
+
+		if( (FreeRemaining < NumBytes) && (SpareFreeRemaining < NumBytes) )
+		{
+			size_t page_size = max(NumBytes + sizeof(AllocHeader) + CACHE_LINE_SIZE, DEFAULT_PAGESIZE);  // (room for the alignment of the allocation that doesn't fit in the current block)
+			page_size = ((page_size + DEFAULT_PAGESIZE - 1) / DEFAULT_PAGESIZE) * DEFAULT_PAGESIZE;
+
+			char* Ptr = AllocateBlock(page_size);
+
+			assert(Ptr);
+
+			AllocHeader* Header = (AllocHeader*)Ptr;
+			Header->NextBlock = SpareBlock;  // (a smaller spare block is still used once this one is full)
+			Header->FreePointer = (char*)Header + sizeof(AllocHeader);
+			Header->Size = page_size;
+			Header->FreeRemaining = page_size - sizeof(AllocHeader);
+
+			if( CurrentBlock == nullptr )
+			{
+				FirstBlock = Ptr;
+				CurrentBlock = Ptr;
+			}
+			else
+			{
+				((AllocHeader*)CurrentBlock)->NextBlock = Ptr;
+			}
+		}
+
+		if( WaitOnMutex )
+		{
+			ReleaseMutex(ghAllocatorMutex);
+		}
+	}
+}
+
 void* CAllocator::AllocateBytes(size_t NumBytes, int Alignment)
 {
 	if( NumBytes <= 0 )
@@ -121,7 +222,7 @@ void* CAllocator::AllocateBytes(size_t NumBytes, int Alignment)
 			page_size = ((page_size + DEFAULT_PAGESIZE - 1) / DEFAULT_PAGESIZE) * DEFAULT_PAGESIZE;
 
 			// allocate first block
-			char* Ptr = (char*)VirtualAlloc( NULL, page_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+			char* Ptr = AllocateBlock(page_size);
 
 			assert(Ptr);
 
@@ -141,22 +242,36 @@ void* CAllocator::AllocateBytes(size_t NumBytes, int Alignment)
 		size_t AlignedOffset = pAlignedFreePointer - Header->FreePointer;
 		size_t AlignedFreeRemaining = Header->FreeRemaining - AlignedOffset;
 
+		// not enough free space for aligned allocation, move on to the spare block from Reserve() if there is one and it's big enough
+		while( (NumBytes >= AlignedFreeRemaining) && Header->NextBlock && (((AllocHeader*)Header->NextBlock)->FreeRemaining > NumBytes + Alignment) )
+		{
+			CurrentBlock = Header->NextBlock;
+
+			Header = (AllocHeader*)CurrentBlock;
+
+			pAlignedFreePointer = (char*)(((uintptr_t)(Header->FreePointer + Alignment - 1) / Alignment) * Alignment);
+			AlignedOffset = pAlignedFreePointer - Header->FreePointer;
+			AlignedFreeRemaining = Header->FreeRemaining - AlignedOffset;
+		}
+
 		if( NumBytes >= AlignedFreeRemaining )  // not enough free space for aligned allocation?
 		{
 			size_t page_size = max(NumBytes + sizeof(AllocHeader) + Alignment, DEFAULT_PAGESIZE);
 			page_size = ((page_size + DEFAULT_PAGESIZE - 1) / DEFAULT_PAGESIZE) * DEFAULT_PAGESIZE;
 
-			// allocate next block and link it in
-			char* Ptr = (char*)VirtualAlloc( NULL, page_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+			// allocate next block and link it in (ahead of the spare block from Reserve(), if there is one)
+			char* Ptr = AllocateBlock(page_size);
 
 			assert(Ptr);
 
+			char* SpareBlock = Header->NextBlock;
+
 			Header->NextBlock = Ptr;
 
 			CurrentBlock = Ptr;
 
 			Header = (AllocHeader*)CurrentBlock;
-			Header->NextBlock = nullptr;
+			Header->NextBlock = SpareBlock;
 			Header->FreePointer = (char*)Header + sizeof(AllocHeader);
 			Header->Size = page_size;
 			Header->FreeRemaining = page_size - sizeof(AllocHeader);
@@ -0,0 +1,258 @@
+#include <Windows.h>
+#include <assert.h>
+
+#include "DebugLog.h"
+
+#include "BlockPool.h"
+
+struct BlockPool_t
+{
+	SLIST_HEADER FreeBlocks;  // the warm blocks (the SLIST_ENTRY is stored at the start of each block)
+	volatile LONG NumFreeBlocks;
+	volatile LONG bIsUsed;  // pools are only filled once a block has been asked for on that node
+
+	char* volatile LargeBlock;  // a warm block bigger than BLOCK_POOL_BLOCK_SIZE (its size is stored at the start of the block), only the refill thread puts blocks here
+	volatile size_t WantedLargeBlockSize;  // size of the next large block the refill thread should get ready (0 if none has been asked for)
+	SLIST_HEADER RetiredLargeBlocks;  // large blocks that were too small, for the refill thread to free
+};
+
+// the last pool is for NUMA_NO_PREFERRED_NODE (SLIST_HEADER needs to be aligned to MEMORY_ALLOCATION_ALIGNMENT)
+static __declspec(align(MEMORY_ALLOCATION_ALIGNMENT)) BlockPool_t BlockPools[MAX_BLOCK_POOL_NODES + 1];
+
+static int BlockPoolSize = 0;  // number of blocks to keep in each pool (0 if the pool isn't running)
+static HANDLE hRefillEvent = nullptr;
+static HANDLE hRefillThread = nullptr;
+static volatile bool bStopRefillThread = false;
+
+
+static int GetPoolIndex(DWORD InNumaNode)
+{
+	return (InNumaNode < MAX_BLOCK_POOL_NODES) ? (int)InNumaNode : MAX_BLOCK_POOL_NODES;
+}
+
+static char* AllocateWarmBlock(int InPoolIndex, size_t InBlockSize = BLOCK_POOL_BLOCK_SIZE)
+{
+	char* Ptr = nullptr;
+
+	if( InPoolIndex < MAX_BLOCK_POOL_NODES )
+	{
+		Ptr = (char*)VirtualAllocExNuma( GetCurrentProcess(), NULL, InBlockSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, (DWORD)InPoolIndex );
+	}
+
+	if( Ptr == nullptr )
+	{
+		Ptr = (char*)VirtualAlloc( NULL, InBlockSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+	}
+
+	if( Ptr )
+	{
+		SYSTEM_INFO SystemInfo;
+		GetSystemInfo(&SystemInfo);
+
+		// touch every page so the page faults happen here instead of on the thread that gets this block
+		for( size_t offset = 0; offset < InBlockSize; offset += SystemInfo.dwPageSize )
+		{
+			((volatile char*)Ptr)[offset] = 0;
+		}
+	}
+
+	return Ptr;
+}
+
+static DWORD WINAPI BlockPoolRefillThread(LPVOID lpParam)
+{
+	while( !bStopRefillThread )
+	{
+		WaitForSingleObject(hRefillEvent, 100);  // (the timeout is so we still refill if the event was set before a pool was marked as used)
+
+		for( int index = 0; !bStopRefillThread && (index <= MAX_BLOCK_POOL_NODES); index++ )
+		{
+			BlockPool_t& Pool = BlockPools[index];
+
+			while( !bStopRefillThread && Pool.bIsUsed && (Pool.NumFreeBlocks < BlockPoolSize) )
+			{
+				char* Ptr = AllocateWarmBlock(index);
+
+				if( Ptr == nullptr )
+				{
+					DebugLog("BlockPoolRefillThread(): Failed to allocate a block (error = %d)", GetLastError());
+					break;
+				}
+
+				InterlockedPushEntrySList(&Pool.FreeBlocks, (PSLIST_ENTRY)Ptr);
+				InterlockedIncrement(&Pool.NumFreeBlocks);
+			}
+
+			size_t WantedLargeBlockSize = Pool.WantedLargeBlockSize;
+
+			if( !bStopRefillThread && (WantedLargeBlockSize > 0) && (Pool.LargeBlock == nullptr) )
+			{
+				char* Ptr = AllocateWarmBlock(index, WantedLargeBlockSize);
+
+				if( Ptr )
+				{
+					*(size_t*)Ptr = WantedLargeBlockSize;
+					InterlockedExchangePointer((void* volatile*)&Pool.LargeBlock, Ptr);
+				}
+				else
+				{
+					DebugLog("BlockPoolRefillThread(): Failed to allocate a large block of %d bytes (error = %d)", (int)WantedLargeBlockSize, GetLastError());
+				}
+			}
+
+			PSLIST_ENTRY Entry = InterlockedFlushSList(&Pool.RetiredLargeBlocks);
+			while( Entry )
+			{
+				PSLIST_ENTRY NextEntry = Entry->Next;
+				VirtualFree(Entry, 0, MEM_RELEASE);
+				Entry = NextEntry;
+			}
+		}
+	}
+
+	return 0;
+}
+
+void StartBlockPool(int InNumBlocks)
+{
+	if( InNumBlocks <= 0 )
+	{
+		return;
+	}
+
+	for( int index = 0; index <= MAX_BLOCK_POOL_NODES; index++ )
+	{
+		InitializeSListHead(&BlockPools[index].FreeBlocks);
+		BlockPools[index].NumFreeBlocks = 0;
+		BlockPools[index].bIsUsed = 0;
+		BlockPools[index].LargeBlock = nullptr;
+		BlockPools[index].WantedLargeBlockSize = 0;
+		InitializeSListHead(&BlockPools[index].RetiredLargeBlocks);
+	}
+
+	// start out filling the pool for the node we are running on (and the shared pool), the other nodes are filled when they are first used
+	PROCESSOR_NUMBER ProcessorNumber;
+	USHORT ProcessorNumaNode;
+
+	GetCurrentProcessorNumberEx(&ProcessorNumber);
+	if( GetNumaProcessorNodeEx(&ProcessorNumber, &ProcessorNumaNode) )
+	{
+		BlockPools[GetPoolIndex(ProcessorNumaNode)].bIsUsed = 1;
+	}
+
+	BlockPools[MAX_BLOCK_POOL_NODES].bIsUsed = 1;
+
+	hRefillEvent = CreateEvent(NULL, FALSE, TRUE, NULL);  // auto reset, starts out signaled so that the pools get filled right away
+	if( hRefillEvent == nullptr )
+	{
+		DebugLog("StartBlockPool(): CreateEvent failed (error = %d)", GetLastError());
+		return;
+	}
+
+	bStopRefillThread = false;
+	BlockPoolSize = InNumBlocks;
+
+	// (the thread won't start running until the loader lock is released, the pools are just empty until then)
+	hRefillThread = CreateThread(NULL, 0, BlockPoolRefillThread, NULL, 0, NULL);
+	if( hRefillThread == nullptr )
+	{
+		DebugLog("StartBlockPool(): CreateThread failed (error = %d)", GetLastError());
+
+		BlockPoolSize = 0;
+		CloseHandle(hRefillEvent);
+		hRefillEvent = nullptr;
+	}
+}
+
+void StopBlockPool()
+{
+	if( hRefillThread == nullptr )
+	{
+		return;
+	}
+
+	// we are called while holding the loader lock, so don't wait for the thread to exit (it just stops refilling)
+	BlockPoolSize = 0;
+	bStopRefillThread = true;
+	SetEvent(hRefillEvent);
+
+	CloseHandle(hRefillThread);
+	hRefillThread = nullptr;
+}
+
+char* GetPoolBlock(DWORD InNumaNode)
+{
+	if( BlockPoolSize == 0 )
+	{
+		return nullptr;
+	}
+
+	BlockPool_t& Pool = BlockPools[GetPoolIndex(InNumaNode)];
+
+	if( !Pool.bIsUsed )
+	{
+		InterlockedExchange(&Pool.bIsUsed, 1);
+	}
+
+	char* Ptr = (char*)InterlockedPopEntrySList(&Pool.FreeBlocks);
+
+	if( Ptr )
+	{
+		memset(Ptr, 0, sizeof(SLIST_ENTRY));  // blocks are expected to be all zeroes
+
+		LONG NumFreeBlocks = InterlockedDecrement(&Pool.NumFreeBlocks);
+
+		if( NumFreeBlocks == (BlockPoolSize / 2) )  // wake up the refill thread once the pool is half empty
+		{
+			SetEvent(hRefillEvent);
+		}
+	}
+
+	return Ptr;
+}
+
+char* GetPoolLargeBlock(DWORD InNumaNode, size_t InMinSize, size_t& OutSize)
+{
+	if( (BlockPoolSize == 0) || (InMinSize > BLOCK_POOL_MAX_LARGE_BLOCK_SIZE) )
+	{
+		return nullptr;
+	}
+
+	BlockPool_t& Pool = BlockPools[GetPoolIndex(InNumaNode)];
+
+	if( !Pool.bIsUsed )
+	{
+		InterlockedExchange(&Pool.bIsUsed, 1);
+	}
+
+	char* Ptr = (char*)InterlockedExchangePointer((void* volatile*)&Pool.LargeBlock, nullptr);
+	size_t LargeBlockSize = Ptr ? *(size_t*)Ptr : 0;
+
+	// round the size we want next up to a power of two (hash tables double in size, so the next one is probably twice as big as this one)
+	size_t NextSize = BLOCK_POOL_BLOCK_SIZE * 2;
+	while( (NextSize < BLOCK_POOL_MAX_LARGE_BLOCK_SIZE) && ((NextSize < InMinSize) || ((Ptr != nullptr) && (NextSize <= LargeBlockSize))) )
+	{
+		NextSize *= 2;
+	}
+
+	if( Pool.WantedLargeBlockSize < NextSize )
+	{
+		Pool.WantedLargeBlockSize = NextSize;
+	}
+
+	if( Ptr && (LargeBlockSize < InMinSize) )  // too small, let the refill thread free it and get a bigger one ready
+	{
+		InterlockedPushEntrySList(&Pool.RetiredLargeBlocks, (PSLIST_ENTRY)Ptr);
+		Ptr = nullptr;
+	}
+
+	SetEvent(hRefillEvent);
+
+	if( Ptr )
+	{
+		memset(Ptr, 0, sizeof(size_t));  // blocks are expected to be all zeroes
+		OutSize = LargeBlockSize;
+	}
+
+	return Ptr;
+}
@@ -0,0 +1,40 @@
+#include "targetver.h"
+
+#define WIN32_LEAN_AND_MEAN  // Exclude rarely-used stuff from Windows headers
+// Windows Header Files:
+#include <Windows.h>
+
+#include "Dialog.h"
+#include "CallTreeColumns.h"
+
+
+template <typename T>
+static T* AllocateColumn(CAllocator* InAllocator, unsigned int InNumEntries)
+{
+	return (T*)InAllocator->AllocateBytes(max(InNumEntries, 1U) * sizeof(T), (sizeof(T) < sizeof(void*)) ? (int)sizeof(T) : (int)sizeof(void*));
+}
+
+CallTreeColumns_t* BuildCallTreeColumns(CAllocator* InAllocator, const DialogThreadIdRecord_t* InThreadRec)
+{
+	CallTreeColumns_t* Columns = (CallTreeColumns_t*)InAllocator->AllocateBytes(sizeof(CallTreeColumns_t), sizeof(void*));
+
+	unsigned int NumRecords = InThreadRec->CallTreeArraySize;
+	Columns->NumRecords = NumRecords;
+
+	Columns->Address = AllocateColumn<const void*>(InAllocator, NumRecords);
+	Columns->CallCount = AllocateColumn<int>(InAllocator, NumRecords);
+	Columns->ExclusiveTime = AllocateColumn<__int64>(InAllocator, NumRecords);
+	Columns->Records = AllocateColumn<DialogCallTreeRecord_t*>(InAllocator, NumRecords);
+
+	for( unsigned int index = 0; index < NumRecords; index++ )
+	{
+		DialogCallTreeRecord_t* CallTreeRec = (DialogCallTreeRecord_t*)InThreadRec->CallTreeArray[index];
+
+		Columns->Address[index] = CallTreeRec->Address;
+		Columns->CallCount[index] = CallTreeRec->CallCount;
+		Columns->ExclusiveTime[index] = CallTreeRec->CallDurationExclusiveTimeSum;
+		Columns->Records[index] = CallTreeRec;
+	}
+
+	return Columns;
+}
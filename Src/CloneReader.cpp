@@ -0,0 +1,146 @@
+#include "targetver.h"
+
+#include <Windows.h>
+
+#include "CloneReader.h"
+#include "DebugLog.h"
+
+// the process snapshot functions are loaded at run time, since they are only in Windows 8.1 or later (and older SDKs don't have ProcessSnapshot.h)
+typedef DWORD (WINAPI *PssCaptureSnapshotFunc)(HANDLE ProcessHandle, DWORD CaptureFlags, DWORD ThreadContextFlags, HANDLE* SnapshotHandle);
+typedef DWORD (WINAPI *PssQuerySnapshotFunc)(HANDLE SnapshotHandle, DWORD InformationClass, void* Buffer, DWORD BufferLength);
+typedef DWORD (WINAPI *PssFreeSnapshotFunc)(HANDLE ProcessHandle, HANDLE SnapshotHandle);
+
+#define AEON_PSS_CAPTURE_VA_CLONE 0x00000001  /* PSS_CAPTURE_VA_CLONE */
+#define AEON_PSS_QUERY_VA_CLONE_INFORMATION 1  /* PSS_QUERY_VA_CLONE_INFORMATION */
+
+
+CCloneReader::CCloneReader() :
+	hSnapshot(nullptr)
+	,hCloneProcess(nullptr)
+	,ChunkMemory(nullptr)
+{
+	memset(ChunkAddress, 0, sizeof(ChunkAddress));
+}
+
+CCloneReader::~CCloneReader()
+{
+	FreeClone();
+}
+
+bool CCloneReader::CreateClone()
+{
+	FreeClone();
+
+	HMODULE hKernel32 = GetModuleHandle(TEXT("kernel32.dll"));
+
+	PssCaptureSnapshotFunc pPssCaptureSnapshot = (PssCaptureSnapshotFunc)GetProcAddress(hKernel32, "PssCaptureSnapshot");
+	PssQuerySnapshotFunc pPssQuerySnapshot = (PssQuerySnapshotFunc)GetProcAddress(hKernel32, "PssQuerySnapshot");
+
+	if( (pPssCaptureSnapshot == nullptr) || (pPssQuerySnapshot == nullptr) )
+	{
+		DebugLog("CCloneReader::CreateClone(): process snapshots aren't supported by this version of Windows");
+		return false;
+	}
+
+	DWORD Result = pPssCaptureSnapshot(GetCurrentProcess(), AEON_PSS_CAPTURE_VA_CLONE, 0, &hSnapshot);
+	if( Result != ERROR_SUCCESS )
+	{
+		DebugLog("CCloneReader::CreateClone(): PssCaptureSnapshot() failed (error = %d)", Result);
+		hSnapshot = nullptr;
+		return false;
+	}
+
+	HANDLE VaCloneHandle = nullptr;  // (PSS_VA_CLONE_INFORMATION)
+	Result = pPssQuerySnapshot(hSnapshot, AEON_PSS_QUERY_VA_CLONE_INFORMATION, &VaCloneHandle, sizeof(VaCloneHandle));
+	if( (Result != ERROR_SUCCESS) || (VaCloneHandle == nullptr) )
+	{
+		DebugLog("CCloneReader::CreateClone(): PssQuerySnapshot() failed (error = %d)", Result);
+		FreeClone();
+		return false;
+	}
+
+	hCloneProcess = VaCloneHandle;
+
+	ChunkMemory = (char*)VirtualAlloc(nullptr, (size_t)CLONE_READER_CHUNK_SIZE * CLONE_READER_CACHED_CHUNKS, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if( ChunkMemory == nullptr )
+	{
+		FreeClone();
+		return false;
+	}
+
+	memset(ChunkAddress, 0, sizeof(ChunkAddress));
+
+	return true;
+}
+
+void CCloneReader::FreeClone()
+{
+	if( hSnapshot )
+	{
+		PssFreeSnapshotFunc pPssFreeSnapshot = (PssFreeSnapshotFunc)GetProcAddress(GetModuleHandle(TEXT("kernel32.dll")), "PssFreeSnapshot");
+		if( pPssFreeSnapshot )
+		{
+			pPssFreeSnapshot(GetCurrentProcess(), hSnapshot);  // (this also gets rid of the clone process)
+		}
+
+		hSnapshot = nullptr;
+	}
+
+	hCloneProcess = nullptr;
+
+	if( ChunkMemory )
+	{
+		VirtualFree(ChunkMemory, 0, MEM_RELEASE);
+		ChunkMemory = nullptr;
+	}
+}
+
+bool CCloneReader::ReadChunk(size_t InChunkAddress, int InSlot)
+{
+	SIZE_T BytesRead = 0;
+	char* Chunk = &ChunkMemory[(size_t)InSlot * CLONE_READER_CHUNK_SIZE];
+
+	if( !ReadProcessMemory(hCloneProcess, (LPCVOID)InChunkAddress, Chunk, CLONE_READER_CHUNK_SIZE, &BytesRead) || (BytesRead != CLONE_READER_CHUNK_SIZE) )
+	{
+		ChunkAddress[InSlot] = 0;
+		return false;
+	}
+
+	ChunkAddress[InSlot] = InChunkAddress;
+	return true;
+}
+
+bool CCloneReader::Read(const void* InAddress, void* OutBuffer, size_t InNumBytes)
+{
+	if( (hCloneProcess == nullptr) || (InAddress == nullptr) )
+	{
+		return false;
+	}
+
+	size_t Address = (size_t)InAddress;
+	char* Buffer = (char*)OutBuffer;
+
+	while( InNumBytes > 0 )
+	{
+		size_t Chunk = Address & ~((size_t)CLONE_READER_CHUNK_SIZE - 1);
+		size_t ChunkOffset = Address - Chunk;
+		size_t NumBytes = min(InNumBytes, CLONE_READER_CHUNK_SIZE - ChunkOffset);
+
+		int Slot = (int)((Chunk / CLONE_READER_CHUNK_SIZE) % CLONE_READER_CACHED_CHUNKS);
+
+		if( (ChunkAddress[Slot] != Chunk) && !ReadChunk(Chunk, Slot) )
+		{
+			// the chunk isn't all readable (the end of an allocation), so read just what was asked for
+			SIZE_T BytesRead = 0;
+			return ReadProcessMemory(hCloneProcess, (LPCVOID)Address, Buffer, InNumBytes, &BytesRead) && (BytesRead == InNumBytes);
+		}
+
+		memcpy(Buffer, &ChunkMemory[(size_t)Slot * CLONE_READER_CHUNK_SIZE + ChunkOffset], NumBytes);
+
+		Address += NumBytes;
+		Buffer += NumBytes;
+		InNumBytes -= NumBytes;
+	}
+
+	return true;
+}
@@ -25,6 +25,20 @@ ConfigValueStruct ConfigValues[] =
 	ConfigValueStruct(CONFIG_RIGHT_SPLITTER_PERCENT, CONFIG_FLOAT, 0.50f, "right_splitter_percent"),
 };
 
+ProfilerOptionStruct ProfilerOptions[] =
+{
+	{ OPTION_COVERAGE_MODE, "AEON_COVERAGE_MODE", "0", "" },  // 0 = off, 1 = coverage bitmap only, 2 = coverage bitmap and patch out the _penter/_pexit calls
+	{ OPTION_COVERAGE_FILE, "AEON_COVERAGE_FILE", "AeonProfiler.coverage", "" },
+	{ OPTION_SIZING_HINTS_FILE, "AEON_SIZING_HINTS_FILE", "", "" },  // empty = don't read or write a sizing hints file
+	{ OPTION_BLOCK_POOL_SIZE, "AEON_BLOCK_POOL_SIZE", "32", "" },  // number of warm 64KB blocks to keep ready for each NUMA node (0 = no block pool)
+	{ OPTION_EXTERNAL_SAMPLE_INTERVAL, "AEON_SAMPLE_INTERVAL_MS", "0", "" },  // milliseconds between samples of the profiled threads for external time (0 = don't sample)
+	{ OPTION_FAULT_COUNTER_SAMPLE_RATE, "AEON_FAULT_COUNTERS", "0", "" },  // read the page fault and off-CPU counters on every Nth call of each function (0 = off, see FaultCounters.h)
+	{ OPTION_THREAD_GROUP_PREFIXES, "AEON_THREAD_GROUPS", "", "" },  // group the threads whose names start with one of these prefixes (separated by ';', see ThreadGroups.h)
+	{ OPTION_EXPORT_BACKEND, "AEON_EXPORT_BACKEND", "copy", "" },  // how the export gets a consistent copy of the data ("copy" = copy it while the threads are paused, "clone" = copy-on-write clone, see CloneReader.h, "stream" = write a batch of records at a time)
+	{ OPTION_DEFERRED_EDGES, "AEON_DEFERRED_EDGES", "0", "" },  // log the parent/child edges in CallerExit() and add them to the call graph later (1 = on, see EdgeLog.h)
+	{ OPTION_LINE_SAMPLES, "AEON_LINE_SAMPLES", "0", "" },  // count the self samples by instruction pointer, for the samples next to each source line (1 = on, needs AEON_SAMPLE_INTERVAL_MS, see Sampler.h)
+};
+
 
 CConfig::CConfig()
 	: PreviousTickCount(0)
@@ -234,3 +248,48 @@ void CConfig::SetFloat(ConfigValueId Id, float value)
 		}
 	}
 }
+
+void ReadProfilerOptions()
+{
+	for( int index = 0; index < _countof(ProfilerOptions); ++index )
+	{
+		ProfilerOptionStruct& Option = ProfilerOptions[index];
+
+		DWORD length = GetEnvironmentVariableA(Option.EnvironmentVariable, Option.Value, sizeof(Option.Value));
+
+		if( (length == 0) || (length >= sizeof(Option.Value)) )  // not set (or too long), use the default value
+		{
+			strcpy_s(Option.Value, sizeof(Option.Value), Option.DefaultValue);
+		}
+		else
+		{
+			DebugLog("Profiler option: %s=%s", Option.EnvironmentVariable, Option.Value);
+		}
+	}
+}
+
+int GetProfilerOptionInt(ProfilerOptionId Id)
+{
+	for( int index = 0; index < _countof(ProfilerOptions); ++index )
+	{
+		if( Id == ProfilerOptions[index].Id )
+		{
+			return atoi(ProfilerOptions[index].Value);
+		}
+	}
+
+	return -1;
+}
+
+char* GetProfilerOptionString(ProfilerOptionId Id)
+{
+	for( int index = 0; index < _countof(ProfilerOptions); ++index )
+	{
+		if( Id == ProfilerOptions[index].Id )
+		{
+			return ProfilerOptions[index].Value;
+		}
+	}
+
+	return nullptr;
+}
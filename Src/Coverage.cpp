@@ -0,0 +1,321 @@
+#include <Windows.h>
+#include <stdio.h>
+#include <intrin.h>
+
+#include "DebugLog.h"
+
+#include "Coverage.h"
+#include "ModuleTable.h"
+#include "Allocator.h"
+
+extern CAllocator GlobalAllocator;
+
+int CoverageMode = COVERAGE_MODE_OFF;
+
+static CRITICAL_SECTION PatchCriticalSection;  // (held while a page is writable, see PatchOutCall())
+
+
+// Replace the 5 byte "CALL rel32" instruction at InCallAddress with a 5 byte NOP.  Other threads may be executing this code while
+// we patch it, so the 5 bytes are written with a single 8 byte atomic compare and exchange.  This can only be done when the 5 bytes
+// don't straddle an 8 byte boundary, any call that does is left alone (it still works, it just isn't free).  The protection change,
+// the write and restoring the protection are done while holding PatchCriticalSection, otherwise a thread patching another call on
+// the same page could put the page back to read only while we are still writing to it (or we could save its PAGE_EXECUTE_READWRITE
+// as the old protection and leave the page writable).
+static void PatchOutCall(unsigned char* InCallAddress)
+{
+	if( *InCallAddress != 0xE8 )  // make sure this is a relative CALL instruction (it should always be)
+	{
+		return;
+	}
+
+	unsigned __int64* AlignedAddress = (unsigned __int64*)((UINT_PTR)InCallAddress & ~(UINT_PTR)7);
+	int ByteOffset = (int)((UINT_PTR)InCallAddress & 7);
+
+	if( ByteOffset > 3 )  // the instruction doesn't fit in the aligned 8 byte word
+	{
+		return;
+	}
+
+	static const unsigned char NopInstruction[5] = { 0x0F, 0x1F, 0x44, 0x00, 0x00 };  // nop DWORD PTR [eax+eax*1+0x0]
+
+	EnterCriticalSection(&PatchCriticalSection);
+
+	DWORD OldProtect;
+	if( VirtualProtect(AlignedAddress, sizeof(unsigned __int64), PAGE_EXECUTE_READWRITE, &OldProtect) )
+	{
+		unsigned __int64 OldValue = *AlignedAddress;
+		unsigned __int64 NewValue = OldValue;
+		memcpy((unsigned char*)&NewValue + ByteOffset, NopInstruction, sizeof(NopInstruction));
+
+		InterlockedCompareExchange64((volatile __int64*)AlignedAddress, (__int64)NewValue, (__int64)OldValue);  // (threads running this code see either the CALL or the NOP)
+
+		VirtualProtect(AlignedAddress, sizeof(unsigned __int64), OldProtect, &OldProtect);
+
+		FlushInstructionCache(GetCurrentProcess(), AlignedAddress, sizeof(unsigned __int64));
+	}
+
+	LeaveCriticalSection(&PatchCriticalSection);
+}
+
+void InitCoverage()
+{
+	InitializeCriticalSection(&PatchCriticalSection);
+}
+
+void CoverageEnter(const void* InCallerAddress)
+{
+	// with /Gh the call to _penter is the first instruction in the function, so the function starts 5 bytes before the return address
+	const char* FunctionAddress = (const char*)InCallerAddress - 5;
+
+	ModuleRecord_t* Module = gModuleTable->FindModule(FunctionAddress);
+
+	if( (Module == nullptr) || (Module->CoverageBitmap == nullptr) )
+	{
+		return;
+	}
+
+	long Offset = (long)(FunctionAddress - Module->BaseAddress);
+	volatile long* BitmapWord = (volatile long*)Module->CoverageBitmap + (Offset >> 5);
+	long BitIndex = Offset & 31;
+
+	if( (*BitmapWord & (1 << BitIndex)) == 0 )  // only use the (slower) interlocked instruction the first time
+	{
+		if( _interlockedbittestandset(BitmapWord, BitIndex) == 0 )  // the first thread to set the bit patches the call
+		{
+			if( CoverageMode == COVERAGE_MODE_PATCH )
+			{
+				PatchOutCall((unsigned char*)FunctionAddress);
+			}
+		}
+	}
+}
+
+void CoverageExit(const void* InCallerAddress)
+{
+	if( CoverageMode != COVERAGE_MODE_PATCH )  // nothing to do on exit unless we are patching out the calls
+	{
+		return;
+	}
+
+	// with /GH the call to _pexit is in the function epilogue (a function can have more than one epilogue, each one is patched separately)
+	const char* CallAddress = (const char*)InCallerAddress - 5;
+
+	ModuleRecord_t* Module = gModuleTable->FindModule(CallAddress);
+
+	if( (Module == nullptr) || (Module->CoverageExitBitmap == nullptr) )
+	{
+		return;
+	}
+
+	long Offset = (long)(CallAddress - Module->BaseAddress);
+	volatile long* BitmapWord = (volatile long*)Module->CoverageExitBitmap + (Offset >> 5);
+	long BitIndex = Offset & 31;
+
+	if( (*BitmapWord & (1 << BitIndex)) == 0 )
+	{
+		if( _interlockedbittestandset(BitmapWord, BitIndex) == 0 )
+		{
+			PatchOutCall((unsigned char*)CallAddress);
+		}
+	}
+}
+
+
+// The coverage file format is:
+//    "AEONCOV1" (8 bytes), NumModules (int)
+//    for each module: NameLength (int), Name (NameLength bytes), ImageSize (DWORD), TimeDateStamp (DWORD), BitmapSize (DWORD), Bitmap (BitmapSize bytes)
+// Modules are matched by name, size and timestamp so that bitmaps from different builds of a module are never merged together.
+
+struct CoverageFileModule_t
+{
+	char Name[MODULE_NAME_SIZE];
+	DWORD ImageSize;
+	DWORD TimeDateStamp;
+	DWORD BitmapSize;
+	unsigned char* Bitmap;
+	bool bIsLoaded;  // whether this module matches a module loaded in this process
+};
+
+static bool ReadBytes(HANDLE hFile, void* Buffer, DWORD NumBytes)
+{
+	DWORD BytesRead = 0;
+	return (ReadFile(hFile, Buffer, NumBytes, &BytesRead, NULL) != 0) && (BytesRead == NumBytes);
+}
+
+static bool WriteBytes(HANDLE hFile, const void* Buffer, DWORD NumBytes)
+{
+	DWORD BytesWritten = 0;
+	return (WriteFile(hFile, Buffer, NumBytes, &BytesWritten, NULL) != 0) && (BytesWritten == NumBytes);
+}
+
+void WriteCoverageFile(const char* InFilename)
+{
+	if( (gModuleTable == nullptr) || (InFilename == nullptr) || (InFilename[0] == 0) )
+	{
+		return;
+	}
+
+	// several processes (or several runs of the same test suite in parallel) may be merging into the same file at the same time
+	HANDLE hMutex = CreateMutexA(NULL, FALSE, "AeonProfilerCoverageFileMutex");
+	if( hMutex )
+	{
+		WaitForSingleObject(hMutex, INFINITE);
+	}
+
+	CAllocator FileAllocator;
+
+	int NumFileModules = 0;
+	CoverageFileModule_t* FileModules = nullptr;
+
+	HANDLE hFile = CreateFileA(InFilename, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		DebugLog("WriteCoverageFile(): Failed to open '%s' (error = %d)", InFilename, GetLastError());
+	}
+	else
+	{
+		// read the existing coverage data (if there is any)
+		char Magic[8];
+		int NumModules = 0;
+
+		if( ReadBytes(hFile, Magic, sizeof(Magic)) && (memcmp(Magic, COVERAGE_FILE_MAGIC, sizeof(Magic)) == 0) && ReadBytes(hFile, &NumModules, sizeof(int)) && (NumModules > 0) )
+		{
+			FileModules = (CoverageFileModule_t*)FileAllocator.AllocateBytes(NumModules * sizeof(CoverageFileModule_t), sizeof(void*));
+
+			for( int index = 0; index < NumModules; index++ )
+			{
+				CoverageFileModule_t& FileModule = FileModules[index];
+				int NameLength = 0;
+
+				if( !ReadBytes(hFile, &NameLength, sizeof(int)) || (NameLength <= 0) || (NameLength >= MODULE_NAME_SIZE) ||
+					!ReadBytes(hFile, FileModule.Name, NameLength) ||
+					!ReadBytes(hFile, &FileModule.ImageSize, sizeof(DWORD)) ||
+					!ReadBytes(hFile, &FileModule.TimeDateStamp, sizeof(DWORD)) ||
+					!ReadBytes(hFile, &FileModule.BitmapSize, sizeof(DWORD)) )
+				{
+					DebugLog("WriteCoverageFile(): '%s' is corrupt, ignoring the rest of the file", InFilename);
+					break;
+				}
+
+				FileModule.Name[NameLength] = 0;
+				FileModule.Bitmap = (unsigned char*)FileAllocator.AllocateBytes(FileModule.BitmapSize, sizeof(void*));
+				FileModule.bIsLoaded = false;
+
+				if( !ReadBytes(hFile, FileModule.Bitmap, FileModule.BitmapSize) )
+				{
+					DebugLog("WriteCoverageFile(): '%s' is corrupt, ignoring the rest of the file", InFilename);
+					break;
+				}
+
+				NumFileModules++;
+			}
+		}
+
+		// merge the bitmaps from the file into our bitmaps (modules from the file that aren't loaded in this process are kept as they are)
+		int NumLoadedModules = gModuleTable->GetNumModules();
+
+		for( int file_index = 0; file_index < NumFileModules; file_index++ )
+		{
+			CoverageFileModule_t& FileModule = FileModules[file_index];
+
+			for( int index = 0; index < NumLoadedModules; index++ )
+			{
+				ModuleRecord_t* Module = gModuleTable->GetModule(index);
+
+				if( (Module->CoverageBitmap != nullptr) && (_stricmp(Module->Name, FileModule.Name) == 0) &&
+					(Module->Size == FileModule.ImageSize) && (Module->TimeDateStamp == FileModule.TimeDateStamp) &&
+					(FileModule.BitmapSize == (DWORD)((Module->Size + 7) / 8)) )
+				{
+					for( DWORD byte_index = 0; byte_index < FileModule.BitmapSize; byte_index++ )
+					{
+						Module->CoverageBitmap[byte_index] |= FileModule.Bitmap[byte_index];
+					}
+
+					FileModule.bIsLoaded = true;
+					break;
+				}
+			}
+		}
+
+		// write out the merged coverage data
+		int NumModules_Out = 0;
+
+		for( int file_index = 0; file_index < NumFileModules; file_index++ )
+		{
+			if( !FileModules[file_index].bIsLoaded )
+			{
+				NumModules_Out++;
+			}
+		}
+
+		for( int index = 0; index < NumLoadedModules; index++ )
+		{
+			if( gModuleTable->GetModule(index)->CoverageBitmap != nullptr )
+			{
+				NumModules_Out++;
+			}
+		}
+
+		SetFilePointer(hFile, 0, NULL, FILE_BEGIN);
+		SetEndOfFile(hFile);
+
+		bool bSuccess = WriteBytes(hFile, COVERAGE_FILE_MAGIC, 8) && WriteBytes(hFile, &NumModules_Out, sizeof(int));
+
+		for( int file_index = 0; bSuccess && (file_index < NumFileModules); file_index++ )
+		{
+			CoverageFileModule_t& FileModule = FileModules[file_index];
+
+			if( !FileModule.bIsLoaded )
+			{
+				int NameLength = (int)strlen(FileModule.Name);
+
+				bSuccess = WriteBytes(hFile, &NameLength, sizeof(int)) && WriteBytes(hFile, FileModule.Name, NameLength) &&
+					WriteBytes(hFile, &FileModule.ImageSize, sizeof(DWORD)) && WriteBytes(hFile, &FileModule.TimeDateStamp, sizeof(DWORD)) &&
+					WriteBytes(hFile, &FileModule.BitmapSize, sizeof(DWORD)) && WriteBytes(hFile, FileModule.Bitmap, FileModule.BitmapSize);
+			}
+		}
+
+		int NumFunctionsCovered = 0;
+
+		for( int index = 0; bSuccess && (index < NumLoadedModules); index++ )
+		{
+			ModuleRecord_t* Module = gModuleTable->GetModule(index);
+
+			if( Module->CoverageBitmap != nullptr )
+			{
+				int NameLength = (int)strlen(Module->Name);
+				DWORD ImageSize = (DWORD)Module->Size;
+				DWORD BitmapSize = (DWORD)((Module->Size + 7) / 8);
+
+				bSuccess = WriteBytes(hFile, &NameLength, sizeof(int)) && WriteBytes(hFile, Module->Name, NameLength) &&
+					WriteBytes(hFile, &ImageSize, sizeof(DWORD)) && WriteBytes(hFile, &Module->TimeDateStamp, sizeof(DWORD)) &&
+					WriteBytes(hFile, &BitmapSize, sizeof(DWORD)) && WriteBytes(hFile, (const void*)Module->CoverageBitmap, BitmapSize);
+
+				for( DWORD byte_index = 0; byte_index < BitmapSize; byte_index++ )
+				{
+					NumFunctionsCovered += (int)__popcnt16(Module->CoverageBitmap[byte_index]);
+				}
+			}
+		}
+
+		if( !bSuccess )
+		{
+			DebugLog("WriteCoverageFile(): Error writing '%s' (error = %d)", InFilename, GetLastError());
+		}
+		else
+		{
+			DebugLog("WriteCoverageFile(): Wrote %d modules to '%s' (%d functions covered in this process's modules)", NumModules_Out, InFilename, NumFunctionsCovered);
+		}
+
+		CloseHandle(hFile);
+	}
+
+	FileAllocator.FreeBlocks();
+
+	if( hMutex )
+	{
+		ReleaseMutex(hMutex);
+		CloseHandle(hMutex);
+	}
+}
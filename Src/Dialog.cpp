@@ -5,11 +5,15 @@
 #include <Windows.h>
 #include <windowsx.h>
 #include <TlHelp32.h>
+#include <commdlg.h>
 
 #include "Splitter.h"
 #include "Dialog.h"
 #include "TextViewer.h"
 #include "Config.h"
+#include "Phase.h"
+#include "Export.h"
+#include "MemoryStats.h"
 
 #include "DebugLog.h"
 
@@ -19,6 +23,8 @@ extern CAllocator SymbolAllocator;
 extern CAllocator DialogAllocator;
 extern CAllocator TextViewerAllocator;
 
+extern bool bOptionDisplayTimeAsTicks;
+
 extern TextLineBuffer line_buffer;
 
 // Global Variables:
@@ -30,6 +36,7 @@ CConfig* gConfig = nullptr;
 
 int NumThreads;  // for stat tracking
 int NumCallTreeRecords;  // for stat tracking
+int NumFunctionRecords;  // for stat tracking
 
 // child windows
 HWND hChildWindowFunctions;
@@ -208,6 +215,70 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 						}
 						break;
 
+					case IDM_EXPORT:
+						{
+							if( !bIsCaptureInProgress )  // symbol lookup can't be done by two threads at the same time
+							{
+								TCHAR ExportFilename[MAX_PATH];
+								ExportFilename[0] = 0;
+
+								OPENFILENAME ofn;
+								memset(&ofn, 0, sizeof(ofn));
+
+								ofn.lStructSize = sizeof(ofn);
+								ofn.hwndOwner = hWnd;
+								ofn.lpstrFilter = TEXT("Aeon Profile (*.csv)\0*.csv\0All Files (*.*)\0*.*\0");
+								ofn.lpstrFile = ExportFilename;
+								ofn.nMaxFile = MAX_PATH;
+								ofn.lpstrDefExt = TEXT("csv");
+								ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST | OFN_NOCHANGEDIR;
+
+								if( GetSaveFileName(&ofn) )
+								{
+									char Filename[MAX_PATH];
+									ConvertTCHARtoCHAR(ExportFilename, Filename, MAX_PATH);
+
+									if( !ExportProfileData(Filename) )
+									{
+										MessageBox(hWnd, TEXT("Failed to export the profile data."), szTitle, MB_OK | MB_ICONERROR);
+									}
+								}
+							}
+						}
+						break;
+
+					case IDM_EXPORT_TRACE:
+						{
+							if( !bIsCaptureInProgress )  // symbol lookup can't be done by two threads at the same time
+							{
+								TCHAR ExportFilename[MAX_PATH];
+								ExportFilename[0] = 0;
+
+								OPENFILENAME ofn;
+								memset(&ofn, 0, sizeof(ofn));
+
+								ofn.lStructSize = sizeof(ofn);
+								ofn.hwndOwner = hWnd;
+								ofn.lpstrFilter = TEXT("Chrome Trace (*.json)\0*.json\0All Files (*.*)\0*.*\0");
+								ofn.lpstrFile = ExportFilename;
+								ofn.nMaxFile = MAX_PATH;
+								ofn.lpstrDefExt = TEXT("json");
+								ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST | OFN_NOCHANGEDIR;
+
+								if( GetSaveFileName(&ofn) )
+								{
+									char Filename[MAX_PATH];
+									ConvertTCHARtoCHAR(ExportFilename, Filename, MAX_PATH);
+
+									if( !ExportFlowTrace(Filename) )
+									{
+										MessageBox(hWnd, TEXT("Failed to export the flow trace."), szTitle, MB_OK | MB_ICONERROR);
+									}
+								}
+							}
+						}
+						break;
+
 					case IDM_EXIT:
 						KillTimer(NULL, 1);
 						PostMessage( hWnd, WM_CLOSE, NULL, 0L );
@@ -248,6 +319,47 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 						}
 						break;
 
+					case IDM_PHASE:
+						{
+							// build a popup menu of the phases that the application has started so far
+							HMENU hPopupMenu = CreatePopupMenu();
+
+							AppendMenu(hPopupMenu, MF_ENABLED | MF_STRING | ((DialogPhaseIndex < 0) ? MF_CHECKED : MF_UNCHECKED), 1, TEXT("Current Phase"));
+							AppendMenu(hPopupMenu, MF_SEPARATOR, 0, NULL);
+
+							if( TryEnterCriticalSection(&gCriticalSection) == 0 )
+							{
+								EnterCriticalSection(&gCriticalSection);
+							}
+
+							for( int PhaseIndex = 0; PhaseIndex < NumPhases; PhaseIndex++ )
+							{
+								TCHAR wPhaseName[PHASE_NAME_SIZE];
+								size_t num_chars;
+								mbstowcs_s(&num_chars, wPhaseName, _countof(wPhaseName), Phases[PhaseIndex].Name, _TRUNCATE);
+
+								AppendMenu(hPopupMenu, MF_ENABLED | MF_STRING | ((DialogPhaseIndex == PhaseIndex) ? MF_CHECKED : MF_UNCHECKED), PhaseIndex + 2, wPhaseName);
+							}
+
+							LeaveCriticalSection(&gCriticalSection);
+
+							POINT cursor_pos;
+							GetCursorPos(&cursor_pos);
+							SetForegroundWindow(hWnd);
+
+							int result = TrackPopupMenu(hPopupMenu, TPM_TOPALIGN | TPM_LEFTALIGN | TPM_RETURNCMD, cursor_pos.x, cursor_pos.y, 0, hWnd, NULL);
+
+							DestroyMenu(hPopupMenu);
+
+							if( result > 0 )
+							{
+								DialogPhaseIndex = result - 2;  // "Current Phase" is -1
+
+								PostMessage(hWnd, WM_COMMAND, MAKEWPARAM(IDM_CAPTURE,0), 0);  // capture the data for the selected phase
+							}
+						}
+						break;
+
 					default:
 						return DefWindowProc(hWnd, message, wParam, lParam);
 				}
@@ -445,7 +557,7 @@ LRESULT CALLBACK WndProcTextViewer(HWND hWnd, UINT message, WPARAM wParam, LPARA
 			si.cbSize = sizeof(si);
 			si.fMask  = SIF_RANGE | SIF_PAGE;
 			si.nMin   = 0;
-			si.nMax   = line_buffer.max_line_length;
+			si.nMax   = line_buffer.max_line_length + (line_buffer.line_samples ? TEXTVIEWER_SAMPLES_GUTTER_CHARS : 0);
 			si.nPage  = last_horizontal_size / xChar;
 			SetScrollInfo(hWnd, SB_HORZ, &si, TRUE);
 
@@ -472,7 +584,7 @@ LRESULT CALLBACK WndProcTextViewer(HWND hWnd, UINT message, WPARAM wParam, LPARA
 			si.cbSize = sizeof(si);
 			si.fMask  = SIF_RANGE | SIF_PAGE;
 			si.nMin   = 0;
-			si.nMax   = line_buffer.max_line_length;
+			si.nMax   = line_buffer.max_line_length + (line_buffer.line_samples ? TEXTVIEWER_SAMPLES_GUTTER_CHARS : 0);
 			si.nPage  = last_horizontal_size / xChar;
 			SetScrollInfo(hWnd, SB_HORZ, &si, TRUE);
 
@@ -706,9 +818,11 @@ LRESULT CALLBACK WndProcTextViewer(HWND hWnd, UINT message, WPARAM wParam, LPARA
 			int FirstLine = max(0, yPos + ps.rcPaint.top / yChar);
 			int LastLine = min(line_buffer.num_lines - 1, yPos + ps.rcPaint.bottom / yChar);
 
+			int GutterChars = line_buffer.line_samples ? TEXTVIEWER_SAMPLES_GUTTER_CHARS : 0;
+
 			for (int i = FirstLine; i <= LastLine; i++)
 			{
-				int x = xChar * -xPos;
+				int x = xChar * (GutterChars - xPos);
 				int y = yChar * (i - yPos);
 
 				TextLineNode* linenode = line_buffer.linenode[i];
@@ -743,6 +857,25 @@ LRESULT CALLBACK WndProcTextViewer(HWND hWnd, UINT message, WPARAM wParam, LPARA
 
 				// Write a line of text to the client area.
 				TextOut(hdc, x, y, wText, (int)wNumChars); 
+
+				if( GutterChars )  // the line's samples go in a gutter on the left (drawn over the text, so it doesn't scroll horizontally)
+				{
+					RECT GutterRect = { 0, y, xChar * GutterChars, y + yChar };
+
+					int Samples = line_buffer.line_samples[i];
+					int Heat = (Samples && line_buffer.max_line_samples) ? (48 + (207 * Samples) / line_buffer.max_line_samples) : 0;  // hotter lines are redder
+
+					WCHAR wSamples[16];
+					wSamples[0] = 0;
+					if( Samples )
+					{
+						swprintf(wSamples, 16, TEXT("%*d "), GutterChars - 1, Samples);
+					}
+
+					COLORREF OldBkColor = SetBkColor(hdc, RGB(255, 255 - Heat, 255 - Heat));
+					ExtTextOut(hdc, 0, y, ETO_OPAQUE | ETO_CLIPPED, &GutterRect, wSamples, (UINT)wcslen(wSamples), NULL);
+					SetBkColor(hdc, OldBkColor);
+				}
 			}
 
 			SelectObject(hdc, hOldFont);
@@ -932,125 +1065,498 @@ INT_PTR CALLBACK ResetModalDialog(HWND hDlg, UINT message, WPARAM wParam, LPARAM
 	return (INT_PTR)FALSE;
 }
 
-INT_PTR CALLBACK ThreadIdModalDialog(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
+#define THREAD_TIMELINE_COLUMNS 32  /* number of characters in the thread activity timeline in the ThreadID dialog */
+
+// Format a thread's activity as a fixed width timeline (one character per interval, from when the profiler was loaded to now, darker
+// characters are busier) followed by the percentage of the thread's lifetime that it was busy.  Returns the busy percentage.
+static int FormatThreadActivity(TCHAR* OutBuffer, size_t InBufferLen, const ThreadActivity_t* InActivity)
 {
-	HDC hDC;
-	TEXTMETRIC tm;
-	SIZE size;
-	TCHAR buffer[1024];
-	TCHAR wSymbolName[1024];
+	static const TCHAR BusyChars[] = TEXT(" .:-=+*#%@");
+	const int NumBusyChars = _countof(BusyChars) - 1;
+
+	TCHAR Timeline[THREAD_TIMELINE_COLUMNS + 1];
+	float BusyFractions[THREAD_TIMELINE_COLUMNS];
+
+	InActivity->Timeline.GetBusyFractions(InActivity->CaptureTime, BusyFractions, THREAD_TIMELINE_COLUMNS);
+
+	for( int Column = 0; Column < THREAD_TIMELINE_COLUMNS; Column++ )
+	{
+		int index = (int)(BusyFractions[Column] * (NumBusyChars - 1) + 0.999f);  // (anything that's busy at all gets at least a '.')
+		Timeline[Column] = BusyChars[min(max(index, 0), NumBusyChars - 1)];
+	}
+	Timeline[THREAD_TIMELINE_COLUMNS] = 0;
+
+	__int64 LifetimeStart = max(InActivity->CreateTime, 0LL);
+	__int64 LifetimeEnd = (InActivity->ExitTime >= 0) ? InActivity->ExitTime : InActivity->CaptureTime;
+	int BusyPercent = (LifetimeEnd > LifetimeStart) ? (int)min(InActivity->Timeline.BusyTimeSum * 100 / (LifetimeEnd - LifetimeStart), 100LL) : 0;
+
+	swprintf(OutBuffer, InBufferLen, TEXT("|%s| %3d%%"), Timeline, BusyPercent);
+
+	return BusyPercent;
+}
+
+// Open addressing hash set of thread ids (the threads running in the process when the ThreadID dialog was opened), so checking
+// whether each captured thread is still running doesn't scan the whole list of running threads.
+struct ThreadIdSet_t
+{
+	DWORD* Slots;  // 0 is an empty slot (0 is never a valid thread id)
+	unsigned int SlotBits;
+
+	void Init(CAllocator* InAllocator, unsigned int InMaxThreadIds)
+	{
+		SlotBits = 4;
+		while( (1U << SlotBits) < InMaxThreadIds * 2 )  // keep the set at most half full
+		{
+			SlotBits++;
+		}
+
+		Slots = (DWORD*)InAllocator->AllocateBytes((1U << SlotBits) * sizeof(DWORD), sizeof(DWORD));
+		memset(Slots, 0, (1U << SlotBits) * sizeof(DWORD));
+	}
+
+	unsigned int GetSlot(DWORD InThreadId) const
+	{
+		return (InThreadId * 2654435761U) >> (32 - SlotBits);  // (thread ids are multiples of 4, so use the high bits of the product)
+	}
+
+	void Add(DWORD InThreadId)
+	{
+		unsigned int Mask = (1U << SlotBits) - 1;
+
+		for( unsigned int Slot = GetSlot(InThreadId); ; Slot = (Slot + 1) & Mask )
+		{
+			if( (Slots[Slot] == 0) || (Slots[Slot] == InThreadId) )
+			{
+				Slots[Slot] = InThreadId;
+				return;
+			}
+		}
+	}
+
+	bool Contains(DWORD InThreadId) const
+	{
+		unsigned int Mask = (1U << SlotBits) - 1;
+
+		for( unsigned int Slot = GetSlot(InThreadId); Slots[Slot] != 0; Slot = (Slot + 1) & Mask )
+		{
+			if( Slots[Slot] == InThreadId )
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+struct ThreadIdDialogRow_t  // one row of the ThreadID dialog's list (a captured thread or thread group)
+{
+	DialogThreadIdRecord_t* ThreadRec;
+
+	TCHAR ActivityText[THREAD_TIMELINE_COLUMNS + 16];
+	int BusyPercent;
+
+	__int64 CallCount;  // total calls of all of the thread's functions
+	__int64 TotalTime;  // sum of the exclusive time of all of the thread's functions (the time the thread spent in profiled code)
+	unsigned int StackDepth;  // the thread's call stack depth when the data was captured
+
+	bool bIsRunning;
+};
+
+ListViewColumnsDefaults ThreadIdDialogColumns[] = {
+	{ TEXT("Activity"), SORT_Decreasing, false, 250, true },				// column 1 (the activity timeline and busy percentage)
+	{ TEXT("Entry Function"), SORT_Increasing, false, 220, true },			// column 2 (the thread's entry function or the group name)
+	{ TEXT("ThreadId"), SORT_Increasing, false, 110, false },				// column 3 (the thread id or the number of threads in the group)
+	{ TEXT("Times Called"), SORT_Decreasing, false, 90, false },			// column 4 (calls of all of the thread's functions)
+	{ TEXT("Total Time"), SORT_Decreasing, true, 110, false },				// column 5 (exclusive time of all of the thread's functions)
+	{ TEXT("Stack Depth"), SORT_Decreasing, false, 80, false },				// column 6 (call stack depth at the time of the capture)
+	{ TEXT("State"), SORT_Increasing, false, 70, true },					// column 7 (running, exited or group)
+};
+
+static CAllocator ThreadIdDialogAllocator;  // allocator for the ThreadID dialog's rows (freed when the dialog closes)
+
+static ThreadIdDialogRow_t* ThreadIdDialogRows = nullptr;  // all of the captured threads
+static unsigned int NumThreadIdDialogRows = 0;
+static ThreadIdDialogRow_t** ThreadIdDialogVisibleRows = nullptr;  // the rows matching the search text (in sorted order, the ListView is virtual and displays these)
+static unsigned int NumThreadIdDialogVisibleRows = 0;
+static int ThreadIdDialogSortColumn = -1;
+
+static bool ThreadIdDialogRowMatches(const ThreadIdDialogRow_t* InRow, const char* InSearchText)  // InSearchText is lower case
+{
+	if( InSearchText[0] == 0 )
+	{
+		return true;
+	}
+
+	char Text[1024];
+
+	strncpy_s(Text, sizeof(Text), InRow->ThreadRec->SymbolName ? InRow->ThreadRec->SymbolName : "", _TRUNCATE);
+	_strlwr_s(Text, sizeof(Text));
+
+	if( strstr(Text, InSearchText) )
+	{
+		return true;
+	}
+
+	sprintf_s(Text, sizeof(Text), "%u", InRow->ThreadRec->ThreadId);
+
+	return (InRow->ThreadRec->NumGroupThreads == 0) && (strstr(Text, InSearchText) != nullptr);
+}
+
+static int ThreadIdDialogSortRows(const void* arg1, const void* arg2)
+{
+	const ThreadIdDialogRow_t* Row1 = *(ThreadIdDialogRow_t**)arg1;
+	const ThreadIdDialogRow_t* Row2 = *(ThreadIdDialogRow_t**)arg2;
+
+	int sort_column = ThreadIdDialogSortColumn;
+	int result = 0;
+
+	if( sort_column == 0 )  // sort by Activity
+	{
+		result = Row1->BusyPercent - Row2->BusyPercent;
+	}
+	else if( sort_column == 1 )  // sort by Entry Function
+	{
+		result = strcmp(Row1->ThreadRec->SymbolName ? Row1->ThreadRec->SymbolName : "", Row2->ThreadRec->SymbolName ? Row2->ThreadRec->SymbolName : "");
+	}
+	else if( sort_column == 2 )  // sort by ThreadId
+	{
+		result = (Row1->ThreadRec->ThreadId < Row2->ThreadRec->ThreadId) ? -1 : ((Row1->ThreadRec->ThreadId > Row2->ThreadRec->ThreadId) ? 1 : 0);
+	}
+	else if( sort_column == 3 )  // sort by Times Called
+	{
+		result = (Row1->CallCount < Row2->CallCount) ? -1 : ((Row1->CallCount > Row2->CallCount) ? 1 : 0);
+	}
+	else if( sort_column == 4 )  // sort by Total Time
+	{
+		result = (Row1->TotalTime < Row2->TotalTime) ? -1 : ((Row1->TotalTime > Row2->TotalTime) ? 1 : 0);
+	}
+	else if( sort_column == 5 )  // sort by Stack Depth
+	{
+		result = (int)Row1->StackDepth - (int)Row2->StackDepth;
+	}
+	else if( sort_column == 6 )  // sort by State (groups, then running, then exited)
+	{
+		int State1 = (Row1->ThreadRec->NumGroupThreads > 0) ? 0 : (Row1->bIsRunning ? 1 : 2);
+		int State2 = (Row2->ThreadRec->NumGroupThreads > 0) ? 0 : (Row2->bIsRunning ? 1 : 2);
+		result = State1 - State2;
+	}
+
+	if( result == 0 )  // keep the order stable for equal rows
+	{
+		result = (Row1 < Row2) ? -1 : ((Row1 > Row2) ? 1 : 0);
+	}
+
+	return (ThreadIdDialogColumns[sort_column].ColumnSortType == SORT_Increasing) ? result : -result;
+}
+
+static void ThreadIdDialogSetSortColumn(HWND hList, int InColumn)  // set the column to sort by and the header's sort arrows
+{
+	ThreadIdDialogSortColumn = InColumn;
+
+	HWND hheader = ListView_GetHeader(hList);
+
+	for( int column = 0; column < _countof(ThreadIdDialogColumns); column++ )
+	{
+		HDITEM item;
+		memset(&item, 0, sizeof(item));
+
+		item.mask = HDI_FORMAT;
+		item.fmt = HDF_STRING | (ThreadIdDialogColumns[column].bLeftJustify ? HDF_LEFT : HDF_RIGHT);
+
+		if( column == InColumn )
+		{
+			item.fmt |= (ThreadIdDialogColumns[column].ColumnSortType == SORT_Increasing) ? HDF_SORTUP : HDF_SORTDOWN;
+		}
+
+		Header_SetItem(hheader, column, &item);
+	}
+}
+
+// Rebuild the list of visible rows from the search text, sort them and select the thread currently being displayed (if it's visible).
+static void ThreadIdDialogUpdateRows(HWND hDlg)
+{
+	HWND hList = GetDlgItem(hDlg, IDC_THREADID_LIST);
+
+	TCHAR wSearchText[256];
+	char SearchText[256];
+	size_t num_chars;
+
+	GetDlgItemText(hDlg, IDC_THREADID_SEARCH, wSearchText, _countof(wSearchText));
+	wcstombs_s(&num_chars, SearchText, sizeof(SearchText), wSearchText, _TRUNCATE);
+	_strlwr_s(SearchText, sizeof(SearchText));
+
+	NumThreadIdDialogVisibleRows = 0;
+
+	for( unsigned int index = 0; index < NumThreadIdDialogRows; index++ )
+	{
+		if( ThreadIdDialogRowMatches(&ThreadIdDialogRows[index], SearchText) )
+		{
+			ThreadIdDialogVisibleRows[NumThreadIdDialogVisibleRows++] = &ThreadIdDialogRows[index];
+		}
+	}
+
+	qsort(ThreadIdDialogVisibleRows, NumThreadIdDialogVisibleRows, sizeof(void*), ThreadIdDialogSortRows);
+
+	ListView_SetItemCountEx(hList, NumThreadIdDialogVisibleRows, 0);
+	ListView_SetItemState(hList, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+
+	for( unsigned int index = 0; index < NumThreadIdDialogVisibleRows; index++ )
+	{
+		if( ThreadIdDialogVisibleRows[index]->ThreadRec->ThreadId == DialogCallTreeThreadId )
+		{
+			ListView_SetItemState(hList, index, LVIS_SELECTED | LVIS_FOCUSED, LVIS_SELECTED | LVIS_FOCUSED);
+			ListView_EnsureVisible(hList, index, FALSE);
+			break;
+		}
+	}
+
+	InvalidateRect(hList, NULL, FALSE);
+}
+
+static void ThreadIdDialogGetDispInfo(NMLVDISPINFO* lpdi)
+{
+	if( ((lpdi->item.mask & LVIF_TEXT) == 0) || (lpdi->item.iItem < 0) || ((unsigned int)lpdi->item.iItem >= NumThreadIdDialogVisibleRows) )
+	{
+		return;
+	}
+
+	const ThreadIdDialogRow_t* Row = ThreadIdDialogVisibleRows[lpdi->item.iItem];
+	const DialogThreadIdRecord_t* ThreadRec = Row->ThreadRec;
+
+	TCHAR Buffer[1024];
+	size_t buffer_len = _countof(Buffer);
+	size_t num_chars;
+
+	Buffer[0] = 0;
+
+	int column = lpdi->item.iSubItem;
+
+	if( column == 0 )  // activity
+	{
+		wcscpy_s(Buffer, buffer_len, Row->ActivityText);
+	}
+	else if( column == 1 )  // entry function
+	{
+		mbstowcs_s(&num_chars, Buffer, buffer_len, ThreadRec->SymbolName ? ThreadRec->SymbolName : "", _TRUNCATE);
+	}
+	else if( column == 2 )  // thread id
+	{
+		if( ThreadRec->NumGroupThreads > 0 )  // a thread group (see ThreadGroups.h)
+		{
+			swprintf(Buffer, buffer_len, TEXT("Group of %u"), ThreadRec->NumGroupThreads);
+		}
+		else
+		{
+			swprintf(Buffer, buffer_len, TEXT("%d"), ThreadRec->ThreadId);
+		}
+	}
+	else if( column == 3 )  // times called
+	{
+		swprintf(Buffer, buffer_len, TEXT("%I64d"), Row->CallCount);
+	}
+	else if( column == 4 )  // total time
+	{
+		if( bOptionDisplayTimeAsTicks )
+		{
+			swprintf(Buffer, buffer_len, TEXT("%I64d"), Row->TotalTime);
+		}
+		else
+		{
+			ConvertTicksToTime(Buffer, buffer_len, Row->TotalTime);
+		}
+	}
+	else if( column == 5 )  // stack depth
+	{
+		swprintf(Buffer, buffer_len, TEXT("%u"), Row->StackDepth);
+	}
+	else if( column == 6 )  // state
+	{
+		wcscpy_s(Buffer, buffer_len, (ThreadRec->NumGroupThreads > 0) ? TEXT("group") : (Row->bIsRunning ? TEXT("running") : TEXT("exited")));
+	}
 
-	static DWORD ProcessThreadIds[512];
-	static unsigned int NumberOfThreads = 0;
+	wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, _TRUNCATE);
+}
 
+static void ThreadIdDialogSelectThread(HWND hDlg, int row)  // display the thread (or thread group) in the given row
+{
+	if( (row >= 0) && ((unsigned int)row < NumThreadIdDialogVisibleRows) )
+	{
+		DialogCallTreeThreadId = ThreadIdDialogVisibleRows[row]->ThreadRec->ThreadId;
+
+		PostMessage(ghDialogWnd, WM_DISPLAYCALLTREEDATA, 0, 0);
+	}
+}
+
+INT_PTR CALLBACK ThreadIdModalDialog(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
+{
 	switch (message)
 	{
 		case WM_INITDIALOG:
 			{
+				ThreadIdDialogAllocator.FreeBlocks();
+
+				ThreadIdDialogRows = nullptr;
+				NumThreadIdDialogRows = 0;
+				ThreadIdDialogVisibleRows = nullptr;
+				NumThreadIdDialogVisibleRows = 0;
+
 				DWORD PID = GetCurrentProcessId();
 
-				// get the list of threads running in this process
+				// get the set of threads running in this process
+				ThreadIdSet_t RunningThreads;
+
 				HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
 				if (hSnapshot != INVALID_HANDLE_VALUE)
 				{
 					THREADENTRY32 te;
 					te.dwSize = sizeof(te);
+
+					unsigned int NumberOfThreads = 0;  // (count the threads first so the set can be sized for them)
+					if( Thread32First(hSnapshot, &te) )
+					{
+						do
+						{
+							NumberOfThreads++;
+						} while( Thread32Next(hSnapshot, &te) );
+					}
+
+					RunningThreads.Init(&ThreadIdDialogAllocator, NumberOfThreads);
+
 					if( Thread32First(hSnapshot, &te) )
 					{
 						do
 						{
 							if( te.th32OwnerProcessID == PID )
 							{
-								ProcessThreadIds[NumberOfThreads++] = te.th32ThreadID;
+								RunningThreads.Add(te.th32ThreadID);
 							}
 						} while( Thread32Next(hSnapshot, &te) );
 					}
 
 					CloseHandle(hSnapshot);
 				}
+				else
+				{
+					RunningThreads.Init(&ThreadIdDialogAllocator, 0);
+				}
 
-				hDC = GetDC( hDlg );
-				SelectObject(hDC, (HFONT)SendDlgItemMessage(hDlg, IDC_THREADID_LIST, WM_GETFONT, NULL, NULL));
-				GetTextMetrics( hDC, &tm );
-
-				CenterWindow(hDlg);
-
-				SendDlgItemMessage(hDlg, IDC_THREADID_LIST, LB_RESETCONTENT, 0, 0);
-
-				int max_len = 0;
-				size_t buffer_len = _countof(buffer);
-				size_t wSymbolName_len = _countof(wSymbolName);
-
-				// populate the ListBox
-				for( unsigned int ThreadIndex = 0; ThreadIndex < CaptureCallTreeThreadArraySize; ThreadIndex++ )
+				// make a row for each captured thread (with the summary of all of the thread's functions)
+				if( CaptureCallTreeThreadArrayPointer && CaptureCallTreeThreadArraySize )
 				{
-					DialogThreadIdRecord_t* ThreadRec = (DialogThreadIdRecord_t*)CaptureCallTreeThreadArrayPointer[ThreadIndex];
+					ThreadIdDialogRows = (ThreadIdDialogRow_t*)ThreadIdDialogAllocator.AllocateBytes(CaptureCallTreeThreadArraySize * sizeof(ThreadIdDialogRow_t), sizeof(void*));
+					ThreadIdDialogVisibleRows = (ThreadIdDialogRow_t**)ThreadIdDialogAllocator.AllocateBytes(CaptureCallTreeThreadArraySize * sizeof(void*), sizeof(void*));
 
-					if( ThreadRec )
+					for( unsigned int ThreadIndex = 0; ThreadIndex < CaptureCallTreeThreadArraySize; ThreadIndex++ )
 					{
-						// see if the thread id is in the list of threads currently running in this process
-						bool bIsThreadRunning = false;
-						for( unsigned int index = 0; index < NumberOfThreads; index++ )
+						DialogThreadIdRecord_t* ThreadRec = (DialogThreadIdRecord_t*)CaptureCallTreeThreadArrayPointer[ThreadIndex];
+
+						if( ThreadRec == nullptr )
 						{
-							if( ProcessThreadIds[index] == ThreadRec->ThreadId )
-							{
-								bIsThreadRunning = true;
-								break;
-							}
+							continue;
 						}
 
-						bool bShowInactiveThreads = true;  // OPTIONS
-						bool bShowThreadsWithNoData = true;  // NAME THIS SOMETHING BETTER
+						ThreadIdDialogRow_t& Row = ThreadIdDialogRows[NumThreadIdDialogRows++];
+						memset(&Row, 0, sizeof(ThreadIdDialogRow_t));
 
-						bool bShouldShowThread = (bShowInactiveThreads || bIsThreadRunning) && (bShowThreadsWithNoData || (ThreadRec->CallTreeArraySize > 0));
+						Row.ThreadRec = ThreadRec;
+						Row.BusyPercent = FormatThreadActivity(Row.ActivityText, _countof(Row.ActivityText), ThreadRec->Activity);
+						Row.StackDepth = ThreadRec->StackArraySize;
+						Row.bIsRunning = (ThreadRec->NumGroupThreads > 0) ? (ThreadRec->Activity->ExitTime < 0) : RunningThreads.Contains(ThreadRec->ThreadId);
 
-						if( bShouldShowThread )
+						if( ThreadRec->Columns )
 						{
-							size_t len = min(wSymbolName_len, strlen(ThreadRec->SymbolName));
-							size_t num_chars;
-							mbstowcs_s(&num_chars, wSymbolName, wSymbolName_len, ThreadRec->SymbolName, len);
-							wSymbolName[num_chars] = 0;
+							ThreadRec->Columns->GetTotals(Row.CallCount, Row.TotalTime);
+						}
+					}
+				}
 
-							swprintf(buffer, buffer_len, TEXT("%s (ThreadId = %d)"), wSymbolName, ThreadRec->ThreadId);
+				// set up the virtual ListView (only the visible rows are formatted, so this stays fast with thousands of threads)
+				HWND hList = GetDlgItem(hDlg, IDC_THREADID_LIST);
 
-							int listbox_index = (int)SendDlgItemMessage(hDlg, IDC_THREADID_LIST, LB_ADDSTRING, 0, (LPARAM)buffer);
-							SendDlgItemMessage(hDlg, IDC_THREADID_LIST, LB_SETITEMDATA, (WPARAM)listbox_index, (LPARAM)ThreadRec);  // store the DialogThreadIdRecord_t so get can get it later
+				SendMessage(hList, WM_SETFONT, (WPARAM)GetStockObject(ANSI_FIXED_FONT), FALSE);  // use a fixed width font so that the activity timelines line up
+				ListView_SetExtendedListViewStyle(hList, ListView_GetExtendedListViewStyle(hList) | LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
 
-							len = wcslen(buffer);
+				int DefaultSortColumn = 0;
 
-							GetTextExtentPoint32(hDC, buffer, (int)len, &size);
+				for( int i = 0; i < _countof(ThreadIdDialogColumns); i++ )
+				{
+					ListViewColumnsDefaults& ColumnDefaults = ThreadIdDialogColumns[i];
 
-							if( size.cx > max_len )
-							{
-								max_len = size.cx;
-							}
-						}
+					LVCOLUMN lvc;
+					lvc.iSubItem = i;
+					lvc.pszText = ColumnDefaults.ColumnName;
+					lvc.mask = LVCF_WIDTH | LVCF_TEXT | LVCF_FMT | LVCF_SUBITEM;
+					lvc.cx = ColumnDefaults.ColumnWidth;
+					lvc.fmt = ColumnDefaults.bLeftJustify ? LVCFMT_LEFT : LVCFMT_RIGHT;
+
+					if( ColumnDefaults.bIsDefaultSortColumn )
+					{
+						DefaultSortColumn = i;
 					}
+
+					ListView_InsertColumn(hList, i, &lvc);
 				}
 
-				SendDlgItemMessage( hDlg, IDC_THREADID_LIST, LB_SETHORIZONTALEXTENT, max_len + tm.tmAveCharWidth, 0);
+				ThreadIdDialogSetSortColumn(hList, (ThreadIdDialogSortColumn >= 0) ? ThreadIdDialogSortColumn : DefaultSortColumn);  // (keep the sort from the last time the dialog was open)
 
-				ReleaseDC( hDlg, hDC );
+				CenterWindow(hDlg);
 
-				return (INT_PTR)TRUE;
+				ThreadIdDialogUpdateRows(hDlg);
+
+				SetFocus(GetDlgItem(hDlg, IDC_THREADID_SEARCH));
+
+				return (INT_PTR)FALSE;  // (we set the focus)
 			}
 
-		case WM_COMMAND:
-			if( (LOWORD(wParam) == IDOK) || ((LOWORD(wParam) == IDC_THREADID_LIST) && (HIWORD(wParam) == LBN_DBLCLK)) )
+		case WM_NOTIFY:
 			{
-				EndDialog(hDlg, LOWORD(wParam));
+				LPNMHDR pnmh = (LPNMHDR)lParam;
+
+				if( pnmh->idFrom != IDC_THREADID_LIST )
+				{
+					break;
+				}
+
+				if( pnmh->code == LVN_GETDISPINFO )
+				{
+					ThreadIdDialogGetDispInfo((NMLVDISPINFO*)lParam);
+					return (INT_PTR)TRUE;
+				}
+				else if( pnmh->code == LVN_COLUMNCLICK )
+				{
+					int column = ((LPNMLISTVIEW)lParam)->iSubItem;
 
-				int listbox_index = (int)SendDlgItemMessage(hDlg, IDC_THREADID_LIST, LB_GETCURSEL, 0, 0);
+					if( column == ThreadIdDialogSortColumn )  // clicking the same column again reverses the sort
+					{
+						ThreadIdDialogColumns[column].ColumnSortType = (ThreadIdDialogColumns[column].ColumnSortType == SORT_Increasing) ? SORT_Decreasing : SORT_Increasing;
+					}
 
-				if( listbox_index >= 0 )
+					ThreadIdDialogSetSortColumn(pnmh->hwndFrom, column);
+					ThreadIdDialogUpdateRows(hDlg);
+					return (INT_PTR)TRUE;
+				}
+				else if( pnmh->code == NM_DBLCLK )
 				{
-					DialogThreadIdRecord_t* ThreadRec = (DialogThreadIdRecord_t*)SendDlgItemMessage(hDlg, IDC_THREADID_LIST, LB_GETITEMDATA, listbox_index, 0);
+					int row = ((LPNMITEMACTIVATE)lParam)->iItem;
 
-					DialogCallTreeThreadId = ThreadRec->ThreadId;
+					if( row >= 0 )
+					{
+						ThreadIdDialogSelectThread(hDlg, row);
 
-					PostMessage(ghDialogWnd, WM_DISPLAYCALLTREEDATA, 0, 0);
+						EndDialog(hDlg, IDOK);
+					}
+					return (INT_PTR)TRUE;
 				}
+			}
+			break;
 
+		case WM_COMMAND:
+			if( LOWORD(wParam) == IDOK )
+			{
+				ThreadIdDialogSelectThread(hDlg, ListView_GetNextItem(GetDlgItem(hDlg, IDC_THREADID_LIST), -1, LVNI_SELECTED));
+
+				EndDialog(hDlg, LOWORD(wParam));
 				return (INT_PTR)TRUE;
 			}
 			else if( LOWORD(wParam) == IDCANCEL )
@@ -1058,12 +1564,85 @@ INT_PTR CALLBACK ThreadIdModalDialog(HWND hDlg, UINT message, WPARAM wParam, LPA
 				EndDialog(hDlg, LOWORD(wParam));
 				return (INT_PTR)TRUE;
 			}
+			else if( (LOWORD(wParam) == IDC_THREADID_SEARCH) && (HIWORD(wParam) == EN_CHANGE) )
+			{
+				ThreadIdDialogUpdateRows(hDlg);
+				return (INT_PTR)TRUE;
+			}
+			break;
+
+		case WM_DESTROY:
+			{
+				// the ListView can still ask for rows until the dialog is destroyed, so the rows are freed here (not when EndDialog() is called)
+				ThreadIdDialogRows = nullptr;
+				NumThreadIdDialogRows = 0;
+				ThreadIdDialogVisibleRows = nullptr;
+				NumThreadIdDialogVisibleRows = 0;
+
+				ThreadIdDialogAllocator.FreeBlocks();
+			}
 			break;
 	}
 
 	return (INT_PTR)FALSE;
 }
 
+static void SetMemoryBreakdownText(HWND hDlg)  // fill in the memory used by each kind of data structure (for all threads and for each thread)
+{
+	CAllocator StatsAllocator;
+
+	int NumStatsThreads = AeonGetMemoryStats(nullptr, 0);
+	NumStatsThreads += 16;  // (in case threads are created before we get the stats)
+
+	AeonMemoryStats* ThreadStats = (AeonMemoryStats*)StatsAllocator.AllocateBytes(NumStatsThreads * sizeof(AeonMemoryStats), sizeof(void*));
+	NumStatsThreads = min(AeonGetMemoryStats(ThreadStats, NumStatsThreads), NumStatsThreads);
+
+	AeonMemoryStats Total;
+	memset(&Total, 0, sizeof(Total));
+
+	for( int index = 0; index < NumStatsThreads; index++ )
+	{
+		Total.CallTreeRecordBytes += ThreadStats[index].CallTreeRecordBytes;
+		Total.ColdRecordBytes += ThreadStats[index].ColdRecordBytes;
+		Total.HashNodeBytes += ThreadStats[index].HashNodeBytes;
+		Total.RecycledHashNodeBytes += ThreadStats[index].RecycledHashNodeBytes;
+		Total.BucketArrayBytes += ThreadStats[index].BucketArrayBytes;
+		Total.OldBucketArrayBytes += ThreadStats[index].OldBucketArrayBytes;
+		Total.ParentChildTableBytes += ThreadStats[index].ParentChildTableBytes;
+		Total.StackNodeBytes += ThreadStats[index].StackNodeBytes;
+		Total.OtherBytes += ThreadStats[index].OtherBytes;
+		Total.AllocatedBytes += ThreadStats[index].AllocatedBytes;
+		Total.SlackBytes += ThreadStats[index].SlackBytes;
+	}
+
+	size_t text_len = 2048 + (NumStatsThreads * 512);
+	TCHAR* text = (TCHAR*)StatsAllocator.AllocateBytes(text_len * sizeof(TCHAR), sizeof(TCHAR));
+	size_t pos = 0;
+
+	pos += swprintf(&text[pos], text_len - pos, TEXT("All Threads:\r\n"));
+	pos += swprintf(&text[pos], text_len - pos, TEXT("  Call Tree Records: %zd (plus %zd for the cold part)\r\n"), Total.CallTreeRecordBytes, Total.ColdRecordBytes);
+	pos += swprintf(&text[pos], text_len - pos, TEXT("  Hash Nodes: %zd (plus %zd recycled from old bucket arrays)\r\n"), Total.HashNodeBytes, Total.RecycledHashNodeBytes);
+	pos += swprintf(&text[pos], text_len - pos, TEXT("  Bucket Arrays: %zd (plus %zd in old bucket arrays)\r\n"), Total.BucketArrayBytes, Total.OldBucketArrayBytes);
+	pos += swprintf(&text[pos], text_len - pos, TEXT("  Parent/Children Tables: %zd\r\n"), Total.ParentChildTableBytes);
+	pos += swprintf(&text[pos], text_len - pos, TEXT("  Stack Nodes: %zd\r\n"), Total.StackNodeBytes);
+	pos += swprintf(&text[pos], text_len - pos, TEXT("  Other: %zd\r\n"), Total.OtherBytes);
+	pos += swprintf(&text[pos], text_len - pos, TEXT("  Allocator Slack: %zd\r\n"), Total.SlackBytes);
+	pos += swprintf(&text[pos], text_len - pos, TEXT("  Total Allocated: %zd\r\n\r\n"), Total.AllocatedBytes);
+
+	for( int index = 0; index < NumStatsThreads; index++ )
+	{
+		AeonMemoryStats& Stats = ThreadStats[index];
+
+		pos += swprintf(&text[pos], text_len - pos, TEXT("Thread %u: records %zd, hash nodes %zd, buckets %zd, old buckets %zd, parent/children %zd, stack %zd, other %zd, slack %zd, total %zd\r\n"),
+			Stats.ThreadId, Stats.CallTreeRecordBytes + Stats.ColdRecordBytes, Stats.HashNodeBytes + Stats.RecycledHashNodeBytes, Stats.BucketArrayBytes,
+			Stats.OldBucketArrayBytes, Stats.ParentChildTableBytes, Stats.StackNodeBytes, Stats.OtherBytes, Stats.SlackBytes, Stats.AllocatedBytes);
+	}
+
+	SetDlgItemText(hDlg, IDC_STATS_MEMORY_BREAKDOWN, text);
+
+	StatsAllocator.FreeBlocks();
+}
+
 INT_PTR CALLBACK StatsModalDialog(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
 {
 	TCHAR buffer[256];
@@ -1112,6 +1691,8 @@ INT_PTR CALLBACK StatsModalDialog(HWND hDlg, UINT message, WPARAM wParam, LPARAM
 			swprintf(buffer, buffer_len, TEXT("Memory Overhead for Data Structures: %zd"), OverheadSize);
 			SetDlgItemText(hDlg, IDC_STATIC_MEM_OVERHEAD, buffer);
 
+			SetMemoryBreakdownText(hDlg);
+
 			return (INT_PTR)TRUE;
 
 		case WM_COMMAND:
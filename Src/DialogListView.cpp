@@ -9,7 +9,10 @@
 
 #include "Dialog.h"
 #include "TextViewer.h"
+#include "Plugin.h"
+#include "AddressRowIndex.h"
 
+extern CAllocator SymbolAllocator;  // allocator for storing the symbol names
 
 int DialogListViewThreadIndex = -1;  // the index of the thread currently selected from the ThreadArray (-1 means invalid thread)
 int gPreviouslySelectedRow = -1;
@@ -17,17 +20,10 @@ int gPreviouslySelectedRow = -1;
 bool bOptionDisplayTimeAsTicks = false;
 
 
-// ListView default settings for the three child windows...
-struct ListViewColumnsDefaults
-{
-	TCHAR* ColumnName;
-	SortType ColumnSortType;
-	bool bIsDefaultSortColumn;
-	int ColumnWidth;
-	bool bLeftJustify;
-};
+#define NUM_CALLTREE_COLUMNS 18  /* number of built in columns in the Functions and Children windows (the plugin's columns come after these) */
 
-ListViewColumnsDefaults ChildWindowFunctionsDefaults[] = {
+// ListView default settings for the three child windows...
+ListViewColumnsDefaults ChildWindowFunctionsDefaults[NUM_CALLTREE_COLUMNS + CAeonPlugin::NumColumns] = {
 	{ TEXT("#"), SORT_Unused, false, 50, false },							// column 1 (the row number)
 	{ TEXT("Function"), SORT_Increasing, false, 200, true },				// column 2 (the function name)
 	{ TEXT("Times Called"), SORT_Decreasing, false, 80, false },			// column 3 (number of times called)
@@ -37,6 +33,15 @@ ListViewColumnsDefaults ChildWindowFunctionsDefaults[] = {
 	{ TEXT("Avg. Inclusive Time"), SORT_Decreasing, false, 120, false },	// column 7 (average inclusive time)
 	{ TEXT("Max Recursion"), SORT_Decreasing, false, 90, false },			// column 8 (maximum recursion level)
 	{ TEXT("Max Exclusive Time"), SORT_Decreasing, false, 120, false },		// column 9 (maximum exclusive time)
+	{ TEXT("Calls/sec"), SORT_Decreasing, false, 90, false },				// column 10 (average call rate)
+	{ TEXT("Burstiness"), SORT_Decreasing, false, 80, false },				// column 11 (how bursty the calls are, -1 to 1)
+	{ TEXT("Self Time Sum"), SORT_Decreasing, false, 120, false },			// column 12 (exclusive time in instrumented code)
+	{ TEXT("External Time Sum"), SORT_Decreasing, false, 120, false },		// column 13 (exclusive time in code that isn't instrumented)
+	{ TEXT("Shape"), SORT_Decreasing, false, 200, true },					// column 14 (bimodal or heavy tailed call times and the modes)
+	{ TEXT("Outliers"), SORT_Decreasing, false, 70, false },				// column 15 (number of calls much slower than the average)
+	{ TEXT("Top Outlier Caller"), SORT_Increasing, false, 200, true },		// column 16 (the caller that made the most outlier calls)
+	{ TEXT("Process Page Faults"), SORT_Decreasing, false, 120, false },		// column 17 (the whole process's page faults during the calls, inclusive)
+	{ TEXT("Off-CPU Time"), SORT_Decreasing, false, 120, false },			// column 18 (time switched out during the calls, inclusive)
 };
 
 ListViewColumnsDefaults ChildWindowParentFunctionsDefaults[] = {
@@ -45,7 +50,7 @@ ListViewColumnsDefaults ChildWindowParentFunctionsDefaults[] = {
 	{ TEXT("Times Called"), SORT_Decreasing, false, 80, false },			// column 3 (number of times called)
 };
 
-ListViewColumnsDefaults ChildWindowChildrenFunctionsDefaults[] = {
+ListViewColumnsDefaults ChildWindowChildrenFunctionsDefaults[NUM_CALLTREE_COLUMNS + CAeonPlugin::NumColumns] = {
 	{ TEXT("#"), SORT_Unused, false, 50, false },							// column 1 (the row number)
 	{ TEXT("Children"), SORT_Increasing, false, 200, true },				// column 2 (the child function name)
 	{ TEXT("Times Called"), SORT_Decreasing, false, 80, false },			// column 3 (number of times called)
@@ -55,8 +60,19 @@ ListViewColumnsDefaults ChildWindowChildrenFunctionsDefaults[] = {
 	{ TEXT("Avg. Inclusive Time"), SORT_Decreasing, false, 120, false },	// column 7 (average inclusive time)
 	{ TEXT("Max Recursion"), SORT_Decreasing, false, 90, false },			// column 8 (maximum recursion level)
 	{ TEXT("Max Exclusive Time"), SORT_Decreasing, false, 120, false },		// column 9 (maximum exclusive time)
+	{ TEXT("Calls/sec"), SORT_Decreasing, false, 90, false },				// column 10 (average call rate)
+	{ TEXT("Burstiness"), SORT_Decreasing, false, 80, false },				// column 11 (how bursty the calls are, -1 to 1)
+	{ TEXT("Self Time Sum"), SORT_Decreasing, false, 120, false },			// column 12 (exclusive time in instrumented code)
+	{ TEXT("External Time Sum"), SORT_Decreasing, false, 120, false },		// column 13 (exclusive time in code that isn't instrumented)
+	{ TEXT("Shape"), SORT_Decreasing, false, 200, true },					// column 14 (bimodal or heavy tailed call times and the modes)
+	{ TEXT("Outliers"), SORT_Decreasing, false, 70, false },				// column 15 (number of calls much slower than the average)
+	{ TEXT("Top Outlier Caller"), SORT_Increasing, false, 200, true },		// column 16 (the caller that made the most outlier calls)
+	{ TEXT("Process Page Faults"), SORT_Decreasing, false, 120, false },		// column 17 (the whole process's page faults during the calls, inclusive)
+	{ TEXT("Off-CPU Time"), SORT_Decreasing, false, 120, false },			// column 18 (time switched out during the calls, inclusive)
 };
 
+TCHAR PluginColumnNames[CAeonPlugin::NumColumns + 1][64];  // (plus one since arrays can't be zero length)
+
 
 class CClipboardOutput
 {
@@ -93,6 +109,11 @@ int ChildWindowChildrenFunctionsCurrentSortColumn = 6;
 
 HWND hChildWindowCurrentlySorting;  // which of the three child windows is currently being sorted
 
+// the address to row index of each of the three child windows (rebuilt each time the window's records are sorted)
+AddressRowIndex_t FunctionsRowIndex;
+AddressRowIndex_t ParentFunctionsRowIndex;
+AddressRowIndex_t ChildrenFunctionsRowIndex;
+
 int ListViewRowSelectedFunctions = -1;
 int ListViewRowSelectedParentFunctions = -1;
 int ListViewRowSelectedChildrenFunctions = -1;
@@ -142,6 +163,40 @@ DialogCallTreeRecord_t* GetListViewRecordForRow(HWND hwndFrom, unsigned int row)
 	return nullptr;
 }
 
+static void FormatDurationShape(TCHAR* Buffer, size_t buffer_len, const DurationShape_t& InShape)  // "bimodal, heavy tail (12.000 usec, 3.100 msec)"
+{
+	Buffer[0] = 0;
+
+	if( InShape.Flags == 0 )
+	{
+		return;
+	}
+
+	wcscat_s(Buffer, buffer_len, (InShape.Flags & DURATION_SHAPE_BIMODAL) ? TEXT("bimodal") : TEXT(""));
+	wcscat_s(Buffer, buffer_len, (InShape.Flags == (DURATION_SHAPE_BIMODAL | DURATION_SHAPE_HEAVY_TAIL)) ? TEXT(", ") : TEXT(""));
+	wcscat_s(Buffer, buffer_len, (InShape.Flags & DURATION_SHAPE_HEAVY_TAIL) ? TEXT("heavy tail") : TEXT(""));
+	wcscat_s(Buffer, buffer_len, TEXT(" ("));
+
+	for( int index = 0; index < InShape.NumModes; index++ )
+	{
+		TCHAR ModeBuffer[32];
+
+		if( bOptionDisplayTimeAsTicks )
+		{
+			swprintf(ModeBuffer, _countof(ModeBuffer), TEXT("%I64d"), InShape.Modes[index]);
+		}
+		else
+		{
+			ConvertTicksToTime(ModeBuffer, _countof(ModeBuffer), InShape.Modes[index]);
+		}
+
+		wcscat_s(Buffer, buffer_len, (index > 0) ? TEXT(", ") : TEXT(""));
+		wcscat_s(Buffer, buffer_len, ModeBuffer);
+	}
+
+	wcscat_s(Buffer, buffer_len, TEXT(")"));
+}
+
 void ListViewNotify(HWND hWnd, LPARAM lParam)
 {
 	LPNMHDR  lpnmh = (LPNMHDR) lParam;
@@ -175,7 +230,7 @@ void ListViewNotify(HWND hWnd, LPARAM lParam)
 					ChildWindowFunctionsDefaults[column].ColumnSortType = SORT_Increasing;
 				}
 
-				for( int i = 0; i <= 8; i++ )
+				for( int i = 0; i < _countof(ChildWindowFunctionsDefaults); i++ )
 				{
 					ListViewSetColumnSortDirection(lpnmlv->hdr.hwndFrom, i, SORT_Unused);
 				}
@@ -225,7 +280,7 @@ void ListViewNotify(HWND hWnd, LPARAM lParam)
 					ChildWindowChildrenFunctionsDefaults[column].ColumnSortType = SORT_Increasing;
 				}
 
-				for( int i = 0; i <= 8; i++ )
+				for( int i = 0; i < _countof(ChildWindowChildrenFunctionsDefaults); i++ )
 				{
 					ListViewSetColumnSortDirection(lpnmlv->hdr.hwndFrom, i, SORT_Unused);
 				}
@@ -254,7 +309,7 @@ void ListViewNotify(HWND hWnd, LPARAM lParam)
 					RowCallTreeAddress = ListView_CallTreeRecord->Address;
 				}
 
-				qsort(ListView_ThreadIdRecord->CallTreeArray, ListView_ThreadIdRecord->CallTreeArraySize, sizeof(void*), ListView_SortCallTree);
+				ListViewSortCallTreeArray(hChildWindowFunctions, ListView_ThreadIdRecord->CallTreeArray, ListView_ThreadIdRecord->CallTreeArraySize);
 
 				if( RowCallTreeAddress )
 				{
@@ -281,7 +336,7 @@ void ListViewNotify(HWND hWnd, LPARAM lParam)
 					RowCallTreeAddress = ListView_CallTreeRecordParent->Address;
 				}
 
-				qsort(ListView_CallTreeRecord->ParentArray, ListView_CallTreeRecord->ParentArraySize, sizeof(void*), ListView_SortCallTree);
+				ListViewSortCallTreeArray(hChildWindowParentFunctions, ListView_CallTreeRecord->ParentArray, ListView_CallTreeRecord->ParentArraySize);
 
 				if( RowCallTreeAddress )
 				{
@@ -308,7 +363,7 @@ void ListViewNotify(HWND hWnd, LPARAM lParam)
 					RowCallTreeAddress = ListView_CallTreeRecordChild->Address;
 				}
 
-				qsort(ListView_CallTreeRecord->ChildrenArray, ListView_CallTreeRecord->ChildrenArraySize, sizeof(void*), ListView_SortCallTree);
+				ListViewSortCallTreeArray(hChildWindowChildrenFunctions, ListView_CallTreeRecord->ChildrenArray, ListView_CallTreeRecord->ChildrenArraySize);
 
 				if( RowCallTreeAddress )
 				{
@@ -954,6 +1009,101 @@ void ListViewNotify(HWND hWnd, LPARAM lParam)
 							ConvertTicksToTime(Buffer, buffer_len, ListView_record->MaxCallDurationExclusiveTime);
 						}
 
+						wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+					}
+					else if( column == 9 )  // calls per second
+					{
+						swprintf(Buffer, buffer_len, TEXT("%0.1f"), ListView_record->CallsPerSecond);
+
+						wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+					}
+					else if( column == 10 )  // burstiness
+					{
+						swprintf(Buffer, buffer_len, TEXT("%0.3f"), ListView_record->Burstiness);
+
+						wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+					}
+					else if( column == 11 )  // self time
+					{
+						if( bOptionDisplayTimeAsTicks )
+						{
+							swprintf(Buffer, buffer_len, TEXT("%I64d"), ListView_record->SelfTimeSum);
+						}
+						else
+						{
+							ConvertTicksToTime(Buffer, buffer_len, ListView_record->SelfTimeSum);
+						}
+
+						wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+					}
+					else if( column == 12 )  // external time
+					{
+						if( bOptionDisplayTimeAsTicks )
+						{
+							swprintf(Buffer, buffer_len, TEXT("%I64d"), ListView_record->ExternalTimeSum);
+						}
+						else
+						{
+							ConvertTicksToTime(Buffer, buffer_len, ListView_record->ExternalTimeSum);
+						}
+
+						wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+					}
+					else if( column == 13 )  // shape
+					{
+						FormatDurationShape(Buffer, buffer_len, ListView_record->Shape);
+
+						wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+					}
+					else if( column == 14 )  // outliers
+					{
+						swprintf(Buffer, buffer_len, TEXT("%u"), ListView_record->Outliers.NumOutliers);
+
+						wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+					}
+					else if( column == 15 )  // top outlier caller
+					{
+						int TopIndex = ListView_record->Outliers.GetTopCaller();
+
+						if( TopIndex >= 0 )
+						{
+							CFunctionRecord* Caller = ListView_record->Outliers.Callers[TopIndex];
+							const char* CallerName = Caller ? (Caller->SymbolName ? Caller->SymbolName : "(unknown)") : "(thread root)";
+
+							swprintf(Buffer, buffer_len, TEXT("%.200S (%u)"), CallerName, ListView_record->Outliers.CallerCounts[TopIndex]);
+
+							wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+						}
+					}
+					else if( column == 16 )  // process page faults
+					{
+						if( ListView_record->FaultMeasuredCalls > 0 )
+						{
+							swprintf(Buffer, buffer_len, TEXT("%I64d"), ListView_record->ProcessPageFaults);
+
+							wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+						}
+					}
+					else if( column == 17 )  // off-CPU time
+					{
+						if( ListView_record->FaultMeasuredCalls > 0 )
+						{
+							if( bOptionDisplayTimeAsTicks )
+							{
+								swprintf(Buffer, buffer_len, TEXT("%I64d"), ListView_record->OffCpuTime);
+							}
+							else
+							{
+								ConvertTicksToTime(Buffer, buffer_len, ListView_record->OffCpuTime);
+							}
+
+							wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
+						}
+					}
+					else if( (column >= NUM_CALLTREE_COLUMNS) && (column < NUM_CALLTREE_COLUMNS + CAeonPlugin::NumColumns) && ListView_record->PluginColumnValues )  // plugin column
+					{
+						swprintf(Buffer, buffer_len, TEXT("%I64d"), ListView_record->PluginColumnValues[column - NUM_CALLTREE_COLUMNS]);
+
 						wcsncpy_s(lpdi->item.pszText, lpdi->item.cchTextMax, Buffer, buffer_len);
 					}
 				}
@@ -962,10 +1112,32 @@ void ListViewNotify(HWND hWnd, LPARAM lParam)
 	}
 }
 
+static void ListViewInitPluginColumns(ListViewColumnsDefaults* InColumnDefaults)  // set up the defaults for the plugin's columns (these come after the built in columns)
+{
+	for( int Column = 0; Column < CAeonPlugin::NumColumns; Column++ )
+	{
+		const char* ColumnName = CAeonPlugin::GetColumnName(Column);
+		size_t num_chars;
+
+		mbstowcs_s(&num_chars, PluginColumnNames[Column], _countof(PluginColumnNames[Column]), ColumnName ? ColumnName : "Plugin", _TRUNCATE);
+
+		ListViewColumnsDefaults& ColumnDefaults = InColumnDefaults[NUM_CALLTREE_COLUMNS + Column];
+
+		ColumnDefaults.ColumnName = PluginColumnNames[Column];
+		ColumnDefaults.ColumnSortType = SORT_Decreasing;
+		ColumnDefaults.bIsDefaultSortColumn = false;
+		ColumnDefaults.ColumnWidth = 100;
+		ColumnDefaults.bLeftJustify = false;
+	}
+}
+
 void ListViewInitChildWindows()
 {
 	LVCOLUMN lvc;
 
+	ListViewInitPluginColumns(ChildWindowFunctionsDefaults);
+	ListViewInitPluginColumns(ChildWindowChildrenFunctionsDefaults);
+
 	ListView_SetExtendedListViewStyle(hChildWindowFunctions, (ListView_GetExtendedListViewStyle(hChildWindowFunctions) | LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER) & ~LVS_EX_TRACKSELECT);
 
 	for( int i = 0; i < _countof(ChildWindowFunctionsDefaults); i++ )
@@ -1156,53 +1328,47 @@ int FindRowForAddress(HWND hWnd, const void* Address)
 
 	if( hWnd == hChildWindowFunctions )
 	{
-		for( unsigned int index = 0; index < ListView_ThreadIdRecord->CallTreeArraySize; index++ )
-		{
-			DialogCallTreeRecord_t* ListView_CallTreeRecord = (DialogCallTreeRecord_t*)ListView_ThreadIdRecord->CallTreeArray[index];
-			assert(ListView_CallTreeRecord);
-
-			if( ListView_CallTreeRecord->Address == Address )
-			{
-				return index;
-			}
-		}
+		return FunctionsRowIndex.FindRow(ListView_ThreadIdRecord->CallTreeArray, ListView_ThreadIdRecord->CallTreeArraySize, Address);
 	}
 	else if( hWnd == hChildWindowParentFunctions )
 	{
 		DialogCallTreeRecord_t* ListView_CallTreeRecord = (DialogCallTreeRecord_t*)ListView_ThreadIdRecord->CallTreeArray[ListViewRowSelectedFunctions];
 		assert(ListView_CallTreeRecord);
 
-		for( unsigned int index = 0; index < ListView_CallTreeRecord->ParentArraySize; index++ )
-		{
-			DialogCallTreeRecord_t* ListView_CallTreeRecordParent = (DialogCallTreeRecord_t*)ListView_CallTreeRecord->ParentArray[index];
-			assert(ListView_CallTreeRecordParent);
-
-			if( ListView_CallTreeRecordParent->Address == Address )
-			{
-				return index;
-			}
-		}
+		return ParentFunctionsRowIndex.FindRow(ListView_CallTreeRecord->ParentArray, ListView_CallTreeRecord->ParentArraySize, Address);
 	}
 	else if(hWnd == hChildWindowChildrenFunctions )
 	{
 		DialogCallTreeRecord_t* ListView_CallTreeRecord = (DialogCallTreeRecord_t*)ListView_ThreadIdRecord->CallTreeArray[ListViewRowSelectedFunctions];
 		assert(ListView_CallTreeRecord);
 
-		for( unsigned int index = 0; index < ListView_CallTreeRecord->ChildrenArraySize; index++ )
-		{
-			DialogCallTreeRecord_t* ListView_CallTreeRecordChild = (DialogCallTreeRecord_t*)ListView_CallTreeRecord->ChildrenArray[index];
-			assert(ListView_CallTreeRecordChild);
-
-			if( ListView_CallTreeRecordChild->Address == Address )
-			{
-				return index;
-			}
-		}
+		return ChildrenFunctionsRowIndex.FindRow(ListView_CallTreeRecord->ChildrenArray, ListView_CallTreeRecord->ChildrenArraySize, Address);
 	}
 
 	return -1;
 }
 
+// Sort one of the window's arrays of records by the window's current sort column, and rebuild the window's address to row index.
+void ListViewSortCallTreeArray(HWND hWnd, void** Array, unsigned int ArraySize)
+{
+	hChildWindowCurrentlySorting = hWnd;
+
+	qsort(Array, ArraySize, sizeof(void*), ListView_SortCallTree);
+
+	if( hWnd == hChildWindowFunctions )
+	{
+		FunctionsRowIndex.Build(Array, ArraySize);
+	}
+	else if( hWnd == hChildWindowParentFunctions )
+	{
+		ParentFunctionsRowIndex.Build(Array, ArraySize);
+	}
+	else if( hWnd == hChildWindowChildrenFunctions )
+	{
+		ChildrenFunctionsRowIndex.Build(Array, ArraySize);
+	}
+}
+
 void ListViewSetRowSelected(HWND hWnd, int row, DialogThreadIdRecord_t* ListView_ThreadIdRecord, bool bIsDoubleClick)
 {
 	if( DialogListViewThreadIndex == -1 )
@@ -1227,12 +1393,35 @@ void ListViewSetRowSelected(HWND hWnd, int row, DialogThreadIdRecord_t* ListView
 						static int TextViewerLineNumber = -1;  // save this so we don't reload and re-display the text file when clicking on the same row more than once
 						char FileName[MAX_PATH];
 
-						GetSourceCodeLineFromAddress((DWORD64)ListView_CallTreeRecord->Address, LineNumber, FileName, MAX_PATH);
+						CFunctionRecord* FunctionRec = ListView_CallTreeRecord->CallTreeRecord->Cold->Function;
+
+						if( FunctionRec->SourceFileName )  // the source code location is shared by all threads, so only look it up once
+						{
+							LineNumber = FunctionRec->SourceLineNumber;
+							strcpy_s(FileName, MAX_PATH, FunctionRec->SourceFileName);
+						}
+						else
+						{
+							LineNumber = 0;
+							FileName[0] = 0;
+
+							GetSourceCodeLineFromAddress((DWORD64)ListView_CallTreeRecord->Address, LineNumber, FileName, MAX_PATH);
+
+							if( FileName[0] )
+							{
+								size_t length = strlen(FileName);
+								char* pSourceFileName = (char*)SymbolAllocator.AllocateBytes(length+1, 1);  // plus one for the null terminator
+								strcpy_s(pSourceFileName, length+1, FileName);
+
+								FunctionRec->SetSourceLocation(pSourceFileName, LineNumber);
+							}
+						}
 
 						extern char TextViewerFileName[];
 						if( (_stricmp(FileName, TextViewerFileName) != 0) || (LineNumber != TextViewerLineNumber) )
 						{
 							LoadTextFile(FileName);
+							LoadTextLineSamples(FunctionRec);
 
 							extern TextLineBuffer line_buffer;
 							line_buffer.current_line_index = LineNumber;
@@ -1243,6 +1432,12 @@ void ListViewSetRowSelected(HWND hWnd, int row, DialogThreadIdRecord_t* ListView
 
 							InvalidateRect(hChildWindowTextViewer, NULL, FALSE);
 						}
+						else  // the file is already displayed, but there may be more line samples since the last time
+						{
+							LoadTextLineSamples(FunctionRec);
+
+							InvalidateRect(hChildWindowTextViewer, NULL, FALSE);
+						}
 
 						ListViewRowSelectedFunctions = row;  // remember which row was selected
 
@@ -1254,8 +1449,7 @@ void ListViewSetRowSelected(HWND hWnd, int row, DialogThreadIdRecord_t* ListView
 						ListView_SetItemCount(hChildWindowParentFunctions, 0);
 
 						// sort the parent records...
-						hChildWindowCurrentlySorting = hChildWindowParentFunctions;
-						qsort(ListView_CallTreeRecord->ParentArray, ListView_CallTreeRecord->ParentArraySize, sizeof(void*), ListView_SortCallTree);
+						ListViewSortCallTreeArray(hChildWindowParentFunctions, ListView_CallTreeRecord->ParentArray, ListView_CallTreeRecord->ParentArraySize);
 
 						ListView_SetItemCount(hChildWindowParentFunctions, ListView_CallTreeRecord->ParentArraySize);
 
@@ -1269,8 +1463,7 @@ void ListViewSetRowSelected(HWND hWnd, int row, DialogThreadIdRecord_t* ListView
 						ListView_SetItemCount(hChildWindowChildrenFunctions, 0);
 
 						// sort the child records...
-						hChildWindowCurrentlySorting = hChildWindowChildrenFunctions;
-						qsort(ListView_CallTreeRecord->ChildrenArray, ListView_CallTreeRecord->ChildrenArraySize, sizeof(void*), ListView_SortCallTree);
+						ListViewSortCallTreeArray(hChildWindowChildrenFunctions, ListView_CallTreeRecord->ChildrenArray, ListView_CallTreeRecord->ChildrenArraySize);
 
 						ListView_SetItemCount(hChildWindowChildrenFunctions, ListView_CallTreeRecord->ChildrenArraySize);
 
@@ -1489,6 +1682,147 @@ int ListView_SortCallTree(const void* arg1, const void* arg2)
 
 		return (CallTreeRec1->MaxCallDurationExclusiveTime > CallTreeRec2->MaxCallDurationExclusiveTime) ? -1 : 1;
 	}
+	else if( sort_column == 9 )  // sort by Calls/sec
+	{
+		if( CallTreeRec1->CallsPerSecond == CallTreeRec2->CallsPerSecond )
+		{
+			return 0;
+		}
+		else if( sort_type == SORT_Increasing )
+		{
+			return (CallTreeRec1->CallsPerSecond < CallTreeRec2->CallsPerSecond) ? -1 : 1;
+		}
+
+		return (CallTreeRec1->CallsPerSecond > CallTreeRec2->CallsPerSecond) ? -1 : 1;
+	}
+	else if( sort_column == 10 )  // sort by Burstiness
+	{
+		if( CallTreeRec1->Burstiness == CallTreeRec2->Burstiness )
+		{
+			return 0;
+		}
+		else if( sort_type == SORT_Increasing )
+		{
+			return (CallTreeRec1->Burstiness < CallTreeRec2->Burstiness) ? -1 : 1;
+		}
+
+		return (CallTreeRec1->Burstiness > CallTreeRec2->Burstiness) ? -1 : 1;
+	}
+	else if( sort_column == 11 )  // sort by Self Time
+	{
+		if( CallTreeRec1->SelfTimeSum == CallTreeRec2->SelfTimeSum )
+		{
+			return 0;
+		}
+		else if( sort_type == SORT_Increasing )
+		{
+			return (CallTreeRec1->SelfTimeSum < CallTreeRec2->SelfTimeSum) ? -1 : 1;
+		}
+
+		return (CallTreeRec1->SelfTimeSum > CallTreeRec2->SelfTimeSum) ? -1 : 1;
+	}
+	else if( sort_column == 12 )  // sort by External Time
+	{
+		if( CallTreeRec1->ExternalTimeSum == CallTreeRec2->ExternalTimeSum )
+		{
+			return 0;
+		}
+		else if( sort_type == SORT_Increasing )
+		{
+			return (CallTreeRec1->ExternalTimeSum < CallTreeRec2->ExternalTimeSum) ? -1 : 1;
+		}
+
+		return (CallTreeRec1->ExternalTimeSum > CallTreeRec2->ExternalTimeSum) ? -1 : 1;
+	}
+	else if( sort_column == 13 )  // sort by Shape (bimodal and heavy tailed first, then by number of modes)
+	{
+		int Shape1 = (CallTreeRec1->Shape.Flags * (MAX_DURATION_MODES + 1)) + CallTreeRec1->Shape.NumModes;
+		int Shape2 = (CallTreeRec2->Shape.Flags * (MAX_DURATION_MODES + 1)) + CallTreeRec2->Shape.NumModes;
+
+		if( sort_type == SORT_Increasing )
+		{
+			return (Shape1 - Shape2);
+		}
+
+		return (Shape2 - Shape1);
+	}
+	else if( sort_column == 14 )  // sort by Outliers
+	{
+		if( CallTreeRec1->Outliers.NumOutliers == CallTreeRec2->Outliers.NumOutliers )
+		{
+			return 0;
+		}
+		else if( sort_type == SORT_Increasing )
+		{
+			return (CallTreeRec1->Outliers.NumOutliers < CallTreeRec2->Outliers.NumOutliers) ? -1 : 1;
+		}
+
+		return (CallTreeRec1->Outliers.NumOutliers > CallTreeRec2->Outliers.NumOutliers) ? -1 : 1;
+	}
+	else if( sort_column == 15 )  // sort by Top Outlier Caller (records without outliers go last)
+	{
+		int TopIndex1 = CallTreeRec1->Outliers.GetTopCaller();
+		int TopIndex2 = CallTreeRec2->Outliers.GetTopCaller();
+
+		if( (TopIndex1 < 0) || (TopIndex2 < 0) )
+		{
+			return (TopIndex2 - TopIndex1);
+		}
+
+		CFunctionRecord* Caller1 = CallTreeRec1->Outliers.Callers[TopIndex1];
+		CFunctionRecord* Caller2 = CallTreeRec2->Outliers.Callers[TopIndex2];
+		const char* CallerName1 = (Caller1 && Caller1->SymbolName) ? Caller1->SymbolName : "";
+		const char* CallerName2 = (Caller2 && Caller2->SymbolName) ? Caller2->SymbolName : "";
+
+		if( sort_type == SORT_Increasing )
+		{
+			return strcmp(CallerName1, CallerName2);
+		}
+
+		return strcmp(CallerName2, CallerName1);
+	}
+	else if( sort_column == 16 )  // sort by Process Page Faults
+	{
+		if( CallTreeRec1->ProcessPageFaults == CallTreeRec2->ProcessPageFaults )
+		{
+			return 0;
+		}
+		else if( sort_type == SORT_Increasing )
+		{
+			return (CallTreeRec1->ProcessPageFaults < CallTreeRec2->ProcessPageFaults) ? -1 : 1;
+		}
+
+		return (CallTreeRec1->ProcessPageFaults > CallTreeRec2->ProcessPageFaults) ? -1 : 1;
+	}
+	else if( sort_column == 17 )  // sort by Off-CPU Time
+	{
+		if( CallTreeRec1->OffCpuTime == CallTreeRec2->OffCpuTime )
+		{
+			return 0;
+		}
+		else if( sort_type == SORT_Increasing )
+		{
+			return (CallTreeRec1->OffCpuTime < CallTreeRec2->OffCpuTime) ? -1 : 1;
+		}
+
+		return (CallTreeRec1->OffCpuTime > CallTreeRec2->OffCpuTime) ? -1 : 1;
+	}
+	else if( (sort_column >= NUM_CALLTREE_COLUMNS) && CallTreeRec1->PluginColumnValues && CallTreeRec2->PluginColumnValues )  // sort by a plugin column
+	{
+		__int64 Value1 = CallTreeRec1->PluginColumnValues[sort_column - NUM_CALLTREE_COLUMNS];
+		__int64 Value2 = CallTreeRec2->PluginColumnValues[sort_column - NUM_CALLTREE_COLUMNS];
+
+		if( Value1 == Value2 )
+		{
+			return 0;
+		}
+		else if( sort_type == SORT_Increasing )
+		{
+			return (Value1 < Value2) ? -1 : 1;
+		}
+
+		return (Value1 > Value2) ? -1 : 1;
+	}
 
 	return 0;  // unknown sort type
 }
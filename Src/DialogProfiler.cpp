@@ -16,6 +16,8 @@
 
 #include "Dialog.h"
 #include "TextViewer.h"
+#include "Phase.h"
+#include "ThreadGroups.h"
 
 
 extern CHash<CThreadIdRecord>* ThreadIdHashTable;
@@ -31,6 +33,7 @@ HANDLE hApplicationProcess = nullptr;
 
 void** CaptureCallTreeThreadArrayPointer = nullptr;
 unsigned int CaptureCallTreeThreadArraySize = 0;
+int CaptureCallTreePhaseIndex = 0;
 DWORD64 CaptureCallTreeTime;
 int CaptureCallTreeSymbolsToInitialize = 0;
 
@@ -48,6 +51,12 @@ DialogCallTreeRecord_t* FindCallTreeRecord_BinarySearch(const DialogThreadIdReco
 		return nullptr;
 	}
 
+	if( ThreadRec->Columns )  // once the columns are made, search the address column (the CallTreeArray may have been sorted for display since then)
+	{
+		int index = ThreadRec->Columns->FindIndex(InAddress);
+		return (index >= 0) ? ThreadRec->Columns->Records[index] : nullptr;
+	}
+
 	if( ThreadRec->CallTreeArraySize < 4 )
 	{
 		for( unsigned int index = 0; index < ThreadRec->CallTreeArraySize; index++ )
@@ -99,6 +108,7 @@ int SortCallTreeHashTableCopy(const void* arg1, const void* arg2)
 
 int CaptureCallTreeData()  // return the number of symbols that need to be looked up
 {
+	FreeThreadGroups();  // (the groups' allocators live in the DialogAllocator's memory)
 	DialogAllocator.FreeBlocks();  // free all the memory allocated by the DialogAllocator
 
 	if( ThreadIdHashTable == nullptr )
@@ -111,6 +121,8 @@ int CaptureCallTreeData()  // return the number of symbols that need to be looke
 		EnterCriticalSection(&gCriticalSection);
 	}
 
+	FlushAllEdgeLogs();  // (so the parent and children hash tables are complete)
+
 	int registers[4];
 	__cpuid(registers, 0);
 	CaptureCallTreeTime = __rdtsc();
@@ -118,11 +130,20 @@ int CaptureCallTreeData()  // return the number of symbols that need to be looke
 	CaptureCallTreeThreadArrayPointer = nullptr;
 	CaptureCallTreeThreadArraySize = 0;
 
+	CaptureCallTreePhaseIndex = (DialogPhaseIndex >= 0) ? DialogPhaseIndex : CurrentPhaseIndex;
+
 	CaptureCallTreeThreadArrayPointer = ThreadIdHashTable->CopyHashToArray(&DialogAllocator, CaptureCallTreeThreadArraySize, true);
 	assert(CaptureCallTreeThreadArrayPointer);
 
 	LeaveCriticalSection(&gCriticalSection);
 
+	// the thread times are read after leaving the critical section (these are system calls)
+	for( unsigned int ThreadIndex = 0; ThreadIndex < CaptureCallTreeThreadArraySize; ThreadIndex++ )
+	{
+		DialogThreadIdRecord_t* ThreadRec = (DialogThreadIdRecord_t*)CaptureCallTreeThreadArrayPointer[ThreadIndex];
+		ThreadRec->ThreadIdRecord->FinishThreadActivity(*ThreadRec->Activity);
+	}
+
 
 	InitializeSymbolLookup();
 
@@ -241,7 +262,10 @@ void WINAPI ProcessCallTreeDataThread(LPVOID lpData)
 			char* sym = CallTreeRec->SymbolName;
 			if( sym == nullptr )
 			{
-				sym = LookupAddressSymbolName((DWORD64)CallTreeRec->Address);
+				// the symbol name is shared by all threads, so it may have been looked up for another thread during this capture
+				CallTreeRec->SymbolName = CallTreeRec->CallTreeRecord->Cold->Function->SymbolName;
+
+				sym = CallTreeRec->SymbolName ? nullptr : LookupAddressSymbolName((DWORD64)CallTreeRec->Address);
 				if( sym )
 				{
 					size_t length = strlen(sym);
@@ -283,7 +307,7 @@ void WINAPI ProcessCallTreeDataThread(LPVOID lpData)
 
 				if( ParentCallTreeRec )
 				{
-					DialogCallTreeRecord_t* ArrayCallTreeRec = FindCallTreeRecord_BinarySearch(ThreadRec, ParentCallTreeRec->Address);
+					DialogCallTreeRecord_t* ArrayCallTreeRec = FindCallTreeRecord_BinarySearch(ThreadRec, ParentCallTreeRec->Cold->Function->GetAddress());
 					assert(ArrayCallTreeRec);
 
 					CallTreeRec->ParentArray[ParentIndex] = ArrayCallTreeRec;
@@ -296,7 +320,7 @@ void WINAPI ProcessCallTreeDataThread(LPVOID lpData)
 
 				if( ChildCallTreeRec )
 				{
-					DialogCallTreeRecord_t* ArrayCallTreeRec = FindCallTreeRecord_BinarySearch(ThreadRec, ChildCallTreeRec->Address);
+					DialogCallTreeRecord_t* ArrayCallTreeRec = FindCallTreeRecord_BinarySearch(ThreadRec, ChildCallTreeRec->Cold->Function->GetAddress());
 					assert(ArrayCallTreeRec);
 
 					CallTreeRec->ChildrenArray[ChildIndex] = ArrayCallTreeRec;
@@ -304,6 +328,9 @@ void WINAPI ProcessCallTreeDataThread(LPVOID lpData)
 			}
 		}
 
+		// make the columnar copy of the records (the CallTreeArray is still in address order here)
+		ThreadRec->Columns = BuildCallTreeColumns(&DialogAllocator, ThreadRec);
+
 /*
 		// write out a bunch of debugging information to the log file
 
@@ -341,6 +368,8 @@ void WINAPI ProcessCallTreeDataThread(LPVOID lpData)
 */
 	}
 
+	BuildThreadGroups();  // (after the symbols have been looked up, since the groups use the threads' entry function names)
+
 	if( ghLookupSymbolsModalDialogWnd )
 	{
 		PostMessage(ghLookupSymbolsModalDialogWnd, WM_CAPTURECALLTREEDONE, 0, 0);
@@ -371,6 +400,7 @@ void ResetCallTreeData()
 
 	LeaveCriticalSection(&gCriticalSection);
 
+	FreeThreadGroups();
 	DialogAllocator.FreeBlocks();  // free all the memory allocated by the DialogAllocator
 
 	CaptureCallTreeThreadArrayPointer = nullptr;
@@ -425,13 +455,29 @@ void DisplayCallTreeData()
 
 		extern TCHAR szTitle[MAX_LOADSTRING];
 
-		swprintf(buffer, buffer_len, TEXT("%s - %s (ThreadId = %d)"), szTitle, wSymbolName, ListView_ThreadIdRecord->ThreadId);
+		if( ListView_ThreadIdRecord->NumGroupThreads > 0 )  // a thread group (see ThreadGroups.h)
+		{
+			swprintf(buffer, buffer_len, TEXT("%s - %s (%u threads)"), szTitle, wSymbolName, ListView_ThreadIdRecord->NumGroupThreads);
+		}
+		else
+		{
+			swprintf(buffer, buffer_len, TEXT("%s - %s (ThreadId = %d)"), szTitle, wSymbolName, ListView_ThreadIdRecord->ThreadId);
+		}
+
+		if( NumPhases > 1 )  // only show the phase name if the application has started a phase
+		{
+			TCHAR wPhaseName[PHASE_NAME_SIZE];
+
+			mbstowcs_s(&num_chars, wPhaseName, _countof(wPhaseName), Phases[CaptureCallTreePhaseIndex].Name, _TRUNCATE);
+
+			size_t title_len = wcslen(buffer);
+			swprintf(&buffer[title_len], buffer_len - title_len, TEXT(" - Phase: %s"), wPhaseName);
+		}
 
 		SetWindowText(ghWnd, buffer);
 
 		// sort the newly collected data by whatever sort criteria is currently set for the ListView...
-		hChildWindowCurrentlySorting = hChildWindowFunctions;
-		qsort(ListView_ThreadIdRecord->CallTreeArray, ListView_ThreadIdRecord->CallTreeArraySize, sizeof(void*), ListView_SortCallTree);
+		ListViewSortCallTreeArray(hChildWindowFunctions, ListView_ThreadIdRecord->CallTreeArray, ListView_ThreadIdRecord->CallTreeArraySize);
 
 		ListView_SetItemCount(hChildWindowFunctions, ListView_ThreadIdRecord->CallTreeArraySize);
 
@@ -0,0 +1,80 @@
+#include "targetver.h"
+
+#include <Windows.h>
+
+#include "ThreadIdRecord.h"
+#include "SizingHints.h"
+#include "EdgeLog.h"
+
+extern CHash<CThreadIdRecord>* ThreadIdHashTable;
+
+bool bDeferredEdges = false;
+
+
+// add the related record to InRecord's ParentHashTable or ChildrenHashTable (creating the hash table if needed)
+static void AddRelatedRecord(CCallTreeRecord* InRecord, CCallTreeRecord* InRelatedRecord, bool bParent, CThreadIdRecord* InThreadIdRecord)
+{
+	CHash<CCallTreeRecord, FunctionKey_t>*& HashTable = bParent ? InRecord->Cold->ParentHashTable : InRecord->Cold->ChildrenHashTable;
+
+	if( HashTable == nullptr )
+	{
+		int HashTableSize = bParent ? GetParentHashTableSize(InRecord->Cold->Function, PARENT_CALLRECORD_HASH_TABLE_SIZE) :
+			GetChildrenHashTableSize(InRecord->Cold->Function, CHILDREN_CALLRECORD_HASH_TABLE_SIZE);
+
+		HashTable = (CHash<CCallTreeRecord, FunctionKey_t>*)InThreadIdRecord->ThreadIdRecordAllocator->AllocateBytes(sizeof(CHash<CCallTreeRecord, FunctionKey_t>), sizeof(void*));
+		new(HashTable) CHash<CCallTreeRecord, FunctionKey_t>(InThreadIdRecord->ThreadIdRecordAllocator, HashTableSize);
+	}
+
+	CCallTreeRecord** pRelatedRecordPtr = HashTable->LookupPointer(InRelatedRecord->Cold->Function->FunctionKey);
+	if( *pRelatedRecordPtr == nullptr )
+	{
+		*pRelatedRecordPtr = InRelatedRecord;
+	}
+}
+
+void AddCallTreeEdge(CThreadIdRecord* InThreadIdRecord, CCallTreeRecord* InParent, CCallTreeRecord* InChild)
+{
+	AddRelatedRecord(InChild, InParent, true, InThreadIdRecord);
+	AddRelatedRecord(InParent, InChild, false, InThreadIdRecord);
+}
+
+void FlushEdgeLog(CThreadIdRecord* InThreadIdRecord)
+{
+	EdgeLog_t* EdgeLog = InThreadIdRecord->EdgeLog;
+
+	if( EdgeLog == nullptr )
+	{
+		return;
+	}
+
+	// the edges hold the records that were on the stack when the child exited, so these are the same records that CallerExit()
+	// would have looked up in the thread's CallTreeHashTable (even if the thread has changed phases since then)
+	for( unsigned int index = 0; index < EdgeLog->NumEdges; index++ )
+	{
+		AddCallTreeEdge(InThreadIdRecord, EdgeLog->Edges[index].Parent, EdgeLog->Edges[index].Child);
+	}
+
+	EdgeLog->NumEdges = 0;
+}
+
+void FlushAllEdgeLogs()
+{
+	if( !bDeferredEdges || (ThreadIdHashTable == nullptr) )
+	{
+		return;
+	}
+
+	for( int i = 0; i < ThreadIdHashTable->HashTableSize; i++ )
+	{
+		CHash<CThreadIdRecord>::Hash_t* p = (CHash<CThreadIdRecord>::Hash_t*)ThreadIdHashTable->HashTable[i];
+		while( p )
+		{
+			if( p->value )
+			{
+				FlushEdgeLog(p->value);
+			}
+
+			p = p->Next;
+		}
+	}
+}
@@ -0,0 +1,891 @@
+#include "targetver.h"
+
+#include <Windows.h>
+#include <stdio.h>
+#include <intrin.h>
+
+#include "Dialog.h"
+#include "Phase.h"
+#include "Export.h"
+#include "ModuleTable.h"
+#include "Plugin.h"
+#include "MemoryStats.h"
+#include "Config.h"
+#include "CloneReader.h"
+#include "Flow.h"
+
+extern CHash<CThreadIdRecord>* ThreadIdHashTable;
+extern CAllocator SymbolAllocator;
+
+extern int TicksPerHundredNanoseconds;
+
+#define EXPORT_STREAM_BATCH_RECORDS 1024  /* number of call tree records copied each time the streaming export holds the critical section */
+#define EXPORT_STREAM_BUFFER_SIZE (1024 * 1024)  /* size of the streaming export's file buffer */
+
+struct ExportThread_t  // copy of the data for one thread (made while holding the critical section)
+{
+	DWORD ThreadId;
+	CThreadIdRecord* ThreadIdRecord;
+	const void* Address;  // address of the function at the bottom of the stack (for the thread's symbol name)
+	char* SymbolName;
+
+	ThreadActivity_t Activity;
+	AeonMemoryStats Memory;
+
+	void** PhaseCallTreeArray[MAX_PHASES];  // arrays of DialogCallTreeRecord_t pointers
+	unsigned int PhaseCallTreeArraySize[MAX_PHASES];
+};
+
+
+static char* GetExportSymbolName(const void* Address)  // look up the symbol name and store it in the SymbolAllocator
+{
+	char* sym = LookupAddressSymbolName((DWORD64)Address);
+	if( sym == nullptr )
+	{
+		return nullptr;
+	}
+
+	size_t length = strlen(sym);
+	char* pSymbolName = (char*)SymbolAllocator.AllocateBytes(length+1, 1);  // plus one for the null terminator
+	strcpy_s(pSymbolName, length+1, sym);
+
+	return pSymbolName;
+}
+
+static void WriteQuotedString(FILE* fp, const char* InString)  // write a string in double quotes (double quotes in the string are doubled up, CSV style)
+{
+	fputc('"', fp);
+
+	for( const char* p = InString; p && *p; p++ )
+	{
+		if( *p == '"' )
+		{
+			fputc('"', fp);
+		}
+
+		fputc(*p, fp);
+	}
+
+	fputc('"', fp);
+}
+
+static void WriteJsonString(FILE* fp, const char* InString)  // write a string in double quotes with JSON escapes (for the trace export)
+{
+	fputc('"', fp);
+
+	for( const char* p = InString; p && *p; p++ )
+	{
+		if( (*p == '"') || (*p == '\\') )
+		{
+			fputc('\\', fp);
+			fputc(*p, fp);
+		}
+		else if( (unsigned char)*p < ' ' )
+		{
+			fprintf(fp, "\\u%04x", (unsigned char)*p);
+		}
+		else
+		{
+			fputc(*p, fp);
+		}
+	}
+
+	fputc('"', fp);
+}
+
+static const char* GetExportFunctionName(CFunctionRecord* Function)  // the function's symbol name (looking it up if needed), "(Thread)" if there's no function
+{
+	if( Function == nullptr )
+	{
+		return "(Thread)";  // the thread wasn't in an instrumented function
+	}
+
+	if( Function->SymbolName == nullptr )
+	{
+		char* FunctionSymbolName = GetExportSymbolName(Function->GetAddress());
+		if( FunctionSymbolName )
+		{
+			Function->SetSymbolName(FunctionSymbolName);
+		}
+	}
+
+	return Function->SymbolName ? Function->SymbolName : "(Unknown)";
+}
+
+static FlowType_t* CopyExportFlowTypes(CAllocator& ExportAllocator, int& OutNumFlowTypes)  // copy the flow types (call while holding the critical section)
+{
+	OutNumFlowTypes = NumFlowTypes;
+
+	FlowType_t* ExportFlowTypes = (FlowType_t*)ExportAllocator.AllocateBytes(max(NumFlowTypes, 1) * sizeof(FlowType_t), sizeof(void*));
+	memcpy(ExportFlowTypes, FlowTypes, NumFlowTypes * sizeof(FlowType_t));
+
+	return ExportFlowTypes;
+}
+
+static void CopyExportThread(CThreadIdRecord* ThreadIdRec, ExportThread_t& ExportThread)  // copy the thread's data (call while holding the critical section)
+{
+	ExportThread.ThreadId = ThreadIdRec->ThreadId;
+	ExportThread.ThreadIdRecord = ThreadIdRec;
+	ExportThread.SymbolName = ThreadIdRec->SymbolName;
+	ExportThread.Address = (ThreadIdRec->CallStack && ThreadIdRec->CallStack->pBottom) ? ThreadIdRec->CallStack->pBottom->value.CallerAddress : nullptr;
+
+	ThreadIdRec->GetThreadActivity(ExportThread.Activity, __rdtsc());
+	ThreadIdRec->GetMemoryStats(ExportThread.Memory);
+}
+
+static void WriteExportHeader(FILE* fp)  // write the AeonProfile, PluginColumns and Module lines
+{
+	char AppFilename[MAX_PATH];
+	ConvertTCHARtoCHAR(app_filename, AppFilename, MAX_PATH);
+
+	fprintf(fp, "AeonProfile,%d,", EXPORT_FILE_VERSION);
+	WriteQuotedString(fp, AppFilename);
+	fprintf(fp, "\n");
+
+	if( CAeonPlugin::NumColumns > 0 )
+	{
+		fprintf(fp, "PluginColumns");
+
+		for( int Column = 0; Column < CAeonPlugin::NumColumns; Column++ )
+		{
+			fprintf(fp, ",");
+			WriteQuotedString(fp, CAeonPlugin::GetColumnName(Column));
+		}
+
+		fprintf(fp, "\n");
+	}
+
+	int NumModules = gModuleTable->GetNumModules();
+
+	for( int ModuleIndex = 0; ModuleIndex < NumModules; ModuleIndex++ )
+	{
+		ModuleRecord_t* Module = gModuleTable->GetModule(ModuleIndex);
+
+		fprintf(fp, "Module,%d,", Module->Index);
+		WriteQuotedString(fp, Module->Name);
+		fprintf(fp, ",%u,%u\n", (unsigned int)Module->Size, (unsigned int)Module->TimeDateStamp);
+	}
+}
+
+static void WriteExportThreadActivity(FILE* fp, ExportThread_t* ExportThreads, unsigned int NumExportThreads)  // write the ThreadActivity and Memory lines
+{
+	unsigned int ThreadIndex;
+
+	for( ThreadIndex = 0; ThreadIndex < NumExportThreads; ThreadIndex++ )
+	{
+		ThreadActivity_t& Activity = ExportThreads[ThreadIndex].Activity;
+
+		fprintf(fp, "ThreadActivity,%d,%I64d,%I64d,%I64d,%I64d,%I64d,%I64d,%I64d", ExportThreads[ThreadIndex].ThreadId, Activity.CreateTime,
+			Activity.FirstCallTime, Activity.LastActivityTime, Activity.ExitTime, Activity.CaptureTime, Activity.Timeline.BusyTimeSum,
+			Activity.Timeline.GetBucketDuration());
+
+		for( int Bucket = 0; Bucket < ACTIVITY_TIMELINE_BUCKETS; Bucket++ )
+		{
+			fprintf(fp, ",%I64d", Activity.Timeline.BusyTime[Bucket]);
+		}
+
+		fprintf(fp, "\n");
+	}
+
+	for( ThreadIndex = 0; ThreadIndex < NumExportThreads; ThreadIndex++ )
+	{
+		AeonMemoryStats& Memory = ExportThreads[ThreadIndex].Memory;
+
+		fprintf(fp, "Memory,%d,%zd,%zd,%zd,%zd,%zd,%zd,%zd,%zd,%zd,%zd,%zd\n", ExportThreads[ThreadIndex].ThreadId, Memory.CallTreeRecordBytes,
+			Memory.ColdRecordBytes, Memory.HashNodeBytes, Memory.RecycledHashNodeBytes, Memory.BucketArrayBytes, Memory.OldBucketArrayBytes,
+			Memory.ParentChildTableBytes, Memory.StackNodeBytes, Memory.OtherBytes, Memory.SlackBytes, Memory.AllocatedBytes);
+	}
+}
+
+static void WriteExportFlowFunctions(FILE* fp, FlowType_t& FlowType, const char* InKind, FlowFunctionStats_t* InFunctions, int InNumFunctions)
+{
+	for( int index = 0; index < InNumFunctions; index++ )
+	{
+		fprintf(fp, "FlowFunction,");
+		WriteQuotedString(fp, FlowType.Name);
+		fprintf(fp, ",%s,", InKind);
+		WriteQuotedString(fp, GetExportFunctionName(InFunctions[index].Function));
+		fprintf(fp, ",%u,%I64d,%I64d\n", InFunctions[index].NumFlows, InFunctions[index].QueueDelaySum, InFunctions[index].MaxQueueDelay);
+	}
+}
+
+static void WriteExportFlows(FILE* fp, FlowType_t* ExportFlowTypes, int NumExportFlowTypes)  // write the Flow and FlowFunction lines
+{
+	for( int TypeIndex = 0; TypeIndex < NumExportFlowTypes; TypeIndex++ )
+	{
+		FlowType_t& FlowType = ExportFlowTypes[TypeIndex];
+
+		fprintf(fp, "Flow,");
+		WriteQuotedString(fp, FlowType.Name);
+		fprintf(fp, ",%u,%I64d,%I64d,%u,%u\n", FlowType.NumFlows, FlowType.QueueDelaySum, FlowType.MaxQueueDelay, FlowType.NumPendingFlows,
+			FlowType.NumDroppedFlows);
+
+		WriteExportFlowFunctions(fp, FlowType, "Begin", FlowType.BeginFunctions, FlowType.NumBeginFunctions);
+		WriteExportFlowFunctions(fp, FlowType, "End", FlowType.EndFunctions, FlowType.NumEndFunctions);
+	}
+}
+
+static void WriteExportThread(FILE* fp, ExportThread_t& ExportThread)  // write the Thread line (looking up the thread's symbol name if it doesn't have one yet)
+{
+	if( (ExportThread.SymbolName == nullptr) && ExportThread.Address )
+	{
+		ExportThread.SymbolName = GetExportSymbolName(ExportThread.Address);
+		if( ExportThread.SymbolName )
+		{
+			ExportThread.ThreadIdRecord->SetSymbolName(ExportThread.SymbolName);
+		}
+	}
+
+	fprintf(fp, "Thread,%d,", ExportThread.ThreadId);
+	WriteQuotedString(fp, ExportThread.SymbolName ? ExportThread.SymbolName : "(Unknown)");
+	fprintf(fp, "\n");
+}
+
+static void WriteExportFunction(FILE* fp, DialogCallTreeRecord_t* CallTreeRec)  // write the Function line and the lines that follow it for one call tree record
+{
+	if( CallTreeRec->SymbolName == nullptr )
+	{
+		CallTreeRec->SymbolName = CallTreeRec->CallTreeRecord->Cold->Function->SymbolName;  // may have been looked up for another thread already
+	}
+
+	if( CallTreeRec->SymbolName == nullptr )
+	{
+		CallTreeRec->SymbolName = GetExportSymbolName(CallTreeRec->Address);
+		if( CallTreeRec->SymbolName )
+		{
+			CallTreeRec->CallTreeRecord->SetSymbolName(CallTreeRec->SymbolName);
+		}
+	}
+
+	CFunctionRecord* FunctionRec = CallTreeRec->CallTreeRecord->Cold->Function;
+
+	fprintf(fp, "Function,0x%p,%d,0x%x,%d,%I64d,%I64d,%I64d,%d,", CallTreeRec->Address,
+		FunctionRec->Module ? FunctionRec->Module->Index : -1, FunctionRec->Offset, CallTreeRec->CallCount,
+		CallTreeRec->CallDurationExclusiveTimeSum, CallTreeRec->CallDurationInclusiveTimeSum,
+		CallTreeRec->MaxCallDurationExclusiveTime, CallTreeRec->MaxRecursionLevel);
+	WriteQuotedString(fp, CallTreeRec->SymbolName ? CallTreeRec->SymbolName : "(Unknown)");
+
+	for( int Column = 0; (Column < CAeonPlugin::NumColumns) && CallTreeRec->PluginColumnValues; Column++ )
+	{
+		fprintf(fp, ",%I64d", CallTreeRec->PluginColumnValues[Column]);
+	}
+
+	fprintf(fp, "\nIntervals,%.3f,%.3f", CallTreeRec->CallsPerSecond, CallTreeRec->Burstiness);
+
+	for( int Bucket = 0; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+	{
+		fprintf(fp, ",%u", CallTreeRec->IntervalHistogram[Bucket]);
+	}
+
+	fprintf(fp, "\nExternal,%I64d,%I64d,%d,%d", CallTreeRec->SelfTimeSum, CallTreeRec->ExternalTimeSum,
+		CallTreeRec->SelfSamples, CallTreeRec->ExternalSamples);
+
+	fprintf(fp, "\nDurations");
+
+	for( int Bucket = 0; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+	{
+		fprintf(fp, ",%u", CallTreeRec->DurationHistogram[Bucket]);
+	}
+
+	fprintf(fp, "\nFaults,%u,%I64d,%I64d", CallTreeRec->FaultMeasuredCalls, CallTreeRec->ProcessPageFaults, CallTreeRec->OffCpuTime);
+
+	fprintf(fp, "\nShape,%d", CallTreeRec->Shape.Flags);
+
+	for( int index = 0; index < CallTreeRec->Shape.NumModes; index++ )
+	{
+		fprintf(fp, ",%I64d", CallTreeRec->Shape.Modes[index]);
+	}
+
+	fprintf(fp, "\nOutliers,%u,%I64d", CallTreeRec->Outliers.NumOutliers, CallTreeRec->Outliers.MaxOutlierDuration);
+
+	for( int index = 0; index < MAX_OUTLIER_CALLERS; index++ )
+	{
+		CFunctionRecord* Caller = CallTreeRec->Outliers.Callers[index];
+
+		if( CallTreeRec->Outliers.CallerCounts[index] == 0 )
+		{
+			continue;
+		}
+
+		if( Caller && (Caller->SymbolName == nullptr) )
+		{
+			char* CallerSymbolName = GetExportSymbolName(Caller->GetAddress());
+			if( CallerSymbolName )
+			{
+				Caller->SetSymbolName(CallerSymbolName);
+			}
+		}
+
+		fprintf(fp, ",");
+		WriteQuotedString(fp, Caller ? (Caller->SymbolName ? Caller->SymbolName : "(Unknown)") : "(Thread)");
+		fprintf(fp, ",%u", CallTreeRec->Outliers.CallerCounts[index]);
+	}
+
+	fprintf(fp, "\n");
+}
+
+// Copy the records in one of a thread's call tree hash tables from the clone (the same as CopyHashToArray() without the parent and
+// children arrays, which aren't exported).  Returns an array of DialogCallTreeRecord_t pointers.
+static void** CopyCallTreeRecordsFromClone(CCloneReader& Clone, CHash<CCallTreeRecord, FunctionKey_t>* InHashTable, CAllocator& ExportAllocator, unsigned int& OutArraySize)
+{
+	typedef CHash<CCallTreeRecord, FunctionKey_t> CallTreeHash_t;
+
+	OutArraySize = 0;
+
+	CallTreeHash_t* HashTable = (CallTreeHash_t*)ExportAllocator.AllocateBytes(sizeof(CallTreeHash_t), sizeof(void*));
+
+	if( !Clone.Read(InHashTable, HashTable, sizeof(CallTreeHash_t)) || (HashTable->HashTable == nullptr) || (HashTable->NumTotalRecords == 0) )
+	{
+		return nullptr;
+	}
+
+	CallTreeHash_t::Hash_t** Buckets = (CallTreeHash_t::Hash_t**)ExportAllocator.AllocateBytes(HashTable->HashTableSize * sizeof(void*), sizeof(void*));
+
+	if( !Clone.Read((const void*)HashTable->HashTable, Buckets, HashTable->HashTableSize * sizeof(void*)) )
+	{
+		return nullptr;
+	}
+
+	void** pArrayOfPointers = (void**)ExportAllocator.AllocateBytes(HashTable->NumTotalRecords * sizeof(void*), sizeof(void*));
+
+	// each record (and its cold data) is read into these and then copied the same way as the in-process copy
+	CCallTreeRecord* Record = (CCallTreeRecord*)ExportAllocator.AllocateBytes(CALLTREERECORD_ALLOCATION_SIZE, CACHE_LINE_SIZE);
+	CallTreeRecordCold_t* Cold = (CallTreeRecordCold_t*)ExportAllocator.AllocateBytes(sizeof(CallTreeRecordCold_t), sizeof(void*));
+
+	for( int i = 0; i < HashTable->HashTableSize; i++ )
+	{
+		CallTreeHash_t::Hash_t* p = Buckets[i];
+		CallTreeHash_t::Hash_t Node;
+
+		while( p && (OutArraySize < HashTable->NumTotalRecords) && Clone.Read(p, Node) )
+		{
+			if( Node.value && Clone.Read(Node.value, Record, CALLTREERECORD_ALLOCATION_SIZE) && Record->GetNumRecordsToCopy() && Clone.Read(Record->Cold, *Cold) )
+			{
+				Record->Cold = Cold;
+
+				DialogCallTreeRecord_t* pRec = (DialogCallTreeRecord_t*)Record->GetArrayCopy(&ExportAllocator, false);
+				pRec->CallTreeRecord = Node.value;  // (the application's record, for the function record and SetSymbolName())
+
+				pArrayOfPointers[OutArraySize++] = pRec;
+			}
+
+			p = Node.Next;
+		}
+	}
+
+	return pArrayOfPointers;
+}
+
+// Fill in the ExportThreads from the clone (the same data the in-process copy gets while holding the critical section).  Returns the
+// number of threads.
+static unsigned int CopyExportThreadsFromClone(CCloneReader& Clone, CAllocator& ExportAllocator, ExportThread_t* ExportThreads, unsigned int InMaxThreads, int InNumPhases, DWORD64 InCaptureTime)
+{
+	typedef CHash<CThreadIdRecord> ThreadIdHash_t;
+
+	ThreadIdHash_t* ThreadHashTable = (ThreadIdHash_t*)ExportAllocator.AllocateBytes(sizeof(ThreadIdHash_t), sizeof(void*));
+
+	if( !Clone.Read(ThreadIdHashTable, ThreadHashTable, sizeof(ThreadIdHash_t)) || (ThreadHashTable->HashTable == nullptr) )
+	{
+		return 0;
+	}
+
+	ThreadIdHash_t::Hash_t** Buckets = (ThreadIdHash_t::Hash_t**)ExportAllocator.AllocateBytes(ThreadHashTable->HashTableSize * sizeof(void*), sizeof(void*));
+
+	if( !Clone.Read((const void*)ThreadHashTable->HashTable, Buckets, ThreadHashTable->HashTableSize * sizeof(void*)) )
+	{
+		return 0;
+	}
+
+	unsigned int ThreadIndex = 0;
+
+	for( int i = 0; (i < ThreadHashTable->HashTableSize) && (ThreadIndex < InMaxThreads); i++ )
+	{
+		ThreadIdHash_t::Hash_t* p = Buckets[i];
+		ThreadIdHash_t::Hash_t Node;
+
+		while( p && (ThreadIndex < InMaxThreads) && Clone.Read(p, Node) )
+		{
+			CThreadIdRecord* ThreadIdRec = (CThreadIdRecord*)ExportAllocator.AllocateBytes(sizeof(CThreadIdRecord), sizeof(void*));
+
+			if( Node.value && Clone.Read(Node.value, ThreadIdRec, sizeof(CThreadIdRecord)) )
+			{
+				ExportThread_t& ExportThread = ExportThreads[ThreadIndex++];
+				memset(&ExportThread, 0, sizeof(ExportThread_t));
+
+				ExportThread.ThreadId = ThreadIdRec->ThreadId;
+				ExportThread.ThreadIdRecord = Node.value;  // (the application's record, for SetSymbolName())
+				ExportThread.SymbolName = ThreadIdRec->SymbolName;
+
+				// point the copy of the thread record at copies of its timeline and call stack (for GetThreadActivity())
+				ActivityTimeline_t* Timeline = (ActivityTimeline_t*)ExportAllocator.AllocateBytes(sizeof(ActivityTimeline_t), sizeof(__int64));
+				ThreadIdRec->Timeline = (ThreadIdRec->Timeline && Clone.Read(ThreadIdRec->Timeline, *Timeline)) ? Timeline : nullptr;
+
+				CStack* CallStack = (CStack*)ExportAllocator.AllocateBytes(sizeof(CStack), sizeof(void*));
+				ThreadIdRec->CallStack = (ThreadIdRec->CallStack && Clone.Read(ThreadIdRec->CallStack, CallStack, sizeof(CStack))) ? CallStack : nullptr;
+
+				CStack::Stack_t BottomNode;
+				if( ThreadIdRec->CallStack && ThreadIdRec->CallStack->pBottom && Clone.Read(ThreadIdRec->CallStack->pBottom, BottomNode) )
+				{
+					ExportThread.Address = BottomNode.value.CallerAddress;
+				}
+
+				ThreadIdRec->GetThreadActivity(ExportThread.Activity, InCaptureTime);
+
+				for( int PhaseIndex = 0; PhaseIndex < InNumPhases; PhaseIndex++ )
+				{
+					if( ThreadIdRec->PhaseCallTreeHashTables[PhaseIndex] )
+					{
+						ExportThread.PhaseCallTreeArray[PhaseIndex] = CopyCallTreeRecordsFromClone(Clone, ThreadIdRec->PhaseCallTreeHashTables[PhaseIndex], ExportAllocator, ExportThread.PhaseCallTreeArraySize[PhaseIndex]);
+					}
+				}
+			}
+
+			p = Node.Next;
+		}
+	}
+
+	return ThreadIndex;
+}
+
+static void FinishExportThreadsActivity(ExportThread_t* ExportThreads, unsigned int InNumThreads)  // fill in the thread times (call after leaving the critical section)
+{
+	for( unsigned int ThreadIndex = 0; ThreadIndex < InNumThreads; ThreadIndex++ )
+	{
+		ExportThreads[ThreadIndex].ThreadIdRecord->FinishThreadActivity(ExportThreads[ThreadIndex].Activity);
+	}
+}
+
+// The memory stats of each thread (for the clone, since these walk the allocators, the threads are paused again while they're counted).
+// Returns how long the threads were paused (in CPU ticks).
+static DWORD64 GetExportThreadsMemoryStats(CAllocator& ExportAllocator, ExportThread_t* ExportThreads, unsigned int InNumThreads)
+{
+	int MaxStatsThreads = (int)InNumThreads + 16;  // (in case threads are created in the meantime)
+
+	AeonMemoryStats* ThreadStats = (AeonMemoryStats*)ExportAllocator.AllocateBytes(MaxStatsThreads * sizeof(AeonMemoryStats), sizeof(void*));
+	DWORD64 PauseTime = 0;
+	int NumStatsThreads = min(GetMemoryStats(ThreadStats, MaxStatsThreads, PauseTime), MaxStatsThreads);
+
+	for( unsigned int ThreadIndex = 0; ThreadIndex < InNumThreads; ThreadIndex++ )
+	{
+		memset(&ExportThreads[ThreadIndex].Memory, 0, sizeof(AeonMemoryStats));
+		ExportThreads[ThreadIndex].Memory.ThreadId = ExportThreads[ThreadIndex].ThreadId;
+
+		for( int index = 0; index < NumStatsThreads; index++ )
+		{
+			if( ThreadStats[index].ThreadId == ExportThreads[ThreadIndex].ThreadId )
+			{
+				ExportThreads[ThreadIndex].Memory = ThreadStats[index];
+				break;
+			}
+		}
+	}
+
+	return PauseTime;
+}
+
+static void EnterExportCriticalSection()
+{
+	if( TryEnterCriticalSection(&gCriticalSection) == 0 )
+	{
+		EnterCriticalSection(&gCriticalSection);
+	}
+}
+
+// Export without copying the call tree records of every thread first (AEON_EXPORT_BACKEND=stream).  The threads are copied (a few KB
+// each), then each thread's records are written out EXPORT_STREAM_BATCH_RECORDS at a time: the critical section is held while a batch
+// is copied (so each record is consistent, but the records can come from slightly different times) and released while the batch is
+// written to the file, so the memory used doesn't grow with the size of the profile (other than a pointer for each record of the
+// largest call tree).
+static bool ExportProfileDataStreaming(const char* InFilename)
+{
+	FILE* fp = nullptr;
+	if( fopen_s(&fp, InFilename, "w") != 0 )
+	{
+		DebugLog("ExportProfileData(): Failed to open '%s'", InFilename);
+		return false;
+	}
+
+	CAllocator ExportAllocator;  // the threads, the write buffer and the record pointers
+	CAllocator BatchAllocator;  // the copy of one batch of records (freed after the batch is written)
+
+	char* WriteBuffer = (char*)ExportAllocator.AllocateBytes(EXPORT_STREAM_BUFFER_SIZE, sizeof(void*));
+	setvbuf(fp, WriteBuffer, _IOFBF, EXPORT_STREAM_BUFFER_SIZE);
+
+	EnterExportCriticalSection();
+
+	DWORD64 PauseStartTime = __rdtsc();
+
+	int ExportNumPhases = NumPhases;
+	PhaseRecord_t ExportPhases[MAX_PHASES];
+	memcpy(ExportPhases, Phases, sizeof(PhaseRecord_t) * ExportNumPhases);
+
+	unsigned int NumExportThreads = ThreadIdHashTable->NumTotalRecords;
+	ExportThread_t* ExportThreads = (ExportThread_t*)ExportAllocator.AllocateBytes(NumExportThreads * sizeof(ExportThread_t), sizeof(void*));
+
+	unsigned int ThreadIndex = 0;
+
+	for( int i = 0; (i < ThreadIdHashTable->HashTableSize) && (ThreadIndex < NumExportThreads); i++ )
+	{
+		CHash<CThreadIdRecord>::Hash_t* p = (CHash<CThreadIdRecord>::Hash_t*)ThreadIdHashTable->HashTable[i];
+		while( p && (ThreadIndex < NumExportThreads) )
+		{
+			if( p->value )
+			{
+				CopyExportThread(p->value, ExportThreads[ThreadIndex++]);  // (the thread records are never freed, so these stay valid)
+			}
+
+			p = p->Next;
+		}
+	}
+
+	NumExportThreads = ThreadIndex;
+
+	int NumExportFlowTypes = 0;
+	FlowType_t* ExportFlowTypes = CopyExportFlowTypes(ExportAllocator, NumExportFlowTypes);
+
+	DWORD64 MaxPauseTime = __rdtsc() - PauseStartTime;
+
+	LeaveCriticalSection(&gCriticalSection);
+
+	FinishExportThreadsActivity(ExportThreads, NumExportThreads);
+
+	InitializeSymbolLookup();
+
+	WriteExportHeader(fp);
+
+	WriteExportThreadActivity(fp, ExportThreads, NumExportThreads);
+
+	WriteExportFlows(fp, ExportFlowTypes, NumExportFlowTypes);
+
+	CCallTreeRecord** Records = nullptr;  // the records of one thread in one phase (grown as needed)
+	unsigned int MaxRecords = 0;
+
+	DialogCallTreeRecord_t* BatchRecords[EXPORT_STREAM_BATCH_RECORDS];
+
+	for( int PhaseIndex = 0; PhaseIndex < ExportNumPhases; PhaseIndex++ )
+	{
+		fprintf(fp, "Phase,%d,", PhaseIndex);
+		WriteQuotedString(fp, ExportPhases[PhaseIndex].Name);
+		fprintf(fp, "\n");
+
+		for( ThreadIndex = 0; ThreadIndex < NumExportThreads; ThreadIndex++ )
+		{
+			ExportThread_t& ExportThread = ExportThreads[ThreadIndex];
+
+			EnterExportCriticalSection();
+
+			DWORD64 PauseTime = __rdtsc();
+
+			unsigned int NumRecords = 0;
+			CHash<CCallTreeRecord, FunctionKey_t>* CallTreeHashTable = ExportThread.ThreadIdRecord->PhaseCallTreeHashTables[PhaseIndex];
+
+			if( CallTreeHashTable )
+			{
+				if( CallTreeHashTable->NumTotalRecords > MaxRecords )
+				{
+					MaxRecords = max(CallTreeHashTable->NumTotalRecords, MaxRecords * 2);
+					Records = (CCallTreeRecord**)ExportAllocator.AllocateBytes(MaxRecords * sizeof(CCallTreeRecord*), sizeof(void*));
+				}
+
+				for( int i = 0; i < CallTreeHashTable->HashTableSize; i++ )
+				{
+					CHash<CCallTreeRecord, FunctionKey_t>::Hash_t* p = (CHash<CCallTreeRecord, FunctionKey_t>::Hash_t*)CallTreeHashTable->HashTable[i];
+					while( p && (NumRecords < MaxRecords) )
+					{
+						if( p->value && p->value->GetNumRecordsToCopy() )
+						{
+							Records[NumRecords++] = p->value;  // (the call tree records are never freed either)
+						}
+
+						p = p->Next;
+					}
+				}
+			}
+
+			MaxPauseTime = max(MaxPauseTime, __rdtsc() - PauseTime);
+
+			LeaveCriticalSection(&gCriticalSection);
+
+			if( NumRecords == 0 )
+			{
+				continue;  // this thread didn't call anything during this phase
+			}
+
+			WriteExportThread(fp, ExportThread);
+
+			for( unsigned int BatchStart = 0; BatchStart < NumRecords; BatchStart += EXPORT_STREAM_BATCH_RECORDS )
+			{
+				unsigned int BatchSize = min(NumRecords - BatchStart, (unsigned int)EXPORT_STREAM_BATCH_RECORDS);
+
+				EnterExportCriticalSection();
+
+				PauseTime = __rdtsc();
+
+				for( unsigned int index = 0; index < BatchSize; index++ )
+				{
+					BatchRecords[index] = (DialogCallTreeRecord_t*)Records[BatchStart + index]->GetArrayCopy(&BatchAllocator, false);
+				}
+
+				MaxPauseTime = max(MaxPauseTime, __rdtsc() - PauseTime);
+
+				LeaveCriticalSection(&gCriticalSection);
+
+				for( unsigned int index = 0; index < BatchSize; index++ )
+				{
+					WriteExportFunction(fp, BatchRecords[index]);
+				}
+
+				BatchAllocator.FreeBlocks();
+			}
+		}
+	}
+
+	bool bSuccess = (ferror(fp) == 0);
+
+	fclose(fp);  // (before freeing the write buffer)
+
+	ExportAllocator.FreeBlocks();
+
+	DebugLog("ExportProfileData(): Streamed %d phases for %d threads to '%s' (the profiler was paused for at most %.3f ms at a time)", ExportNumPhases,
+		NumExportThreads, InFilename, (double)MaxPauseTime / TicksPerHundredNanoseconds / 10000.0);
+
+	return bSuccess;
+}
+
+bool ExportProfileData(const char* InFilename)
+{
+	if( ThreadIdHashTable == nullptr )
+	{
+		return false;  // there's no call tree data captured by the profiler yet
+	}
+
+	const char* Backend = GetProfilerOptionString(OPTION_EXPORT_BACKEND);
+
+	if( Backend && (_stricmp(Backend, "stream") == 0) )
+	{
+		return ExportProfileDataStreaming(InFilename);
+	}
+
+	CAllocator ExportAllocator;
+
+	bool bUseClone = Backend && (_stricmp(Backend, "clone") == 0);
+
+	CCloneReader Clone;
+
+	EnterExportCriticalSection();
+
+	DWORD64 PauseStartTime = __rdtsc();
+
+	int ExportNumPhases = NumPhases;
+	PhaseRecord_t ExportPhases[MAX_PHASES];
+	memcpy(ExportPhases, Phases, sizeof(PhaseRecord_t) * ExportNumPhases);
+
+	unsigned int NumExportThreads = ThreadIdHashTable->NumTotalRecords;
+	ExportThread_t* ExportThreads = (ExportThread_t*)ExportAllocator.AllocateBytes(NumExportThreads * sizeof(ExportThread_t), sizeof(void*));
+
+	unsigned int ThreadIndex = 0;
+
+	FlushAllEdgeLogs();
+
+	int NumExportFlowTypes = 0;
+	FlowType_t* ExportFlowTypes = CopyExportFlowTypes(ExportAllocator, NumExportFlowTypes);
+
+	if( bUseClone && !Clone.CreateClone() )
+	{
+		DebugLog("ExportProfileData(): Couldn't clone the process, copying the data instead");
+	}
+
+	for( int i = 0; !Clone.IsCloned() && (i < ThreadIdHashTable->HashTableSize) && (ThreadIndex < NumExportThreads); i++ )
+	{
+		CHash<CThreadIdRecord>::Hash_t* p = (CHash<CThreadIdRecord>::Hash_t*)ThreadIdHashTable->HashTable[i];
+		while( p && (ThreadIndex < NumExportThreads) )
+		{
+			CThreadIdRecord* ThreadIdRec = p->value;
+
+			if( ThreadIdRec )
+			{
+				ExportThread_t& ExportThread = ExportThreads[ThreadIndex++];
+
+				CopyExportThread(ThreadIdRec, ExportThread);
+
+				for( int PhaseIndex = 0; PhaseIndex < ExportNumPhases; PhaseIndex++ )
+				{
+					ExportThread.PhaseCallTreeArray[PhaseIndex] = nullptr;
+					ExportThread.PhaseCallTreeArraySize[PhaseIndex] = 0;
+
+					if( ThreadIdRec->PhaseCallTreeHashTables[PhaseIndex] )
+					{
+						ExportThread.PhaseCallTreeArray[PhaseIndex] = ThreadIdRec->PhaseCallTreeHashTables[PhaseIndex]->CopyHashToArray(&ExportAllocator, ExportThread.PhaseCallTreeArraySize[PhaseIndex], true);
+					}
+				}
+			}
+
+			p = p->Next;
+		}
+	}
+
+	DWORD64 PauseEndTime = __rdtsc();
+
+	LeaveCriticalSection(&gCriticalSection);
+
+	double CopyPauseMs = (double)(PauseEndTime - PauseStartTime) / TicksPerHundredNanoseconds / 10000.0;
+
+	if( Clone.IsCloned() )  // copy the data from the clone while the application keeps running
+	{
+		ThreadIndex = CopyExportThreadsFromClone(Clone, ExportAllocator, ExportThreads, NumExportThreads, ExportNumPhases, PauseEndTime);
+
+		Clone.FreeClone();
+
+		DebugLog("ExportProfileData(): Copied %d threads from the clone in %.3f ms", ThreadIndex, (double)(__rdtsc() - PauseEndTime) / TicksPerHundredNanoseconds / 10000.0);
+
+		double MemoryStatsPauseMs = (double)GetExportThreadsMemoryStats(ExportAllocator, ExportThreads, ThreadIndex) / TicksPerHundredNanoseconds / 10000.0;
+
+		// the threads are paused twice with the clone (while it's made and while the memory stats are counted), so report both
+		DebugLog("ExportProfileData(): The profiler was paused for %.3f ms (copy-on-write clone, %.3f ms to make the clone + %.3f ms for the memory stats)",
+			CopyPauseMs + MemoryStatsPauseMs, CopyPauseMs, MemoryStatsPauseMs);
+	}
+	else
+	{
+		DebugLog("ExportProfileData(): The profiler was paused for %.3f ms (in-process copy)", CopyPauseMs);
+	}
+
+	NumExportThreads = ThreadIndex;
+
+	FinishExportThreadsActivity(ExportThreads, NumExportThreads);
+
+	FILE* fp = nullptr;
+	if( fopen_s(&fp, InFilename, "w") != 0 )
+	{
+		DebugLog("ExportProfileData(): Failed to open '%s'", InFilename);
+
+		ExportAllocator.FreeBlocks();
+		return false;
+	}
+
+	InitializeSymbolLookup();
+
+	WriteExportHeader(fp);
+
+	WriteExportThreadActivity(fp, ExportThreads, NumExportThreads);
+
+	WriteExportFlows(fp, ExportFlowTypes, NumExportFlowTypes);
+
+	// NOTE: Functions that are on a thread's stack (that haven't exited yet) only include the time from calls that have completed.
+
+	for( int PhaseIndex = 0; PhaseIndex < ExportNumPhases; PhaseIndex++ )
+	{
+		fprintf(fp, "Phase,%d,", PhaseIndex);
+		WriteQuotedString(fp, ExportPhases[PhaseIndex].Name);
+		fprintf(fp, "\n");
+
+		for( ThreadIndex = 0; ThreadIndex < NumExportThreads; ThreadIndex++ )
+		{
+			ExportThread_t& ExportThread = ExportThreads[ThreadIndex];
+
+			if( ExportThread.PhaseCallTreeArraySize[PhaseIndex] == 0 )
+			{
+				continue;  // this thread didn't call anything during this phase
+			}
+
+			WriteExportThread(fp, ExportThread);
+
+			for( unsigned int CallRecordIndex = 0; CallRecordIndex < ExportThread.PhaseCallTreeArraySize[PhaseIndex]; CallRecordIndex++ )
+			{
+				DialogCallTreeRecord_t* CallTreeRec = (DialogCallTreeRecord_t*)ExportThread.PhaseCallTreeArray[PhaseIndex][CallRecordIndex];
+
+				WriteExportFunction(fp, CallTreeRec);
+			}
+		}
+	}
+
+	bool bSuccess = (ferror(fp) == 0);
+
+	fclose(fp);
+
+	ExportAllocator.FreeBlocks();
+
+	DebugLog("ExportProfileData(): Exported %d phases for %d threads to '%s'", ExportNumPhases, NumExportThreads, InFilename);
+
+	return bSuccess;
+}
+
+// Write the flows that have ended (the last MAX_FLOW_EVENTS of them) as a Chrome trace (the JSON Trace Event Format, which can be
+// loaded in chrome://tracing or Perfetto).  Each flow is a short slice on the thread that began it (named after the function that
+// called AeonFlowBegin()) and one on the thread that ended it, joined by a flow arrow.  Times are in microseconds since the profiler
+// was loaded.
+bool ExportFlowTrace(const char* InFilename)
+{
+	CAllocator ExportAllocator;
+
+	EnterExportCriticalSection();
+
+	FlowEvent_t* Events = nullptr;
+	int NumEvents = CopyFlowEvents(&ExportAllocator, Events);
+
+	int NumExportFlowTypes = 0;
+	FlowType_t* ExportFlowTypes = CopyExportFlowTypes(ExportAllocator, NumExportFlowTypes);
+
+	LeaveCriticalSection(&gCriticalSection);
+
+	FILE* fp = nullptr;
+	if( fopen_s(&fp, InFilename, "w") != 0 )
+	{
+		DebugLog("ExportFlowTrace(): Failed to open '%s'", InFilename);
+
+		ExportAllocator.FreeBlocks();
+		return false;
+	}
+
+	InitializeSymbolLookup();
+
+	DWORD ProcessId = GetCurrentProcessId();
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	for( int index = 0; index < NumEvents; index++ )
+	{
+		FlowEvent_t& Event = Events[index];
+		const char* TypeName = ExportFlowTypes[Event.TypeIndex].Name;
+
+		double BeginTime = (double)Event.BeginTime / 10.0;  // (100ns units to microseconds)
+		double EndTime = (double)Event.EndTime / 10.0;
+
+		fprintf(fp, "%s{\"name\":", (index > 0) ? ",\n" : "");
+		WriteJsonString(fp, GetExportFunctionName(Event.BeginFunction));
+		fprintf(fp, ",\"cat\":");
+		WriteJsonString(fp, TypeName);
+		fprintf(fp, ",\"ph\":\"X\",\"ts\":%.1f,\"dur\":0.1,\"pid\":%u,\"tid\":%u,\"args\":{\"flow_id\":%I64u}}", BeginTime, ProcessId,
+			Event.BeginThreadId, Event.FlowId);
+
+		fprintf(fp, ",\n{\"name\":");
+		WriteJsonString(fp, TypeName);
+		fprintf(fp, ",\"cat\":");
+		WriteJsonString(fp, TypeName);
+		fprintf(fp, ",\"ph\":\"s\",\"id\":%d,\"ts\":%.1f,\"pid\":%u,\"tid\":%u}", index, BeginTime, ProcessId, Event.BeginThreadId);
+
+		fprintf(fp, ",\n{\"name\":");
+		WriteJsonString(fp, GetExportFunctionName(Event.EndFunction));
+		fprintf(fp, ",\"cat\":");
+		WriteJsonString(fp, TypeName);
+		fprintf(fp, ",\"ph\":\"X\",\"ts\":%.1f,\"dur\":0.1,\"pid\":%u,\"tid\":%u,\"args\":{\"flow_id\":%I64u,\"queue_delay_us\":%.1f}}", EndTime,
+			ProcessId, Event.EndThreadId, Event.FlowId, EndTime - BeginTime);
+
+		fprintf(fp, ",\n{\"name\":");
+		WriteJsonString(fp, TypeName);
+		fprintf(fp, ",\"cat\":");
+		WriteJsonString(fp, TypeName);
+		fprintf(fp, ",\"ph\":\"f\",\"bp\":\"e\",\"id\":%d,\"ts\":%.1f,\"pid\":%u,\"tid\":%u}", index, EndTime, ProcessId, Event.EndThreadId);
+	}
+
+	fprintf(fp, "\n]}\n");
+
+	bool bSuccess = (ferror(fp) == 0);
+
+	fclose(fp);
+
+	ExportAllocator.FreeBlocks();
+
+	DebugLog("ExportFlowTrace(): Exported %d flows to '%s'", NumEvents, InFilename);
+
+	return bSuccess;
+}
@@ -0,0 +1,298 @@
+#include <Windows.h>
+#include <intrin.h>
+
+#include "DebugLog.h"
+
+#include "ThreadIdRecord.h"
+#include "Flow.h"
+
+extern CHash<CThreadIdRecord>* ThreadIdHashTable;
+extern CRITICAL_SECTION gCriticalSection;
+extern bool bTrackCallerData;
+
+FlowType_t FlowTypes[MAX_FLOW_TYPES];
+int NumFlowTypes = 0;
+
+struct PendingFlow_t
+{
+	int TypeIndex;  // -1 if this slot is empty
+	DWORD BeginThreadId;
+	unsigned __int64 FlowId;
+	DWORD64 BeginTime;  // (CPU ticks)
+	CFunctionRecord* BeginFunction;
+};
+
+static CAllocator FlowAllocator;
+static PendingFlow_t* PendingFlows = nullptr;  // MAX_PENDING_FLOWS slots (allocated the first time a flow begins)
+static unsigned int NumPendingFlows = 0;
+
+static FlowEvent_t* FlowEvents = nullptr;  // circular buffer of the last MAX_FLOW_EVENTS flows that ended
+static unsigned int NumFlowEvents = 0;  // total number of flows that have ended (the next one goes in FlowEvents[NumFlowEvents % MAX_FLOW_EVENTS])
+
+
+static int GetFlowTypeIndex(const char* InFlowType)  // find (or add) the flow type, returns -1 if there are too many
+{
+	for( int index = 0; index < NumFlowTypes; index++ )
+	{
+		if( strncmp(FlowTypes[index].Name, InFlowType, FLOW_TYPE_NAME_SIZE - 1) == 0 )
+		{
+			return index;
+		}
+	}
+
+	if( NumFlowTypes == MAX_FLOW_TYPES )
+	{
+		return -1;
+	}
+
+	FlowType_t& FlowType = FlowTypes[NumFlowTypes];
+	memset(&FlowType, 0, sizeof(FlowType_t));
+	strncpy_s(FlowType.Name, FLOW_TYPE_NAME_SIZE, InFlowType, _TRUNCATE);
+
+	return NumFlowTypes++;
+}
+
+static CFunctionRecord* GetCallingFunction(DWORD InThreadId)  // the instrumented function on the top of the thread's call stack
+{
+	if( (ThreadIdHashTable == nullptr) || (ThreadIdHashTable->HashTable == nullptr) )
+	{
+		return nullptr;
+	}
+
+	// walk the bucket instead of using LookupPointer() so a thread that hasn't called an instrumented function isn't added to the table
+	__int64 pTemp = (__int64)InThreadId;  // cast the DWORD ThreadId to a 64 bit value so we can safely cast that to a void pointer
+	unsigned long hash = ThreadIdHashTable->HashPointer((void*)pTemp) % ThreadIdHashTable->HashTableSize;
+
+	CHash<CThreadIdRecord>::Hash_t* p = (CHash<CThreadIdRecord>::Hash_t*)ThreadIdHashTable->HashTable[hash];
+	while( p && (p->key != (void*)pTemp) )
+	{
+		p = p->Next;
+	}
+
+	CThreadIdRecord* pThreadIdRec = p ? p->value : nullptr;
+
+	if( pThreadIdRec && pThreadIdRec->CallStack && pThreadIdRec->CallStack->pTop )
+	{
+		return pThreadIdRec->CallStack->pTop->value.CurrentCallTreeRecord->Cold->Function;
+	}
+
+	return nullptr;
+}
+
+static void AddFlowFunction(FlowFunctionStats_t* InFunctions, int& InOutNumFunctions, CFunctionRecord* InFunction, __int64 InQueueDelay)
+{
+	int index = 0;
+	while( (index < InOutNumFunctions) && (InFunctions[index].Function != InFunction) )
+	{
+		index++;
+	}
+
+	if( index == InOutNumFunctions )
+	{
+		if( InOutNumFunctions == MAX_FLOW_FUNCTIONS )
+		{
+			return;
+		}
+
+		memset(&InFunctions[index], 0, sizeof(FlowFunctionStats_t));
+		InFunctions[index].Function = InFunction;
+		InOutNumFunctions++;
+	}
+
+	InFunctions[index].NumFlows++;
+	InFunctions[index].QueueDelaySum += InQueueDelay;
+	InFunctions[index].MaxQueueDelay = max(InFunctions[index].MaxQueueDelay, InQueueDelay);
+}
+
+static unsigned int HashFlow(int InTypeIndex, unsigned __int64 InFlowId)  // returns the home slot of the flow in the pending table
+{
+	unsigned __int64 hash = (InFlowId ^ ((unsigned __int64)InTypeIndex << 56)) * 0x9E3779B97F4A7C15ULL;  // (Fibonacci hashing)
+	return (unsigned int)(hash >> 32) & (MAX_PENDING_FLOWS - 1);
+}
+
+static unsigned int FindPendingFlow(int InTypeIndex, unsigned __int64 InFlowId)  // returns the flow's slot (or the empty slot where it would go)
+{
+	unsigned int Slot = HashFlow(InTypeIndex, InFlowId);
+
+	while( (PendingFlows[Slot].TypeIndex >= 0) && ((PendingFlows[Slot].TypeIndex != InTypeIndex) || (PendingFlows[Slot].FlowId != InFlowId)) )
+	{
+		Slot = (Slot + 1) & (MAX_PENDING_FLOWS - 1);
+	}
+
+	return Slot;
+}
+
+static void RemovePendingFlow(unsigned int InSlot)
+{
+	// shift the flows after this one back so that every flow can still be found from its home slot (no tombstones needed)
+	unsigned int EmptySlot = InSlot;
+	unsigned int Slot = InSlot;
+
+	for( ;; )
+	{
+		Slot = (Slot + 1) & (MAX_PENDING_FLOWS - 1);
+
+		if( PendingFlows[Slot].TypeIndex < 0 )
+		{
+			break;
+		}
+
+		unsigned int HomeSlot = HashFlow(PendingFlows[Slot].TypeIndex, PendingFlows[Slot].FlowId);
+
+		// this flow can move to the empty slot if the empty slot isn't before its home slot
+		if( ((Slot - HomeSlot) & (MAX_PENDING_FLOWS - 1)) >= ((Slot - EmptySlot) & (MAX_PENDING_FLOWS - 1)) )
+		{
+			PendingFlows[EmptySlot] = PendingFlows[Slot];
+			EmptySlot = Slot;
+		}
+	}
+
+	PendingFlows[EmptySlot].TypeIndex = -1;
+	NumPendingFlows--;
+}
+
+// Called when work is enqueued (the flow id only has to be unique among the flows of this type that haven't ended yet, the address of
+// the work item is usually good enough).  Beginning a flow that has already begun starts it again.
+extern "C" void AeonFlowBegin(const char* FlowType, unsigned __int64 FlowId)
+{
+	if( !bTrackCallerData || (FlowType == nullptr) )
+	{
+		return;
+	}
+
+	DWORD ThreadId = GetCurrentThreadId();
+
+	if( TryEnterCriticalSection(&gCriticalSection) == 0 )
+	{
+		EnterCriticalSection(&gCriticalSection);
+	}
+
+	DWORD64 TimeNow = __rdtsc();
+
+	int TypeIndex = GetFlowTypeIndex(FlowType);
+
+	if( TypeIndex < 0 )
+	{
+		DebugLog("AeonFlowBegin(): Too many flow types (MAX_FLOW_TYPES = %d), ignoring flow type '%s'", MAX_FLOW_TYPES, FlowType);
+
+		LeaveCriticalSection(&gCriticalSection);
+		return;
+	}
+
+	if( PendingFlows == nullptr )
+	{
+		PendingFlows = (PendingFlow_t*)FlowAllocator.AllocateBytes(MAX_PENDING_FLOWS * sizeof(PendingFlow_t), sizeof(void*));
+		FlowEvents = (FlowEvent_t*)FlowAllocator.AllocateBytes(MAX_FLOW_EVENTS * sizeof(FlowEvent_t), sizeof(void*));
+
+		for( int index = 0; index < MAX_PENDING_FLOWS; index++ )
+		{
+			PendingFlows[index].TypeIndex = -1;
+		}
+	}
+
+	unsigned int Slot = FindPendingFlow(TypeIndex, FlowId);
+
+	if( PendingFlows[Slot].TypeIndex < 0 )
+	{
+		if( NumPendingFlows >= (MAX_PENDING_FLOWS / 4) * 3 )  // (keep the probe sequences short)
+		{
+			FlowTypes[TypeIndex].NumDroppedFlows++;
+
+			LeaveCriticalSection(&gCriticalSection);
+			return;
+		}
+
+		NumPendingFlows++;
+		FlowTypes[TypeIndex].NumPendingFlows++;
+	}
+
+	PendingFlow_t& Flow = PendingFlows[Slot];
+
+	Flow.TypeIndex = TypeIndex;
+	Flow.FlowId = FlowId;
+	Flow.BeginThreadId = ThreadId;
+	Flow.BeginTime = TimeNow;
+	Flow.BeginFunction = GetCallingFunction(ThreadId);
+
+	LeaveCriticalSection(&gCriticalSection);
+}
+
+// Called when the work is dequeued (ending a flow that hasn't begun does nothing).
+extern "C" void AeonFlowEnd(const char* FlowType, unsigned __int64 FlowId)
+{
+	if( !bTrackCallerData || (FlowType == nullptr) || (PendingFlows == nullptr) )
+	{
+		return;
+	}
+
+	DWORD ThreadId = GetCurrentThreadId();
+
+	if( TryEnterCriticalSection(&gCriticalSection) == 0 )
+	{
+		EnterCriticalSection(&gCriticalSection);
+	}
+
+	DWORD64 TimeNow = __rdtsc();
+
+	int TypeIndex = GetFlowTypeIndex(FlowType);
+	unsigned int Slot = (TypeIndex >= 0) ? FindPendingFlow(TypeIndex, FlowId) : 0;
+
+	if( (TypeIndex < 0) || (PendingFlows[Slot].TypeIndex < 0) )
+	{
+		LeaveCriticalSection(&gCriticalSection);
+		return;
+	}
+
+	PendingFlow_t& Flow = PendingFlows[Slot];
+	FlowType_t& Type = FlowTypes[TypeIndex];
+
+	CFunctionRecord* EndFunction = GetCallingFunction(ThreadId);
+
+	__int64 QueueDelay = (TimeNow > Flow.BeginTime) ? (__int64)(TimeNow - Flow.BeginTime) / TicksPerHundredNanoseconds : 0;
+
+	Type.NumFlows++;
+	Type.QueueDelaySum += QueueDelay;
+	Type.MaxQueueDelay = max(Type.MaxQueueDelay, QueueDelay);
+	Type.NumPendingFlows--;
+
+	AddFlowFunction(Type.BeginFunctions, Type.NumBeginFunctions, Flow.BeginFunction, QueueDelay);
+	AddFlowFunction(Type.EndFunctions, Type.NumEndFunctions, EndFunction, QueueDelay);
+
+	FlowEvent_t& Event = FlowEvents[NumFlowEvents % MAX_FLOW_EVENTS];
+	NumFlowEvents++;
+
+	Event.TypeIndex = TypeIndex;
+	Event.FlowId = FlowId;
+	Event.BeginThreadId = Flow.BeginThreadId;
+	Event.EndThreadId = ThreadId;
+	Event.BeginTime = GetProfilerTime(Flow.BeginTime);
+	Event.EndTime = GetProfilerTime(TimeNow);
+	Event.BeginFunction = Flow.BeginFunction;
+	Event.EndFunction = EndFunction;
+
+	RemovePendingFlow(Slot);
+
+	LeaveCriticalSection(&gCriticalSection);
+}
+
+int CopyFlowEvents(CAllocator* InAllocator, FlowEvent_t*& OutEvents)
+{
+	OutEvents = nullptr;
+
+	if( FlowEvents == nullptr )
+	{
+		return 0;
+	}
+
+	unsigned int NumEvents = min(NumFlowEvents, (unsigned int)MAX_FLOW_EVENTS);
+	unsigned int FirstEvent = NumFlowEvents - NumEvents;
+
+	OutEvents = (FlowEvent_t*)InAllocator->AllocateBytes(max(NumEvents, 1U) * sizeof(FlowEvent_t), sizeof(void*));
+
+	for( unsigned int index = 0; index < NumEvents; index++ )
+	{
+		OutEvents[index] = FlowEvents[(FirstEvent + index) % MAX_FLOW_EVENTS];
+	}
+
+	return (int)NumEvents;
+}
@@ -0,0 +1,62 @@
+#include <Windows.h>
+
+#include "ThreadIdRecord.h"
+#include "MemoryStats.h"
+
+extern CHash<CThreadIdRecord>* ThreadIdHashTable;
+extern CRITICAL_SECTION gCriticalSection;
+
+
+// Get the memory used by each thread's data structures (see AeonMemoryStats).  This can be called by the application at any time
+// (from any thread), the threads are blocked on the critical section while the data structures are walked.
+extern "C" int AeonGetMemoryStats(AeonMemoryStats* OutStats, int InMaxThreads)
+{
+	DWORD64 PauseTime;
+	return GetMemoryStats(OutStats, InMaxThreads, PauseTime);
+}
+
+int GetMemoryStats(AeonMemoryStats* OutStats, int InMaxThreads, DWORD64& OutPauseTime)
+{
+	OutPauseTime = 0;
+
+	if( ThreadIdHashTable == nullptr )
+	{
+		return 0;
+	}
+
+	if( TryEnterCriticalSection(&gCriticalSection) == 0 )
+	{
+		EnterCriticalSection(&gCriticalSection);
+	}
+
+	DWORD64 PauseStartTime = __rdtsc();
+
+	FlushAllEdgeLogs();  // (the parent and children hash tables are counted)
+
+	int NumStatsThreads = 0;
+
+	for( int i = 0; i < ThreadIdHashTable->HashTableSize; i++ )
+	{
+		CHash<CThreadIdRecord>::Hash_t* p = (CHash<CThreadIdRecord>::Hash_t*)ThreadIdHashTable->HashTable[i];
+		while( p )
+		{
+			if( p->value )
+			{
+				if( OutStats && (NumStatsThreads < InMaxThreads) )
+				{
+					p->value->GetMemoryStats(OutStats[NumStatsThreads]);
+				}
+
+				NumStatsThreads++;
+			}
+
+			p = p->Next;
+		}
+	}
+
+	OutPauseTime = __rdtsc() - PauseStartTime;
+
+	LeaveCriticalSection(&gCriticalSection);
+
+	return NumStatsThreads;
+}
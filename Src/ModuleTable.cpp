@@ -0,0 +1,437 @@
+#include <Windows.h>
+#include <assert.h>
+
+#include "DebugLog.h"
+
+#include "ModuleTable.h"
+
+CModuleTable* gModuleTable = nullptr;
+
+// LdrRegisterDllNotification isn't in the SDK headers, so we declare what we need of it here
+#define LDR_DLL_NOTIFICATION_REASON_LOADED 1
+#define LDR_DLL_NOTIFICATION_REASON_UNLOADED 2
+
+struct LdrUnicodeString_t
+{
+	USHORT Length;
+	USHORT MaximumLength;
+	PWSTR Buffer;
+};
+
+struct LdrDllNotificationData_t  // same layout for both the loaded and unloaded notifications
+{
+	ULONG Flags;
+	const LdrUnicodeString_t* FullDllName;
+	const LdrUnicodeString_t* BaseDllName;
+	void* DllBase;
+	ULONG SizeOfImage;
+};
+
+typedef void (CALLBACK *LdrDllNotificationFunction_t)(ULONG NotificationReason, const void* NotificationData, void* Context);
+typedef LONG (NTAPI *LdrRegisterDllNotification_t)(ULONG Flags, LdrDllNotificationFunction_t NotificationFunction, void* Context, void** Cookie);
+typedef LONG (NTAPI *LdrUnregisterDllNotification_t)(void* Cookie);
+
+
+CModuleTable::CModuleTable(bool bInAllocateCoverageBitmaps) :
+	NumAllModules(0)
+	,NextKeyBase(MODULE_KEY_ALIGNMENT)  // the first module starts at 64KB so that 0 is never a valid function key
+	,UntrackedAddresses(nullptr)
+	,bIsUntrackedTableFull(false)
+	,bAllocateCoverageBitmaps(bInAllocateCoverageBitmaps)
+	,DllNotificationCookie(nullptr)
+{
+	InitializeCriticalSection(&ModuleCriticalSection);
+
+	SortedModules = (ModuleArray_t*)ModuleAllocator.AllocateBytes(sizeof(ModuleArray_t), sizeof(void*));
+	SortedModules->NumModules = 0;
+
+	// modules are added lazily the first time we see an address in them, but we need to know when they are unloaded (so that a
+	// different module loaded at the same address isn't mistaken for the old one, and so the old one keeps its keys if it's reloaded)
+	HMODULE hNtDll = GetModuleHandleA("ntdll.dll");
+	LdrRegisterDllNotification_t pLdrRegisterDllNotification = hNtDll ? (LdrRegisterDllNotification_t)GetProcAddress(hNtDll, "LdrRegisterDllNotification") : nullptr;
+
+	if( (pLdrRegisterDllNotification == nullptr) || (pLdrRegisterDllNotification(0, &CModuleTable::DllNotification, this, &DllNotificationCookie) != 0) )
+	{
+		DllNotificationCookie = nullptr;
+		DebugLog("CModuleTable::CModuleTable(): LdrRegisterDllNotification failed, module unloads will not be tracked");
+	}
+}
+
+CModuleTable::~CModuleTable()
+{
+	if( DllNotificationCookie )
+	{
+		HMODULE hNtDll = GetModuleHandleA("ntdll.dll");
+		LdrUnregisterDllNotification_t pLdrUnregisterDllNotification = hNtDll ? (LdrUnregisterDllNotification_t)GetProcAddress(hNtDll, "LdrUnregisterDllNotification") : nullptr;
+
+		if( pLdrUnregisterDllNotification )
+		{
+			pLdrUnregisterDllNotification(DllNotificationCookie);
+		}
+
+		DllNotificationCookie = nullptr;
+	}
+
+	SortedModules = nullptr;
+
+	DeleteCriticalSection(&ModuleCriticalSection);
+}
+
+ModuleRecord_t* CModuleTable::FindModule(const void* Address, bool bAddModule)
+{
+	ModuleArray_t* Array = (ModuleArray_t*)SortedModules;  // grab the currently published array (it never changes once published)
+
+	// binary search the sorted module array for the module containing this address...
+	int min_index = 0;
+	int max_index = Array->NumModules - 1;
+
+	while( max_index >= min_index )
+	{
+		int mid_index = (max_index + min_index) / 2;
+
+		ModuleRecord_t* Module = Array->Modules[mid_index];
+
+		if( (const char*)Address < Module->BaseAddress )
+		{
+			max_index = mid_index - 1;
+		}
+		else if( (const char*)Address >= (Module->BaseAddress + Module->Size) )
+		{
+			min_index = mid_index + 1;
+		}
+		else
+		{
+			if( bAddModule && Module->bIsDynamic && !IsDynamicModuleValid(Module) )  // dynamic code can be freed without us being told (not checked without bAddModule, so the sampler never takes the lock)
+			{
+				RemoveModule(Module->BaseAddress);  // (the address is in a new range now, so it's added again below with new keys)
+				break;
+			}
+
+			return Module;
+		}
+	}
+
+	if( !bAddModule )
+	{
+		return nullptr;
+	}
+
+	// ...not found, so add it
+	return AddModule(Address);
+}
+
+FunctionKey_t CModuleTable::GetFunctionKey(const void* Address, ModuleRecord_t** OutModule)
+{
+	ModuleRecord_t* Module = FindModule(Address);
+
+	if( OutModule )
+	{
+		*OutModule = Module;
+	}
+
+	if( Module == nullptr )
+	{
+		return GetUntrackedKey(Address);
+	}
+
+	return Module->KeyBase + (FunctionKey_t)((const char*)Address - Module->BaseAddress);
+}
+
+// Addresses that aren't in a module we can track (VirtualQuery failed or we ran out of module keys) each get their own key (so the
+// functions aren't all merged into one record).  These keys aren't module relative, so they can't be compared between runs.  The
+// table is lock free, an address claims an empty slot with a compare exchange and the slot never changes after that.
+FunctionKey_t CModuleTable::GetUntrackedKey(const void* Address)
+{
+	if( UntrackedAddresses == nullptr )
+	{
+		EnterCriticalSection(&ModuleCriticalSection);
+
+		if( UntrackedAddresses == nullptr )
+		{
+			// memory from the allocator comes directly from VirtualAlloc, so the table starts out zeroed
+			const void* volatile* Table = (const void* volatile*)ModuleAllocator.AllocateBytes(UNTRACKED_ADDRESS_TABLE_SIZE * sizeof(void*), sizeof(void*));
+
+			MemoryBarrier();  // make sure the table is visible before the pointer
+			UntrackedAddresses = Table;
+		}
+
+		LeaveCriticalSection(&ModuleCriticalSection);
+	}
+
+	unsigned int Slot = (unsigned int)(((size_t)Address >> 4) * 2654435761U) & (UNTRACKED_ADDRESS_TABLE_SIZE - 1);
+
+	for( int Probe = 0; Probe < UNTRACKED_ADDRESS_TABLE_SIZE; Probe++ )
+	{
+		const void* SlotAddress = UntrackedAddresses[Slot];
+
+		if( SlotAddress == nullptr )
+		{
+			SlotAddress = (const void*)InterlockedCompareExchangePointer((void* volatile*)&UntrackedAddresses[Slot], (void*)Address, nullptr);
+		}
+
+		if( (SlotAddress == nullptr) || (SlotAddress == Address) )
+		{
+			return UNTRACKED_KEY_BASE + Slot;
+		}
+
+		Slot = (Slot + 1) & (UNTRACKED_ADDRESS_TABLE_SIZE - 1);
+	}
+
+	if( !bIsUntrackedTableFull )
+	{
+		bIsUntrackedTableFull = true;
+		DebugLog("CModuleTable::GetUntrackedKey(): Out of untracked function keys, the rest of the functions outside of modules will be merged together");
+	}
+
+	return UNTRACKED_OVERFLOW_KEY;
+}
+
+bool CModuleTable::IsDynamicModuleValid(ModuleRecord_t* Module)
+{
+	ULONGLONG TimeNow = GetTickCount64();  // (this doesn't make a system call)
+
+	if( TimeNow - Module->CheckedTime < DYNAMIC_MODULE_CHECK_MS )
+	{
+		return true;
+	}
+
+	Module->CheckedTime = TimeNow;
+
+	// the range was freed if its base address isn't the start of an allocation any more (a range that is freed and allocated again
+	// at the same address between two checks can't be told apart from the old one)
+	MEMORY_BASIC_INFORMATION MemInfo;
+
+	if( (VirtualQuery(Module->BaseAddress, &MemInfo, sizeof(MemInfo)) == 0) || (MemInfo.State == MEM_FREE) || (MemInfo.AllocationBase != (void*)Module->BaseAddress) )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+ModuleRecord_t* CModuleTable::AddModule(const void* Address)
+{
+	// gather everything we need about the module before taking the lock (GetModuleHandleExA and GetModuleFileNameA take the loader
+	// lock and our DllNotification callback is called with the loader lock held, so we must never wait for the loader lock while holding ours)
+	const char* BaseAddress = nullptr;
+	size_t Size = 0;
+	DWORD TimeDateStamp = 0;
+	bool bIsDynamic = false;
+
+	char ModuleFilePath[MAX_PATH];
+	ModuleFilePath[0] = 0;
+
+	HMODULE hModule = nullptr;
+
+	if( GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)Address, &hModule) && (hModule != nullptr) )
+	{
+		IMAGE_DOS_HEADER* DosHeader = (IMAGE_DOS_HEADER*)hModule;
+		IMAGE_NT_HEADERS* NtHeaders = (IMAGE_NT_HEADERS*)((char*)hModule + DosHeader->e_lfanew);
+
+		BaseAddress = (const char*)hModule;
+		Size = NtHeaders->OptionalHeader.SizeOfImage;
+		TimeDateStamp = NtHeaders->FileHeader.TimeDateStamp;
+
+		GetModuleFileNameA(hModule, ModuleFilePath, MAX_PATH);
+	}
+	else
+	{
+		// address isn't in a loaded module (dynamically generated code?), so treat the whole allocation that contains it as a module
+		MEMORY_BASIC_INFORMATION MemInfo;
+
+		if( VirtualQuery(Address, &MemInfo, sizeof(MemInfo)) == 0 )
+		{
+			return nullptr;
+		}
+
+		BaseAddress = (const char*)MemInfo.AllocationBase;
+
+		const char* RegionAddress = BaseAddress;
+		while( (VirtualQuery(RegionAddress, &MemInfo, sizeof(MemInfo)) != 0) && (MemInfo.AllocationBase == (void*)BaseAddress) )
+		{
+			RegionAddress = (const char*)MemInfo.BaseAddress + MemInfo.RegionSize;
+		}
+
+		Size = (size_t)(RegionAddress - BaseAddress);
+		bIsDynamic = true;
+
+		strcpy_s(ModuleFilePath, MAX_PATH, "<dynamic>");
+	}
+
+	if( ((const char*)Address < BaseAddress) || ((const char*)Address >= BaseAddress + Size) || (Size > 0xffffffff) )
+	{
+		return nullptr;
+	}
+
+	char* FileName = strrchr(ModuleFilePath, '\\');
+	FileName = FileName ? FileName + 1 : ModuleFilePath;
+
+	EnterCriticalSection(&ModuleCriticalSection);
+
+	// another thread may have added this module while we were waiting for the lock
+	ModuleArray_t* OldArray = (ModuleArray_t*)SortedModules;
+	for( int index = 0; index < OldArray->NumModules; index++ )
+	{
+		if( OldArray->Modules[index]->BaseAddress == BaseAddress )
+		{
+			LeaveCriticalSection(&ModuleCriticalSection);
+			return OldArray->Modules[index];
+		}
+	}
+
+	ModuleRecord_t* Module = nullptr;
+
+	// if this module was loaded before (and has since been unloaded), reuse the old record so the function keys stay the same
+	if( !bIsDynamic )
+	{
+		for( int index = 0; index < NumAllModules; index++ )
+		{
+			ModuleRecord_t* OldModule = AllModules[index];
+
+			if( !OldModule->bIsLoaded && !OldModule->bIsDynamic && (OldModule->Size == Size) && (OldModule->TimeDateStamp == TimeDateStamp) &&
+				(_stricmp(OldModule->Name, FileName) == 0) )
+			{
+				Module = OldModule;
+				Module->BaseAddress = BaseAddress;
+				break;
+			}
+		}
+	}
+
+	if( Module == nullptr )
+	{
+		unsigned long long KeyRange = ((unsigned long long)Size + MODULE_KEY_ALIGNMENT - 1) & ~(unsigned long long)(MODULE_KEY_ALIGNMENT - 1);
+
+		if( (NumAllModules >= MAX_MODULES) || (NextKeyBase + KeyRange > UNTRACKED_KEY_BASE) )
+		{
+			DebugLog("CModuleTable::AddModule(): Out of module keys, %s at 0x%p will not be tracked", FileName, BaseAddress);
+
+			LeaveCriticalSection(&ModuleCriticalSection);
+			return nullptr;
+		}
+
+		Module = (ModuleRecord_t*)ModuleAllocator.AllocateBytes(sizeof(ModuleRecord_t), sizeof(void*));
+
+		Module->BaseAddress = BaseAddress;
+		Module->Size = Size;
+		Module->TimeDateStamp = TimeDateStamp;
+		strncpy_s(Module->Name, MODULE_NAME_SIZE, FileName, _TRUNCATE);
+
+		Module->Index = NumAllModules;
+		Module->KeyBase = (FunctionKey_t)NextKeyBase;
+		Module->bIsDynamic = bIsDynamic;
+		Module->CheckedTime = GetTickCount64();
+
+		NextKeyBase += KeyRange;
+
+		Module->CoverageBitmap = nullptr;
+		Module->CoverageExitBitmap = nullptr;
+
+		if( bAllocateCoverageBitmaps && !bIsDynamic )  // coverage of dynamically generated code can't be merged with other runs, so we don't track it
+		{
+			// memory from the allocator comes directly from VirtualAlloc (and is never re-used) so the bitmaps start out zeroed
+			// (the size is rounded up to a whole number of longs since the bits are set using the interlocked bit test instructions)
+			size_t BitmapSize = ((Module->Size + 31) / 32) * sizeof(long);
+			Module->CoverageBitmap = (unsigned char*)ModuleAllocator.AllocateBytes(BitmapSize, sizeof(long));
+			Module->CoverageExitBitmap = (unsigned char*)ModuleAllocator.AllocateBytes(BitmapSize, sizeof(long));
+		}
+
+		AllModules[NumAllModules] = Module;
+
+		MemoryBarrier();  // make sure the record is visible before the count
+		NumAllModules = NumAllModules + 1;
+	}
+
+	Module->bIsLoaded = true;
+
+	PublishSortedModules(Module, nullptr);
+
+	DebugLog("CModuleTable::AddModule(): %s loaded at 0x%p (size = %d, key base = 0x%08x)", Module->Name, Module->BaseAddress, (int)Module->Size, Module->KeyBase);
+
+	LeaveCriticalSection(&ModuleCriticalSection);
+
+	return Module;
+}
+
+void CModuleTable::RemoveModule(const void* BaseAddress)
+{
+	EnterCriticalSection(&ModuleCriticalSection);
+
+	ModuleArray_t* OldArray = (ModuleArray_t*)SortedModules;
+	for( int index = 0; index < OldArray->NumModules; index++ )
+	{
+		ModuleRecord_t* Module = OldArray->Modules[index];
+
+		if( Module->BaseAddress == (const char*)BaseAddress )
+		{
+			PublishSortedModules(nullptr, Module);
+
+			Module->bIsLoaded = false;
+
+			DebugLog("CModuleTable::RemoveModule(): %s unloaded from 0x%p", Module->Name, Module->BaseAddress);
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&ModuleCriticalSection);
+}
+
+void CModuleTable::PublishSortedModules(ModuleRecord_t* InsertModule, ModuleRecord_t* RemoveModule)
+{
+	ModuleArray_t* OldArray = (ModuleArray_t*)SortedModules;
+
+	// build a new sorted array with the module inserted (or removed), then publish it (readers never see a partially built array)
+	ModuleArray_t* NewArray = (ModuleArray_t*)ModuleAllocator.AllocateBytes(sizeof(ModuleArray_t) + OldArray->NumModules * sizeof(ModuleRecord_t*), sizeof(void*));
+
+	int NewIndex = 0;
+	bool bIsInserted = (InsertModule == nullptr);
+
+	for( int index = 0; index < OldArray->NumModules; index++ )
+	{
+		if( !bIsInserted && (OldArray->Modules[index]->BaseAddress > InsertModule->BaseAddress) )
+		{
+			NewArray->Modules[NewIndex++] = InsertModule;
+			bIsInserted = true;
+		}
+
+		if( OldArray->Modules[index] != RemoveModule )
+		{
+			NewArray->Modules[NewIndex++] = OldArray->Modules[index];
+		}
+	}
+
+	if( !bIsInserted )
+	{
+		NewArray->Modules[NewIndex++] = InsertModule;
+	}
+
+	NewArray->NumModules = NewIndex;
+
+	MemoryBarrier();  // make sure the array contents are visible before the array pointer
+	SortedModules = NewArray;
+}
+
+void CALLBACK CModuleTable::DllNotification(ULONG NotificationReason, const void* NotificationData, void* Context)
+{
+	// new modules are added the first time we see an address in them, we only need to handle unloads here
+	if( NotificationReason == LDR_DLL_NOTIFICATION_REASON_UNLOADED )
+	{
+		const LdrDllNotificationData_t* Data = (const LdrDllNotificationData_t*)NotificationData;
+		((CModuleTable*)Context)->RemoveModule(Data->DllBase);
+	}
+}
+
+int CModuleTable::GetNumModules()
+{
+	return NumAllModules;
+}
+
+ModuleRecord_t* CModuleTable::GetModule(int Index)
+{
+	if( (Index < 0) || (Index >= NumAllModules) )
+	{
+		return nullptr;
+	}
+
+	return AllModules[Index];
+}
@@ -0,0 +1,92 @@
+#include <Windows.h>
+#include <intrin.h>
+
+#include "DebugLog.h"
+
+#include "ThreadIdRecord.h"
+#include "Phase.h"
+
+extern CHash<CThreadIdRecord>* ThreadIdHashTable;
+extern CRITICAL_SECTION gCriticalSection;
+extern bool bTrackCallerData;
+
+PhaseRecord_t Phases[MAX_PHASES] = { { "Default", 0 } };  // phase 0 is used until the application starts a phase of its own
+int NumPhases = 1;
+int CurrentPhaseIndex = 0;
+
+int DialogPhaseIndex = -1;
+
+
+// Switch every thread over to collecting call tree data for the phase named PhaseName.  Starting a phase with the same name as a
+// previous phase adds to that phase's data (so "Loading" can be started several times and all the loading will be in one phase).
+extern "C" void AeonPhaseBegin(const char* PhaseName)
+{
+	if( !bTrackCallerData || (PhaseName == nullptr) )
+	{
+		return;
+	}
+
+	if( TryEnterCriticalSection(&gCriticalSection) == 0 )
+	{
+		EnterCriticalSection(&gCriticalSection);
+	}
+
+	int registers[4];
+	__cpuid(registers, 0);
+	DWORD64 TimeNow = __rdtsc();
+
+	int PhaseIndex = -1;
+
+	for( int index = 0; index < NumPhases; index++ )
+	{
+		if( strncmp(Phases[index].Name, PhaseName, PHASE_NAME_SIZE - 1) == 0 )
+		{
+			PhaseIndex = index;
+			break;
+		}
+	}
+
+	if( PhaseIndex == -1 )
+	{
+		if( NumPhases < MAX_PHASES )
+		{
+			PhaseIndex = NumPhases;
+
+			strncpy_s(Phases[PhaseIndex].Name, PHASE_NAME_SIZE, PhaseName, _TRUNCATE);
+
+			NumPhases++;
+		}
+		else
+		{
+			DebugLog("AeonPhaseBegin(): Too many phases (MAX_PHASES = %d), ignoring phase '%s'", MAX_PHASES, PhaseName);
+
+			LeaveCriticalSection(&gCriticalSection);
+			return;
+		}
+	}
+
+	Phases[PhaseIndex].StartTime = TimeNow;
+	CurrentPhaseIndex = PhaseIndex;
+
+	// switch all the threads over to the new phase (threads are blocked on the critical section while we do this)
+	if( ThreadIdHashTable && ThreadIdHashTable->HashTable )
+	{
+		for( int i = 0; i < ThreadIdHashTable->HashTableSize; i++ )
+		{
+			CHash<CThreadIdRecord>::Hash_t* p = (CHash<CThreadIdRecord>::Hash_t*)ThreadIdHashTable->HashTable[i];
+			while( p )
+			{
+				if( p->value )
+				{
+					p->value->SetPhase(PhaseIndex, TimeNow);
+				}
+
+				p = p->Next;
+			}
+		}
+	}
+
+	LeaveCriticalSection(&gCriticalSection);
+
+	DebugLog("AeonPhaseBegin(): Phase '%s' (index = %d)", Phases[PhaseIndex].Name, PhaseIndex);
+}
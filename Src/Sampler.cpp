@@ -0,0 +1,316 @@
+#include <Windows.h>
+#include <Psapi.h>
+#include <assert.h>
+
+#include "DebugLog.h"
+
+#include "CallTreeRecord.h"
+#include "ThreadIdRecord.h"
+#include "ModuleTable.h"
+#include "Sampler.h"
+
+#define MAX_SAMPLED_THREADS 1024  /* maximum number of threads that are sampled on each tick */
+#define LINE_SAMPLE_HASH_TABLE_SIZE 4096  /* initial size of the hash table of line samples (keyed by instruction pointer) */
+
+extern CRITICAL_SECTION gCriticalSection;
+extern CHash<CThreadIdRecord>* ThreadIdHashTable;
+extern HMODULE ModuleHandle;
+
+DWORD SamplerTlsIndex = TLS_OUT_OF_INDEXES;
+
+static HANDLE hSamplerThread = nullptr;
+static volatile bool bStopSampler = false;
+static int SampleIntervalMilliseconds = 0;
+
+static const char* ProfilerBaseAddress = nullptr;  // address range of the profiler DLL (samples in here are thrown away)
+static const char* ProfilerEndAddress = nullptr;
+
+static CThreadIdRecord* SampledThreads[MAX_SAMPLED_THREADS];  // only used by the sampler thread
+
+static CAllocator LineSampleAllocator;
+static CHash<LineSample_t>* LineSampleHashTable = nullptr;  // null unless line samples are turned on
+static CRITICAL_SECTION LineSampleCriticalSection;  // (the sampler thread adds to the hash table while the dialog copies from it)
+
+
+static int GetThreadsToSample()
+{
+	int NumSampledThreads = 0;
+
+	if( ThreadIdHashTable == nullptr )
+	{
+		return 0;
+	}
+
+	// thread records are never freed, so we only need the lock while walking the hash table
+	if( TryEnterCriticalSection(&gCriticalSection) == 0 )
+	{
+		EnterCriticalSection(&gCriticalSection);
+	}
+
+	for( int i = 0; (i < ThreadIdHashTable->HashTableSize) && (NumSampledThreads < MAX_SAMPLED_THREADS); i++ )
+	{
+		CHash<CThreadIdRecord>::Hash_t* p = (CHash<CThreadIdRecord>::Hash_t*)ThreadIdHashTable->HashTable[i];
+		while( p && (NumSampledThreads < MAX_SAMPLED_THREADS) )
+		{
+			if( p->value )
+			{
+				SampledThreads[NumSampledThreads++] = p->value;
+			}
+
+			p = p->Next;
+		}
+	}
+
+	LeaveCriticalSection(&gCriticalSection);
+
+	return NumSampledThreads;
+}
+
+static void AddLineSample(const void* InInstructionPointer, CFunctionRecord* InFunction)  // (only called by the sampler thread, after the sampled thread is resumed)
+{
+	EnterCriticalSection(&LineSampleCriticalSection);
+
+	LineSample_t** pLineSamplePtr = LineSampleHashTable->LookupPointer(InInstructionPointer);
+
+	LineSample_t* LineSample = *pLineSamplePtr;
+	while( LineSample && (LineSample->Function != InFunction) )
+	{
+		LineSample = LineSample->Next;
+	}
+
+	if( LineSample == nullptr )
+	{
+		LineSample = (LineSample_t*)LineSampleAllocator.AllocateBytes(sizeof(LineSample_t), sizeof(void*));
+
+		LineSample->Address = InInstructionPointer;
+		LineSample->Function = InFunction;
+		LineSample->Samples = 0;
+		LineSample->Next = *pLineSamplePtr;
+
+		*pLineSamplePtr = LineSample;
+	}
+
+	LineSample->Samples++;
+
+	LeaveCriticalSection(&LineSampleCriticalSection);
+}
+
+static bool HasThreadExited(HANDLE hThread)
+{
+	DWORD ExitCode;
+	return GetExitCodeThread(hThread, &ExitCode) && (ExitCode != STILL_ACTIVE);
+}
+
+static void SampleThread(CThreadIdRecord* InThreadIdRecord)
+{
+	if( InThreadIdRecord->bSamplerSawExit )
+	{
+		return;
+	}
+
+	if( InThreadIdRecord->SamplerThreadHandle == nullptr )
+	{
+		InThreadIdRecord->SamplerThreadHandle = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, InThreadIdRecord->ThreadId);
+
+		if( InThreadIdRecord->SamplerThreadHandle == nullptr )
+		{
+			return;  // the thread has probably exited (we'll try again next time in case the thread id gets reused)
+		}
+	}
+
+	HANDLE hThread = InThreadIdRecord->SamplerThreadHandle;
+
+	if( (InThreadIdRecord->ExitTime >= 0) || HasThreadExited(hThread) )  // close the handle so the thread object can be freed (ExitTime is set once UpdateThreadTimes() has seen the thread exit)
+	{
+		CloseHandle(hThread);
+		InThreadIdRecord->SamplerThreadHandle = nullptr;
+		InThreadIdRecord->bSamplerSawExit = true;
+		return;
+	}
+
+	if( SuspendThread(hThread) == (DWORD)-1 )
+	{
+		CloseHandle(hThread);
+		InThreadIdRecord->SamplerThreadHandle = nullptr;
+		return;
+	}
+
+	// The thread can be holding any lock (including the heap lock and gCriticalSection) while it's suspended, so nothing between
+	// the SuspendThread() and the ResumeThread() is allowed to allocate memory, take a lock or call DebugLog().
+
+	CCallTreeRecord* CallTreeRecord = nullptr;
+	const char* InstructionPointer = nullptr;
+
+	CONTEXT __declspec(align(16)) ThreadContext;
+	ThreadContext.ContextFlags = CONTEXT_CONTROL;
+
+	// GetThreadContext() waits until the thread has actually stopped, so read bIsInProfiler and the call stack after it
+	if( GetThreadContext(hThread, &ThreadContext) && (InThreadIdRecord->bIsInProfiler == 0) )
+	{
+#if _M_X64
+		InstructionPointer = (const char*)ThreadContext.Rip;
+#else
+		InstructionPointer = (const char*)ThreadContext.Eip;
+#endif
+
+		CStack* CallStack = InThreadIdRecord->CallStack;
+
+		if( CallStack && CallStack->pTop )
+		{
+			CallTreeRecord = CallStack->pTop->value.CurrentCallTreeRecord;
+		}
+	}
+
+	ResumeThread(hThread);
+
+	if( (CallTreeRecord == nullptr) || (InstructionPointer == nullptr) )
+	{
+		return;
+	}
+
+	if( (InstructionPointer >= ProfilerBaseAddress) && (InstructionPointer < ProfilerEndAddress) )
+	{
+		return;  // in _penter/_pexit (before the thread's bIsInProfiler was set or after it was cleared)
+	}
+
+	if( gModuleTable->FindModule(InstructionPointer, false) )  // (don't add modules here, only modules with instrumented code are in the table, and this way FindModule() doesn't take the module table lock)
+	{
+		InterlockedIncrement(&CallTreeRecord->Cold->SelfSamples);
+
+		if( LineSampleHashTable )
+		{
+			AddLineSample(InstructionPointer, CallTreeRecord->Cold->Function);
+		}
+	}
+	else
+	{
+		InterlockedIncrement(&CallTreeRecord->Cold->ExternalSamples);
+	}
+}
+
+static DWORD WINAPI SamplerThread(LPVOID lpParam)
+{
+	while( !bStopSampler )
+	{
+		Sleep(SampleIntervalMilliseconds);
+
+		int NumSampledThreads = GetThreadsToSample();
+
+		for( int index = 0; !bStopSampler && (index < NumSampledThreads); index++ )
+		{
+			SampleThread(SampledThreads[index]);
+		}
+	}
+
+	return 0;
+}
+
+void StartSampler(int InIntervalMilliseconds, bool bInSampleLines)
+{
+	if( InIntervalMilliseconds <= 0 )
+	{
+		return;
+	}
+
+	MODULEINFO ModuleInfo;
+	if( !GetModuleInformation(GetCurrentProcess(), ModuleHandle, &ModuleInfo, sizeof(ModuleInfo)) )
+	{
+		DebugLog("StartSampler(): GetModuleInformation failed (error = %d), external time will not be sampled", GetLastError());
+		return;
+	}
+
+	ProfilerBaseAddress = (const char*)ModuleInfo.lpBaseOfDll;
+	ProfilerEndAddress = ProfilerBaseAddress + ModuleInfo.SizeOfImage;
+
+	SamplerTlsIndex = TlsAlloc();
+	if( SamplerTlsIndex == TLS_OUT_OF_INDEXES )
+	{
+		DebugLog("StartSampler(): TlsAlloc failed, external time will not be sampled");
+		return;
+	}
+
+	SampleIntervalMilliseconds = InIntervalMilliseconds;
+	bStopSampler = false;
+
+	if( bInSampleLines )
+	{
+		InitializeCriticalSection(&LineSampleCriticalSection);
+
+		LineSampleHashTable = (CHash<LineSample_t>*)LineSampleAllocator.AllocateBytes(sizeof(CHash<LineSample_t>), sizeof(void*));
+		new(LineSampleHashTable) CHash<LineSample_t>(&LineSampleAllocator, LINE_SAMPLE_HASH_TABLE_SIZE);
+	}
+
+	hSamplerThread = CreateThread(NULL, 0, SamplerThread, NULL, 0, NULL);
+	if( hSamplerThread == nullptr )
+	{
+		DebugLog("StartSampler(): CreateThread failed (error = %d)", GetLastError());
+		return;
+	}
+
+	SetThreadPriority(hSamplerThread, THREAD_PRIORITY_TIME_CRITICAL);  // (so the samples aren't skewed by when the sampler gets scheduled)
+
+	DebugLog("StartSampler(): sampling every %d ms%s", SampleIntervalMilliseconds, LineSampleHashTable ? " (with line samples)" : "");
+}
+
+void StopSampler()
+{
+	bStopSampler = true;
+
+	// we don't wait for the sampler thread here (this is called with the loader lock held and the thread can't exit until we
+	// release it), the thread checks bStopSampler between samples so it won't suspend anything after this
+	if( hSamplerThread )
+	{
+		CloseHandle(hSamplerThread);
+		hSamplerThread = nullptr;
+	}
+}
+
+int CopyLineSamples(CFunctionRecord* InFunction, CAllocator* InAllocator, LineSample_t*& OutSamples)
+{
+	OutSamples = nullptr;
+
+	if( LineSampleHashTable == nullptr )
+	{
+		return 0;
+	}
+
+	EnterCriticalSection(&LineSampleCriticalSection);
+
+	int NumSamples = 0;
+
+	for( int pass = 0; pass < 2; pass++ )  // count the entries for the function, then copy them
+	{
+		if( pass == 1 )
+		{
+			OutSamples = (LineSample_t*)InAllocator->AllocateBytes(max(NumSamples, 1) * sizeof(LineSample_t), sizeof(void*));
+			NumSamples = 0;
+		}
+
+		for( int i = 0; i < LineSampleHashTable->HashTableSize; i++ )
+		{
+			CHash<LineSample_t>::Hash_t* p = (CHash<LineSample_t>::Hash_t*)LineSampleHashTable->HashTable[i];
+			while( p )
+			{
+				for( LineSample_t* LineSample = p->value; LineSample; LineSample = LineSample->Next )
+				{
+					if( LineSample->Function == InFunction )
+					{
+						if( pass == 1 )
+						{
+							OutSamples[NumSamples] = *LineSample;
+							OutSamples[NumSamples].Next = nullptr;
+						}
+
+						NumSamples++;
+					}
+				}
+
+				p = p->Next;
+			}
+		}
+	}
+
+	LeaveCriticalSection(&LineSampleCriticalSection);
+
+	return NumSamples;
+}
@@ -0,0 +1,403 @@
+#include <Windows.h>
+#include <stdlib.h>
+
+#include "DebugLog.h"
+
+#include "SizingHints.h"
+#include "ModuleTable.h"
+#include "ThreadIdRecord.h"
+
+extern CAllocator GlobalAllocator;
+extern CHash<CThreadIdRecord>* ThreadIdHashTable;
+
+#define MAX_SIZING_HINT_RECORDS ((DWORD)1 << 24)  /* hints are clamped to these (in case the file is corrupt) */
+#define MAX_SIZING_HINT_BYTES ((DWORD)256 * 1024 * 1024)
+
+
+// The sizing hints file format is:
+//    "AEONSZH1" (8 bytes), NumModules (int)
+//    for each module: NameLength (int), Name (NameLength bytes), ImageSize (DWORD), TimeDateStamp (DWORD)
+//    NumFunctions (int)
+//    for each function: SizingHintsFunction_t (sorted by ModuleIndex then Offset)
+
+struct SizingHintsModule_t
+{
+	char Name[MODULE_NAME_SIZE];
+	DWORD ImageSize;
+	DWORD TimeDateStamp;
+	ModuleRecord_t* Module;  // the module in this process that matches this one (set the first time it's looked up)
+};
+
+struct SizingHintsFunction_t
+{
+	int ModuleIndex;  // index into the modules in the file
+	DWORD Offset;  // the function's offset in the module
+
+	DWORD NumParents;  // maximum number of parents this function had in any thread
+	DWORD NumChildren;  // maximum number of children this function had in any thread
+
+	// these are only set if this function was the entry function of a thread (the maximum of all the threads that started with it)
+	DWORD NumCallTreeRecords;
+	DWORD ThreadIdRecordBytes;
+	DWORD CallTreeRecordBytes;
+};
+
+struct SizingHintsRecord_t  // used while gathering the hints at exit
+{
+	CFunctionRecord* Function;
+	SizingHintsFunction_t Hints;
+};
+
+static int NumHintModules = 0;
+static SizingHintsModule_t* HintModules = nullptr;
+
+static int NumHintFunctions = 0;
+static SizingHintsFunction_t* HintFunctions = nullptr;
+
+
+static bool ReadBytes(HANDLE hFile, void* Buffer, DWORD NumBytes)
+{
+	DWORD BytesRead = 0;
+	return (ReadFile(hFile, Buffer, NumBytes, &BytesRead, NULL) != 0) && (BytesRead == NumBytes);
+}
+
+static bool WriteBytes(HANDLE hFile, const void* Buffer, DWORD NumBytes)
+{
+	DWORD BytesWritten = 0;
+	return (WriteFile(hFile, Buffer, NumBytes, &BytesWritten, NULL) != 0) && (BytesWritten == NumBytes);
+}
+
+static int CompareHintFunctions(const void* a, const void* b)
+{
+	const SizingHintsFunction_t* FunctionA = (const SizingHintsFunction_t*)a;
+	const SizingHintsFunction_t* FunctionB = (const SizingHintsFunction_t*)b;
+
+	if( FunctionA->ModuleIndex != FunctionB->ModuleIndex )
+	{
+		return (FunctionA->ModuleIndex < FunctionB->ModuleIndex) ? -1 : 1;
+	}
+
+	if( FunctionA->Offset != FunctionB->Offset )
+	{
+		return (FunctionA->Offset < FunctionB->Offset) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+static SizingHintsFunction_t* FindHintFunction(CFunctionRecord* InFunction)
+{
+	if( (NumHintFunctions == 0) || (InFunction == nullptr) || (InFunction->Module == nullptr) || InFunction->Module->bIsDynamic )
+	{
+		return nullptr;
+	}
+
+	int ModuleIndex = -1;
+
+	for( int index = 0; index < NumHintModules; index++ )
+	{
+		SizingHintsModule_t& HintModule = HintModules[index];
+
+		if( HintModule.Module == InFunction->Module )
+		{
+			ModuleIndex = index;
+			break;
+		}
+
+		if( (HintModule.Module == nullptr) && (HintModule.ImageSize == (DWORD)InFunction->Module->Size) &&
+			(HintModule.TimeDateStamp == InFunction->Module->TimeDateStamp) && (_stricmp(HintModule.Name, InFunction->Module->Name) == 0) )
+		{
+			HintModule.Module = InFunction->Module;
+			ModuleIndex = index;
+			break;
+		}
+	}
+
+	if( ModuleIndex < 0 )
+	{
+		return nullptr;
+	}
+
+	SizingHintsFunction_t Key;
+	Key.ModuleIndex = ModuleIndex;
+	Key.Offset = InFunction->Offset;
+
+	return (SizingHintsFunction_t*)bsearch(&Key, HintFunctions, NumHintFunctions, sizeof(SizingHintsFunction_t), CompareHintFunctions);
+}
+
+static int GetHashTableSizeForRecords(DWORD NumRecords, int InDefaultSize)  // big enough that NumRecords won't make the hash table grow
+{
+	int Size = InDefaultSize;
+
+	while( (DWORD)Size < NumRecords )
+	{
+		Size = Size * 2;
+	}
+
+	return Size;
+}
+
+void ReadSizingHintsFile(const char* InFilename)
+{
+	if( (InFilename == nullptr) || (InFilename[0] == 0) )
+	{
+		return;
+	}
+
+	HANDLE hFile = CreateFileA(InFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		return;  // no hints from a previous run
+	}
+
+	char Magic[8];
+	int NumModules = 0;
+	int NumFunctions = 0;
+	bool bIsValid = false;
+
+	if( ReadBytes(hFile, Magic, sizeof(Magic)) && (memcmp(Magic, SIZING_HINTS_FILE_MAGIC, sizeof(Magic)) == 0) &&
+		ReadBytes(hFile, &NumModules, sizeof(int)) && (NumModules > 0) && (NumModules <= MAX_MODULES) )
+	{
+		HintModules = (SizingHintsModule_t*)GlobalAllocator.AllocateBytes(NumModules * sizeof(SizingHintsModule_t), sizeof(void*));
+
+		bIsValid = true;
+
+		for( int index = 0; bIsValid && (index < NumModules); index++ )
+		{
+			SizingHintsModule_t& HintModule = HintModules[index];
+			int NameLength = 0;
+
+			bIsValid = ReadBytes(hFile, &NameLength, sizeof(int)) && (NameLength > 0) && (NameLength < MODULE_NAME_SIZE) &&
+				ReadBytes(hFile, HintModule.Name, NameLength) &&
+				ReadBytes(hFile, &HintModule.ImageSize, sizeof(DWORD)) &&
+				ReadBytes(hFile, &HintModule.TimeDateStamp, sizeof(DWORD));
+
+			HintModule.Name[bIsValid ? NameLength : 0] = 0;
+			HintModule.Module = nullptr;
+		}
+
+		bIsValid = bIsValid && ReadBytes(hFile, &NumFunctions, sizeof(int)) && (NumFunctions > 0) && ((DWORD)NumFunctions <= MAX_SIZING_HINT_RECORDS);
+
+		if( bIsValid )
+		{
+			HintFunctions = (SizingHintsFunction_t*)GlobalAllocator.AllocateBytes(NumFunctions * sizeof(SizingHintsFunction_t), sizeof(void*));
+			bIsValid = ReadBytes(hFile, HintFunctions, NumFunctions * sizeof(SizingHintsFunction_t));
+		}
+	}
+
+	CloseHandle(hFile);
+
+	if( !bIsValid )
+	{
+		DebugLog("ReadSizingHintsFile(): '%s' is not a valid sizing hints file, ignoring it", InFilename);
+		return;
+	}
+
+	qsort(HintFunctions, NumFunctions, sizeof(SizingHintsFunction_t), CompareHintFunctions);  // it should already be sorted, but don't count on it
+
+	NumHintModules = NumModules;
+	NumHintFunctions = NumFunctions;
+
+	DebugLog("ReadSizingHintsFile(): Read hints for %d functions in %d modules from '%s'", NumHintFunctions, NumHintModules, InFilename);
+}
+
+void WriteSizingHintsFile(const char* InFilename)
+{
+	if( (gModuleTable == nullptr) || (ThreadIdHashTable == nullptr) || (InFilename == nullptr) || (InFilename[0] == 0) )
+	{
+		return;
+	}
+
+	FlushAllEdgeLogs();  // (the parent and children counts come from the hash tables)
+
+	CAllocator HintsAllocator;
+
+	// gather the maximum counts for each function from every thread
+	CHash<SizingHintsRecord_t, FunctionKey_t> HintsHashTable(&HintsAllocator, FUNCTION_HASH_TABLE_SIZE);
+
+	for( int i = 0; i < ThreadIdHashTable->HashTableSize; i++ )
+	{
+		CHash<CThreadIdRecord>::Hash_t* p = (CHash<CThreadIdRecord>::Hash_t*)ThreadIdHashTable->HashTable[i];
+		while( p )
+		{
+			CThreadIdRecord* ThreadIdRec = p->value;
+
+			if( ThreadIdRec && ThreadIdRec->EntryFunction )
+			{
+				DWORD NumCallTreeRecords = 0;
+
+				for( int PhaseIndex = 0; PhaseIndex < NumPhases; PhaseIndex++ )
+				{
+					CHash<CCallTreeRecord, FunctionKey_t>* PhaseHashTable = ThreadIdRec->PhaseCallTreeHashTables[PhaseIndex];
+
+					if( PhaseHashTable == nullptr )
+					{
+						continue;
+					}
+
+					NumCallTreeRecords = max(NumCallTreeRecords, (DWORD)PhaseHashTable->NumTotalRecords);
+
+					for( int j = 0; j < PhaseHashTable->HashTableSize; j++ )
+					{
+						CHash<CCallTreeRecord, FunctionKey_t>::Hash_t* pCallTree = (CHash<CCallTreeRecord, FunctionKey_t>::Hash_t*)PhaseHashTable->HashTable[j];
+						while( pCallTree )
+						{
+							CCallTreeRecord* CallTreeRec = pCallTree->value;
+
+							if( CallTreeRec && (CallTreeRec->Cold->ParentHashTable || CallTreeRec->Cold->ChildrenHashTable) )
+							{
+								SizingHintsRecord_t** pHintsRecPtr = HintsHashTable.LookupPointer(CallTreeRec->Cold->Function->FunctionKey);
+								if( *pHintsRecPtr == nullptr )
+								{
+									*pHintsRecPtr = (SizingHintsRecord_t*)HintsAllocator.AllocateBytes(sizeof(SizingHintsRecord_t), sizeof(void*));  // memory is zeroed
+									(*pHintsRecPtr)->Function = CallTreeRec->Cold->Function;
+								}
+
+								SizingHintsFunction_t& Hints = (*pHintsRecPtr)->Hints;
+
+								if( CallTreeRec->Cold->ParentHashTable )
+								{
+									Hints.NumParents = max(Hints.NumParents, (DWORD)CallTreeRec->Cold->ParentHashTable->NumTotalRecords);
+								}
+
+								if( CallTreeRec->Cold->ChildrenHashTable )
+								{
+									Hints.NumChildren = max(Hints.NumChildren, (DWORD)CallTreeRec->Cold->ChildrenHashTable->NumTotalRecords);
+								}
+							}
+
+							pCallTree = pCallTree->Next;
+						}
+					}
+				}
+
+				SizingHintsRecord_t** pHintsRecPtr = HintsHashTable.LookupPointer(ThreadIdRec->EntryFunction->FunctionKey);
+				if( *pHintsRecPtr == nullptr )
+				{
+					*pHintsRecPtr = (SizingHintsRecord_t*)HintsAllocator.AllocateBytes(sizeof(SizingHintsRecord_t), sizeof(void*));
+					(*pHintsRecPtr)->Function = ThreadIdRec->EntryFunction;
+				}
+
+				SizingHintsFunction_t& Hints = (*pHintsRecPtr)->Hints;
+
+				size_t TotalSize, FreeSize;
+
+				Hints.NumCallTreeRecords = max(Hints.NumCallTreeRecords, NumCallTreeRecords);
+
+				ThreadIdRec->ThreadIdRecordAllocator->GetAllocationStats(TotalSize, FreeSize);
+				Hints.ThreadIdRecordBytes = max(Hints.ThreadIdRecordBytes, (DWORD)min(TotalSize - FreeSize, MAX_SIZING_HINT_BYTES));
+
+				ThreadIdRec->CallTreeRecordAllocator->GetAllocationStats(TotalSize, FreeSize);
+				Hints.CallTreeRecordBytes = max(Hints.CallTreeRecordBytes, (DWORD)min(TotalSize - FreeSize, MAX_SIZING_HINT_BYTES));
+			}
+
+			p = p->Next;
+		}
+	}
+
+	// the modules in the file are the (non-dynamic) modules in the module table, FileModuleIndex maps from one to the other
+	int NumModules = gModuleTable->GetNumModules();
+	int* FileModuleIndex = (int*)HintsAllocator.AllocateBytes((NumModules + 1) * sizeof(int), sizeof(int));
+	int NumFileModules = 0;
+
+	for( int index = 0; index < NumModules; index++ )
+	{
+		FileModuleIndex[index] = gModuleTable->GetModule(index)->bIsDynamic ? -1 : NumFileModules++;
+	}
+
+	// make a sorted array of the function hints
+	int NumFunctions = 0;
+	SizingHintsFunction_t* Functions = (SizingHintsFunction_t*)HintsAllocator.AllocateBytes((HintsHashTable.NumTotalRecords + 1) * sizeof(SizingHintsFunction_t), sizeof(void*));
+
+	for( int i = 0; i < HintsHashTable.HashTableSize; i++ )
+	{
+		CHash<SizingHintsRecord_t, FunctionKey_t>::Hash_t* p = (CHash<SizingHintsRecord_t, FunctionKey_t>::Hash_t*)HintsHashTable.HashTable[i];
+		while( p )
+		{
+			CFunctionRecord* Function = p->value->Function;
+
+			if( Function->Module && (FileModuleIndex[Function->Module->Index] >= 0) )
+			{
+				SizingHintsFunction_t& Hints = Functions[NumFunctions++];
+
+				Hints = p->value->Hints;
+				Hints.ModuleIndex = FileModuleIndex[Function->Module->Index];
+				Hints.Offset = Function->Offset;
+			}
+
+			p = p->Next;
+		}
+	}
+
+	qsort(Functions, NumFunctions, sizeof(SizingHintsFunction_t), CompareHintFunctions);
+
+	HANDLE hFile = CreateFileA(InFilename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		DebugLog("WriteSizingHintsFile(): Failed to create '%s' (error = %d)", InFilename, GetLastError());
+
+		HintsAllocator.FreeBlocks();
+		return;
+	}
+
+	bool bSuccess = WriteBytes(hFile, SIZING_HINTS_FILE_MAGIC, 8) && WriteBytes(hFile, &NumFileModules, sizeof(int));
+
+	for( int index = 0; bSuccess && (index < NumModules); index++ )
+	{
+		ModuleRecord_t* Module = gModuleTable->GetModule(index);
+
+		if( FileModuleIndex[index] >= 0 )
+		{
+			int NameLength = (int)strlen(Module->Name);
+			DWORD ImageSize = (DWORD)Module->Size;
+
+			bSuccess = WriteBytes(hFile, &NameLength, sizeof(int)) && WriteBytes(hFile, Module->Name, NameLength) &&
+				WriteBytes(hFile, &ImageSize, sizeof(DWORD)) && WriteBytes(hFile, &Module->TimeDateStamp, sizeof(DWORD));
+		}
+	}
+
+	bSuccess = bSuccess && WriteBytes(hFile, &NumFunctions, sizeof(int)) && WriteBytes(hFile, Functions, NumFunctions * sizeof(SizingHintsFunction_t));
+
+	CloseHandle(hFile);
+
+	if( !bSuccess )
+	{
+		DebugLog("WriteSizingHintsFile(): Error writing '%s' (error = %d)", InFilename, GetLastError());
+	}
+	else
+	{
+		DebugLog("WriteSizingHintsFile(): Wrote hints for %d functions in %d modules to '%s'", NumFunctions, NumFileModules, InFilename);
+	}
+
+	HintsAllocator.FreeBlocks();
+}
+
+void ApplyThreadSizingHints(CThreadIdRecord* InThreadIdRecord, CFunctionRecord* InEntryFunction)
+{
+	SizingHintsFunction_t* Hints = FindHintFunction(InEntryFunction);
+
+	if( (Hints == nullptr) || (Hints->NumCallTreeRecords == 0) )
+	{
+		return;
+	}
+
+	int CallTreeHashTableSize = GetHashTableSizeForRecords(min(Hints->NumCallTreeRecords, MAX_SIZING_HINT_RECORDS), CALLRECORD_HASH_TABLE_SIZE);
+
+	InThreadIdRecord->ApplySizingHints(CallTreeHashTableSize, min(Hints->ThreadIdRecordBytes, MAX_SIZING_HINT_BYTES), min(Hints->CallTreeRecordBytes, MAX_SIZING_HINT_BYTES));
+}
+
+int GetParentHashTableSize(CFunctionRecord* InFunction, int InDefaultSize)
+{
+	SizingHintsFunction_t* Hints = FindHintFunction(InFunction);
+
+	return Hints ? GetHashTableSizeForRecords(min(Hints->NumParents, MAX_SIZING_HINT_RECORDS), InDefaultSize) : InDefaultSize;
+}
+
+int GetChildrenHashTableSize(CFunctionRecord* InFunction, int InDefaultSize)
+{
+	SizingHintsFunction_t* Hints = FindHintFunction(InFunction);
+
+	return Hints ? GetHashTableSizeForRecords(min(Hints->NumChildren, MAX_SIZING_HINT_RECORDS), InDefaultSize) : InDefaultSize;
+}
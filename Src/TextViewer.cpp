@@ -1,10 +1,13 @@
 
 #include "windows.h"
 #include "Allocator.h"
+#include "Dialog.h"
+#include "Sampler.h"
 #include "TextViewer.h"
 
 CAllocator TextViewerAllocator;
-TextLineBuffer line_buffer = { nullptr, 0, 0, 0 };
+CAllocator LineSamplesAllocator;  // the copy of the function's line samples (only needed while they're added up)
+TextLineBuffer line_buffer = { nullptr, 0, 0, 0, nullptr, 0 };
 
 char* TextViewer_FileBuffer = nullptr;
 char TextViewerFileName[MAX_PATH] = {""};  // the most recent file loaded into the text viewer
@@ -102,6 +105,9 @@ void LoadTextFile(char* filename)
 
 	TextViewerAllocator.FreeBlocks();  // free all the memory allocated by the TextViewerAllocator
 
+	line_buffer.line_samples = nullptr;  // (this was allocated from the TextViewerAllocator)
+	line_buffer.max_line_samples = 0;
+
 	strncpy_s(TextViewerFileName, filename, MAX_PATH);
 
 	size_t wNumChars = 0;
@@ -128,3 +134,48 @@ void LoadTextFile(char* filename)
 		InitializeTextLineBuffer(TextViewer_FileBuffer, length);
 	}
 }
+
+void LoadTextLineSamples(CFunctionRecord* InFunction)
+{
+	LineSample_t* LineSamples = nullptr;
+	int NumLineSamples = CopyLineSamples(InFunction, &LineSamplesAllocator, LineSamples);
+
+	if( (NumLineSamples == 0) || (line_buffer.num_lines == 0) )
+	{
+		if( line_buffer.line_samples )
+		{
+			memset(line_buffer.line_samples, 0, line_buffer.num_lines * sizeof(int));
+		}
+
+		line_buffer.max_line_samples = 0;
+
+		LineSamplesAllocator.FreeBlocks();
+		return;
+	}
+
+	if( line_buffer.line_samples == nullptr )  // (allocated once for each file that's loaded)
+	{
+		line_buffer.line_samples = (int*)TextViewerAllocator.AllocateBytes(line_buffer.num_lines * sizeof(int), sizeof(int));
+	}
+
+	memset(line_buffer.line_samples, 0, line_buffer.num_lines * sizeof(int));
+	line_buffer.max_line_samples = 0;
+
+	for( int index = 0; index < NumLineSamples; index++ )
+	{
+		int LineNumber = 0;
+		char FileName[MAX_PATH];
+		FileName[0] = 0;
+
+		GetSourceCodeLineFromAddress((DWORD64)LineSamples[index].Address, LineNumber, FileName, MAX_PATH);
+
+		// samples in code from a different file (inlined from a header, for example) aren't shown
+		if( (LineNumber > 0) && (LineNumber <= line_buffer.num_lines) && (_stricmp(FileName, TextViewerFileName) == 0) )
+		{
+			line_buffer.line_samples[LineNumber - 1] += LineSamples[index].Samples;
+			line_buffer.max_line_samples = max(line_buffer.max_line_samples, line_buffer.line_samples[LineNumber - 1]);
+		}
+	}
+
+	LineSamplesAllocator.FreeBlocks();
+}
@@ -0,0 +1,494 @@
+#include "targetver.h"
+
+#define WIN32_LEAN_AND_MEAN  // Exclude rarely-used stuff from Windows headers
+// Windows Header Files:
+#include <Windows.h>
+
+#include "Dialog.h"
+#include "Config.h"
+#include "ThreadGroups.h"
+
+extern CAllocator DialogAllocator;
+
+DialogCallTreeRecord_t* FindCallTreeRecord_BinarySearch(const DialogThreadIdRecord_t* ThreadRec, const void* InAddress);
+int SortCallTreeHashTableCopy(const void* arg1, const void* arg2);
+
+typedef HRESULT (WINAPI *GetThreadDescriptionFunc)(HANDLE hThread, PWSTR* ppszThreadDescription);  // (Windows 10 version 1607 or later)
+
+struct ThreadGroup_t
+{
+	char Name[THREAD_GROUP_NAME_SIZE];
+	bool bIsPrefixGroup;  // grouped by thread name prefix (otherwise by entry function)
+
+	DWORD Id;  // (see GetThreadGroupId())
+
+	DialogThreadIdRecord_t** Threads;  // the threads in this group
+	unsigned int NumThreads;
+
+	CAllocator* Allocator;  // each group has its own allocator (since the groups are merged at the same time)
+	DialogThreadIdRecord_t* Record;  // the combined data for the group (made by MergeThreadGroup())
+};
+
+static ThreadGroup_t* ThreadGroups = nullptr;  // (allocated from the DialogAllocator)
+static int NumThreadGroups = 0;
+
+struct ThreadGroupId_t  // a group that has been given an id (the index in ThreadGroupIds is the id)
+{
+	char* Name;
+	bool bIsPrefixGroup;
+};
+
+static CAllocator ThreadGroupIdAllocator;  // (never freed, the ids are kept for every capture)
+static ThreadGroupId_t* ThreadGroupIds = nullptr;
+static int NumThreadGroupIds = 0;
+static int MaxThreadGroupIds = 0;
+
+
+static DWORD GetThreadGroupId(const char* InName, bool bInIsPrefixGroup)  // the same group gets the same id in every capture (so it stays selected)
+{
+	for( int index = 0; index < NumThreadGroupIds; index++ )
+	{
+		if( (ThreadGroupIds[index].bIsPrefixGroup == bInIsPrefixGroup) && (strcmp(ThreadGroupIds[index].Name, InName) == 0) )
+		{
+			return THREAD_GROUP_ID_BASE + index;
+		}
+	}
+
+	if( NumThreadGroupIds == MaxThreadGroupIds )  // grow the array (the old one is just left in the allocator)
+	{
+		int NewMaxThreadGroupIds = max(MaxThreadGroupIds * 2, 64);
+
+		ThreadGroupId_t* NewThreadGroupIds = (ThreadGroupId_t*)ThreadGroupIdAllocator.AllocateBytes(NewMaxThreadGroupIds * sizeof(ThreadGroupId_t), sizeof(void*));
+		if( ThreadGroupIds )
+		{
+			memcpy(NewThreadGroupIds, ThreadGroupIds, NumThreadGroupIds * sizeof(ThreadGroupId_t));
+		}
+
+		ThreadGroupIds = NewThreadGroupIds;
+		MaxThreadGroupIds = NewMaxThreadGroupIds;
+	}
+
+	size_t NameSize = strlen(InName) + 1;
+
+	ThreadGroupId_t& NewId = ThreadGroupIds[NumThreadGroupIds];
+	NewId.Name = (char*)ThreadGroupIdAllocator.AllocateBytes(NameSize, 1);
+	memcpy(NewId.Name, InName, NameSize);
+	NewId.bIsPrefixGroup = bInIsPrefixGroup;
+
+	return THREAD_GROUP_ID_BASE + NumThreadGroupIds++;
+}
+
+// Get the name of the group the thread belongs to.  If the thread's name starts with one of the prefixes (separated by ';') the
+// thread goes in the group for that prefix, otherwise it goes in the group for its entry function.
+static bool GetThreadGroupName(const DialogThreadIdRecord_t* InThreadRec, const char* InPrefixes, GetThreadDescriptionFunc InGetThreadDescription, char* OutName, size_t OutNameSize, bool& bOutIsPrefixGroup)
+{
+	bOutIsPrefixGroup = false;
+
+	HANDLE ThreadHandle = (InPrefixes && InPrefixes[0] && InGetThreadDescription && InThreadRec->ThreadIdRecord) ? InThreadRec->ThreadIdRecord->TakeThreadHandle() : nullptr;
+
+	if( ThreadHandle )  // (null once the thread has exited)
+	{
+		PWSTR wDescription = nullptr;
+
+		HRESULT Result = InGetThreadDescription(ThreadHandle, &wDescription);
+		InThreadRec->ThreadIdRecord->ReturnThreadHandle(ThreadHandle);
+
+		if( SUCCEEDED(Result) && wDescription )
+		{
+			char Description[THREAD_GROUP_NAME_SIZE];
+			size_t num_chars;
+			wcstombs_s(&num_chars, Description, sizeof(Description), wDescription, _TRUNCATE);
+
+			LocalFree(wDescription);
+
+			for( const char* Prefix = InPrefixes; *Prefix; )
+			{
+				const char* PrefixEnd = strchr(Prefix, ';');
+				size_t PrefixLen = PrefixEnd ? (size_t)(PrefixEnd - Prefix) : strlen(Prefix);
+
+				if( (PrefixLen > 0) && (strncmp(Description, Prefix, PrefixLen) == 0) )
+				{
+					strncpy_s(OutName, OutNameSize, Prefix, min(PrefixLen, OutNameSize - 1));
+					bOutIsPrefixGroup = true;
+					return true;
+				}
+
+				Prefix += PrefixLen + (PrefixEnd ? 1 : 0);
+			}
+		}
+	}
+
+	if( InThreadRec->SymbolName == nullptr )
+	{
+		return false;
+	}
+
+	strncpy_s(OutName, OutNameSize, InThreadRec->SymbolName, _TRUNCATE);
+	return true;
+}
+
+static void MergeCallTreeRecord(DialogCallTreeRecord_t* Dest, const DialogCallTreeRecord_t* Src)  // add Src's counters to Dest
+{
+	Dest->CallDurationInclusiveTimeSum += Src->CallDurationInclusiveTimeSum;
+	Dest->CallDurationExclusiveTimeSum += Src->CallDurationExclusiveTimeSum;
+	Dest->MaxCallDurationExclusiveTime = max(Dest->MaxCallDurationExclusiveTime, Src->MaxCallDurationExclusiveTime);
+	Dest->CurrentChildrenInclusiveTime += Src->CurrentChildrenInclusiveTime;
+
+	// the call rates of the threads add up, the burstiness is the average weighted by the number of calls
+	if( (Dest->CallCount + Src->CallCount) > 0 )
+	{
+		Dest->Burstiness = (float)(((double)Dest->Burstiness * Dest->CallCount + (double)Src->Burstiness * Src->CallCount) / (double)(Dest->CallCount + Src->CallCount));
+	}
+	Dest->CallsPerSecond += Src->CallsPerSecond;
+
+	Dest->CallCount += Src->CallCount;
+	Dest->MaxRecursionLevel = max(Dest->MaxRecursionLevel, Src->MaxRecursionLevel);
+
+	for( int Bucket = 0; Bucket < INTERVAL_HISTOGRAM_BUCKETS; Bucket++ )
+	{
+		Dest->IntervalHistogram[Bucket] += Src->IntervalHistogram[Bucket];
+		Dest->DurationHistogram[Bucket] += Src->DurationHistogram[Bucket];
+	}
+
+	Dest->Outliers.Merge(Src->Outliers);
+
+	Dest->SelfTimeSum += Src->SelfTimeSum;
+	Dest->ExternalTimeSum += Src->ExternalTimeSum;
+	Dest->SelfSamples += Src->SelfSamples;
+	Dest->ExternalSamples += Src->ExternalSamples;
+
+	Dest->FaultMeasuredCalls += Src->FaultMeasuredCalls;
+	Dest->ProcessPageFaults += Src->ProcessPageFaults;
+	Dest->OffCpuTime += Src->OffCpuTime;
+
+	for( int Column = 0; (Column < CAeonPlugin::NumColumns) && Dest->PluginColumnValues && Src->PluginColumnValues; Column++ )
+	{
+		Dest->PluginColumnValues[Column] += Src->PluginColumnValues[Column];
+	}
+}
+
+// Make the group's array of parents (or children) from the member records' arrays (these point to the member thread's records,
+// so they are looked up by address in the group's CallTreeArray).  Returns the number of unique records.
+static unsigned int MergeRelatedRecords(CAllocator* InAllocator, const DialogThreadIdRecord_t* InGroupRec, DialogCallTreeRecord_t** InMembers, unsigned int InNumMembers, bool bParents, void**& OutArray)
+{
+	unsigned int NumRelated = 0;
+	for( unsigned int index = 0; index < InNumMembers; index++ )
+	{
+		NumRelated += bParents ? InMembers[index]->ParentArraySize : InMembers[index]->ChildrenArraySize;
+	}
+
+	OutArray = nullptr;
+
+	if( NumRelated == 0 )
+	{
+		return 0;
+	}
+
+	OutArray = (void**)InAllocator->AllocateBytes(NumRelated * sizeof(void*), sizeof(void*));
+
+	unsigned int NumFound = 0;
+	for( unsigned int index = 0; index < InNumMembers; index++ )
+	{
+		void** MemberArray = bParents ? InMembers[index]->ParentArray : InMembers[index]->ChildrenArray;
+		unsigned int MemberArraySize = bParents ? InMembers[index]->ParentArraySize : InMembers[index]->ChildrenArraySize;
+
+		for( unsigned int related = 0; related < MemberArraySize; related++ )
+		{
+			DialogCallTreeRecord_t* MemberRelatedRec = (DialogCallTreeRecord_t*)MemberArray[related];
+			DialogCallTreeRecord_t* GroupRelatedRec = MemberRelatedRec ? FindCallTreeRecord_BinarySearch(InGroupRec, MemberRelatedRec->Address) : nullptr;
+
+			if( GroupRelatedRec )
+			{
+				OutArray[NumFound++] = GroupRelatedRec;
+			}
+		}
+	}
+
+	// the same parent (or child) can come from several threads, so sort the array and remove the duplicates
+	qsort(OutArray, NumFound, sizeof(void*), SortCallTreeHashTableCopy);
+
+	unsigned int NumUnique = 0;
+	for( unsigned int index = 0; index < NumFound; index++ )
+	{
+		if( (NumUnique == 0) || (OutArray[NumUnique - 1] != OutArray[index]) )
+		{
+			OutArray[NumUnique++] = OutArray[index];
+		}
+	}
+
+	return NumUnique;
+}
+
+static void CALLBACK MergeThreadGroup(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)  // make the combined data for one thread group
+{
+	ThreadGroup_t& Group = *(ThreadGroup_t*)Context;
+	CAllocator* Allocator = Group.Allocator;
+
+	DialogThreadIdRecord_t* GroupRec = (DialogThreadIdRecord_t*)Allocator->AllocateBytes(sizeof(DialogThreadIdRecord_t), sizeof(void*));
+	memset(GroupRec, 0, sizeof(DialogThreadIdRecord_t));
+
+	GroupRec->ThreadId = Group.Id;
+	GroupRec->NumGroupThreads = Group.NumThreads;
+	GroupRec->Address = Group.Threads[0]->Address;
+
+	char GroupSymbolName[THREAD_GROUP_NAME_SIZE + 32];
+	sprintf_s(GroupSymbolName, sizeof(GroupSymbolName), "%s [%s]", Group.Name, Group.bIsPrefixGroup ? "thread name" : "entry function");
+
+	size_t length = strlen(GroupSymbolName);
+	GroupRec->SymbolName = (char*)Allocator->AllocateBytes(length + 1, 1);
+	strcpy_s(GroupRec->SymbolName, length + 1, GroupSymbolName);
+
+	// combine the threads' activity (the group's timeline is the average of the threads, so a fully busy group shows as fully busy)
+	GroupRec->Activity = (ThreadActivity_t*)Allocator->AllocateBytes(sizeof(ThreadActivity_t), sizeof(__int64));
+	memset(GroupRec->Activity, 0, sizeof(ThreadActivity_t));
+
+	ThreadActivity_t& Activity = *GroupRec->Activity;
+	Activity = *Group.Threads[0]->Activity;
+	Activity.Timeline.Reset();
+
+	for( unsigned int index = 0; index < Group.NumThreads; index++ )
+	{
+		const ThreadActivity_t& ThreadActivity = *Group.Threads[index]->Activity;
+
+		Activity.CreateTime = min(Activity.CreateTime, ThreadActivity.CreateTime);
+		Activity.FirstCallTime = min(Activity.FirstCallTime, ThreadActivity.FirstCallTime);
+		Activity.LastActivityTime = max(Activity.LastActivityTime, ThreadActivity.LastActivityTime);
+		Activity.ExitTime = ((Activity.ExitTime < 0) || (ThreadActivity.ExitTime < 0)) ? -1 : max(Activity.ExitTime, ThreadActivity.ExitTime);  // (running until every thread has exited)
+
+		Activity.Timeline.AddTimeline(ThreadActivity.Timeline);
+	}
+
+	for( int Bucket = 0; Bucket < ACTIVITY_TIMELINE_BUCKETS; Bucket++ )
+	{
+		Activity.Timeline.BusyTime[Bucket] /= Group.NumThreads;
+	}
+	Activity.Timeline.BusyTimeSum /= Group.NumThreads;
+
+	// gather all of the threads' records and sort them by address (so the records for the same function are next to each other)
+	unsigned int NumMemberRecords = 0;
+	for( unsigned int index = 0; index < Group.NumThreads; index++ )
+	{
+		NumMemberRecords += Group.Threads[index]->CallTreeArraySize;
+	}
+
+	if( NumMemberRecords == 0 )
+	{
+		Group.Record = GroupRec;
+		return;
+	}
+
+	DialogCallTreeRecord_t** MemberRecords = (DialogCallTreeRecord_t**)Allocator->AllocateBytes(NumMemberRecords * sizeof(void*), sizeof(void*));
+	unsigned int* FirstMemberIndex = (unsigned int*)Allocator->AllocateBytes((NumMemberRecords + 1) * sizeof(unsigned int), sizeof(unsigned int));  // (for each group record)
+
+	unsigned int MemberIndex = 0;
+	for( unsigned int index = 0; index < Group.NumThreads; index++ )
+	{
+		for( unsigned int CallRecordIndex = 0; CallRecordIndex < Group.Threads[index]->CallTreeArraySize; CallRecordIndex++ )
+		{
+			MemberRecords[MemberIndex++] = (DialogCallTreeRecord_t*)Group.Threads[index]->CallTreeArray[CallRecordIndex];
+		}
+	}
+
+	qsort(MemberRecords, NumMemberRecords, sizeof(void*), SortCallTreeHashTableCopy);
+
+	GroupRec->CallTreeArray = (void**)Allocator->AllocateBytes(NumMemberRecords * sizeof(void*), sizeof(void*));
+	GroupRec->CallTreeArraySize = 0;
+
+	for( MemberIndex = 0; MemberIndex < NumMemberRecords; MemberIndex++ )
+	{
+		DialogCallTreeRecord_t* MemberRec = MemberRecords[MemberIndex];
+
+		if( (GroupRec->CallTreeArraySize > 0) && (((DialogCallTreeRecord_t*)GroupRec->CallTreeArray[GroupRec->CallTreeArraySize - 1])->Address == MemberRec->Address) )
+		{
+			MergeCallTreeRecord((DialogCallTreeRecord_t*)GroupRec->CallTreeArray[GroupRec->CallTreeArraySize - 1], MemberRec);
+			continue;
+		}
+
+		DialogCallTreeRecord_t* GroupCallTreeRec = (DialogCallTreeRecord_t*)Allocator->AllocateBytes(sizeof(DialogCallTreeRecord_t), sizeof(void*));
+		*GroupCallTreeRec = *MemberRec;
+
+		GroupCallTreeRec->EnterTime = 0;
+		GroupCallTreeRec->StackDepth = 0;
+
+		if( MemberRec->PluginColumnValues )
+		{
+			GroupCallTreeRec->PluginColumnValues = (__int64*)Allocator->AllocateBytes((CAeonPlugin::NumColumns + 1) * sizeof(__int64), sizeof(__int64));
+			memcpy(GroupCallTreeRec->PluginColumnValues, MemberRec->PluginColumnValues, CAeonPlugin::NumColumns * sizeof(__int64));
+		}
+
+		FirstMemberIndex[GroupRec->CallTreeArraySize] = MemberIndex;
+		GroupRec->CallTreeArray[GroupRec->CallTreeArraySize++] = GroupCallTreeRec;
+	}
+
+	FirstMemberIndex[GroupRec->CallTreeArraySize] = NumMemberRecords;
+
+	// now that all of the group's records exist, combine the parents and children and recalculate the shape of the call times
+	for( unsigned int index = 0; index < GroupRec->CallTreeArraySize; index++ )
+	{
+		DialogCallTreeRecord_t* GroupCallTreeRec = (DialogCallTreeRecord_t*)GroupRec->CallTreeArray[index];
+
+		DialogCallTreeRecord_t** Members = &MemberRecords[FirstMemberIndex[index]];
+		unsigned int NumMembers = FirstMemberIndex[index + 1] - FirstMemberIndex[index];
+
+		GroupCallTreeRec->ParentArraySize = MergeRelatedRecords(Allocator, GroupRec, Members, NumMembers, true, GroupCallTreeRec->ParentArray);
+		GroupCallTreeRec->ChildrenArraySize = MergeRelatedRecords(Allocator, GroupRec, Members, NumMembers, false, GroupCallTreeRec->ChildrenArray);
+
+		GetDurationShape(GroupCallTreeRec->DurationHistogram, GroupCallTreeRec->Shape);
+	}
+
+	GroupRec->Columns = BuildCallTreeColumns(Allocator, GroupRec);
+
+	Group.Record = GroupRec;
+}
+
+void BuildThreadGroups()
+{
+	FreeThreadGroups();
+
+	if( (CaptureCallTreeThreadArrayPointer == nullptr) || (CaptureCallTreeThreadArraySize == 0) )
+	{
+		return;
+	}
+
+	const char* Prefixes = GetProfilerOptionString(OPTION_THREAD_GROUP_PREFIXES);
+	GetThreadDescriptionFunc pGetThreadDescription = (GetThreadDescriptionFunc)GetProcAddress(GetModuleHandle(TEXT("kernel32.dll")), "GetThreadDescription");
+
+	unsigned int NumCapturedThreads = CaptureCallTreeThreadArraySize;
+
+	ThreadGroups = (ThreadGroup_t*)DialogAllocator.AllocateBytes(NumCapturedThreads * sizeof(ThreadGroup_t), sizeof(void*));
+	DialogThreadIdRecord_t** GroupThreads = (DialogThreadIdRecord_t**)DialogAllocator.AllocateBytes(NumCapturedThreads * sizeof(void*), sizeof(void*));
+	int* ThreadGroupIndex = (int*)DialogAllocator.AllocateBytes(NumCapturedThreads * sizeof(int), sizeof(int));
+
+	int NumGroups = 0;
+
+	// find the group for each thread...
+	for( unsigned int ThreadIndex = 0; ThreadIndex < NumCapturedThreads; ThreadIndex++ )
+	{
+		DialogThreadIdRecord_t* ThreadRec = (DialogThreadIdRecord_t*)CaptureCallTreeThreadArrayPointer[ThreadIndex];
+
+		char Name[THREAD_GROUP_NAME_SIZE];
+		bool bIsPrefixGroup;
+
+		ThreadGroupIndex[ThreadIndex] = -1;
+
+		if( (ThreadRec == nullptr) || (ThreadRec->NumGroupThreads > 0) || !GetThreadGroupName(ThreadRec, Prefixes, pGetThreadDescription, Name, sizeof(Name), bIsPrefixGroup) )
+		{
+			continue;
+		}
+
+		int GroupIndex = 0;
+		while( (GroupIndex < NumGroups) && ((ThreadGroups[GroupIndex].bIsPrefixGroup != bIsPrefixGroup) || (strcmp(ThreadGroups[GroupIndex].Name, Name) != 0)) )
+		{
+			GroupIndex++;
+		}
+
+		if( GroupIndex == NumGroups )
+		{
+			ThreadGroup_t& NewGroup = ThreadGroups[NumGroups++];
+			memset(&NewGroup, 0, sizeof(ThreadGroup_t));
+
+			strcpy_s(NewGroup.Name, sizeof(NewGroup.Name), Name);
+			NewGroup.bIsPrefixGroup = bIsPrefixGroup;
+		}
+
+		ThreadGroups[GroupIndex].NumThreads++;
+		ThreadGroupIndex[ThreadIndex] = GroupIndex;
+	}
+
+	// ...then drop the entry function groups that only have one thread and hand out the thread arrays
+	NumThreadGroups = 0;
+	unsigned int NumGroupThreads = 0;
+
+	for( int GroupIndex = 0; GroupIndex < NumGroups; GroupIndex++ )
+	{
+		ThreadGroup_t& Group = ThreadGroups[GroupIndex];
+
+		if( !Group.bIsPrefixGroup && (Group.NumThreads < MIN_ENTRY_FUNCTION_GROUP_THREADS) )
+		{
+			Group.Threads = nullptr;
+			continue;
+		}
+
+		Group.Threads = &GroupThreads[NumGroupThreads];
+		NumGroupThreads += Group.NumThreads;
+		Group.NumThreads = 0;
+
+		Group.Allocator = (CAllocator*)DialogAllocator.AllocateBytes(sizeof(CAllocator), sizeof(void*));
+		new(Group.Allocator) CAllocator();
+	}
+
+	for( unsigned int ThreadIndex = 0; ThreadIndex < NumCapturedThreads; ThreadIndex++ )
+	{
+		if( (ThreadGroupIndex[ThreadIndex] >= 0) && ThreadGroups[ThreadGroupIndex[ThreadIndex]].Threads )
+		{
+			ThreadGroup_t& Group = ThreadGroups[ThreadGroupIndex[ThreadIndex]];
+			Group.Threads[Group.NumThreads++] = (DialogThreadIdRecord_t*)CaptureCallTreeThreadArrayPointer[ThreadIndex];
+		}
+	}
+
+	for( int GroupIndex = 0; GroupIndex < NumGroups; GroupIndex++ )  // pack the groups we're keeping at the start of the array
+	{
+		if( ThreadGroups[GroupIndex].Threads )
+		{
+			ThreadGroups[GroupIndex].Id = GetThreadGroupId(ThreadGroups[GroupIndex].Name, ThreadGroups[GroupIndex].bIsPrefixGroup);  // (before the merges start, they run on other threads)
+			ThreadGroups[NumThreadGroups++] = ThreadGroups[GroupIndex];
+		}
+	}
+
+	if( NumThreadGroups == 0 )
+	{
+		return;
+	}
+
+	// merge each group on a thread pool thread (the groups don't share any memory that gets written to, each has its own allocator)
+	PTP_WORK* MergeWork = (PTP_WORK*)DialogAllocator.AllocateBytes(NumThreadGroups * sizeof(PTP_WORK), sizeof(void*));
+
+	for( int GroupIndex = 0; GroupIndex < NumThreadGroups; GroupIndex++ )
+	{
+		MergeWork[GroupIndex] = CreateThreadpoolWork(MergeThreadGroup, &ThreadGroups[GroupIndex], NULL);
+
+		if( MergeWork[GroupIndex] )
+		{
+			SubmitThreadpoolWork(MergeWork[GroupIndex]);
+		}
+		else
+		{
+			MergeThreadGroup(NULL, &ThreadGroups[GroupIndex], NULL);  // couldn't create the work item, do it on this thread
+		}
+	}
+
+	for( int GroupIndex = 0; GroupIndex < NumThreadGroups; GroupIndex++ )
+	{
+		if( MergeWork[GroupIndex] )
+		{
+			WaitForThreadpoolWorkCallbacks(MergeWork[GroupIndex], FALSE);
+			CloseThreadpoolWork(MergeWork[GroupIndex]);
+		}
+	}
+
+	// add the groups to the end of the thread array (so they can be selected like a thread)
+	void** NewThreadArray = (void**)DialogAllocator.AllocateBytes((NumCapturedThreads + NumThreadGroups) * sizeof(void*), sizeof(void*));
+	memcpy(NewThreadArray, CaptureCallTreeThreadArrayPointer, NumCapturedThreads * sizeof(void*));
+
+	for( int GroupIndex = 0; GroupIndex < NumThreadGroups; GroupIndex++ )
+	{
+		NewThreadArray[NumCapturedThreads + GroupIndex] = ThreadGroups[GroupIndex].Record;
+	}
+
+	CaptureCallTreeThreadArrayPointer = NewThreadArray;
+	CaptureCallTreeThreadArraySize = NumCapturedThreads + NumThreadGroups;
+}
+
+void FreeThreadGroups()
+{
+	for( int GroupIndex = 0; GroupIndex < NumThreadGroups; GroupIndex++ )
+	{
+		if( ThreadGroups[GroupIndex].Allocator )
+		{
+			ThreadGroups[GroupIndex].Allocator->FreeBlocks();
+		}
+	}
+
+	ThreadGroups = nullptr;
+	NumThreadGroups = 0;
+}
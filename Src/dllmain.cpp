@@ -5,6 +5,14 @@
 
 #include "CallerData.h"
 #include "Allocator.h"
+#include "Config.h"
+#include "Coverage.h"
+#include "ModuleTable.h"
+#include "SizingHints.h"
+#include "BlockPool.h"
+#include "Sampler.h"
+#include "FaultCounters.h"
+#include "EdgeLog.h"
 
 extern CAllocator GlobalAllocator;
 extern DWORD DialogCallTreeThreadId;  // the thread id of the thread to display CallTree data for in the ListView dialog
@@ -22,6 +30,9 @@ HANDLE hProcessHandle = nullptr;
 __int64 ClockFreq;  // the frequency of this computers CPU clock
 int TicksPerHundredNanoseconds = 0;  // how many CPU ticks happen in 100 nanoseconds (divide ticks by this and then divide by 10000 to get milliseconds)
 
+DWORD64 ProfilerStartTime = 0;  // the CPU ticks when the DLL was loaded (the thread activity timelines start here)
+ULONGLONG ProfilerStartFileTime = 0;  // the system time when the DLL was loaded (to convert thread creation and exit times)
+
 HANDLE DialogThreadHandle = NULL;
 DWORD DialogThreadID;
 
@@ -39,6 +50,16 @@ void CallerExit(CallerData_t& Call);
 
 void ProfilerEnter(__int64 InCounter, void* InCallerAddress)
 {
+	if( CoverageMode != COVERAGE_MODE_OFF )  // coverage mode doesn't track any call tree data
+	{
+		if( bTrackCallerData )
+		{
+			CoverageEnter(InCallerAddress);
+		}
+
+		return;
+	}
+
 	CallerData_t Call;
 
 	Call.ThreadId = GetCurrentThreadId();
@@ -48,12 +69,34 @@ void ProfilerEnter(__int64 InCounter, void* InCallerAddress)
 
 	if( bTrackCallerData )
 	{
+		volatile LONG* pInProfiler = GetInProfilerFlag();  // (so the sampler ignores this thread while we're updating its records)
+		if( pInProfiler )
+		{
+			*pInProfiler = 1;
+		}
+
 		CallerEnter(Call);
+
+		pInProfiler = GetInProfilerFlag();  // (get it again, the thread's record is created by its first CallerEnter)
+		if( pInProfiler )
+		{
+			*pInProfiler = 0;
+		}
 	}
 }
 
 void ProfilerExit(__int64 InCounter, void* InCallerAddress)
 {
+	if( CoverageMode != COVERAGE_MODE_OFF )  // coverage mode doesn't track any call tree data
+	{
+		if( bTrackCallerData )
+		{
+			CoverageExit(InCallerAddress);
+		}
+
+		return;
+	}
+
 	CallerData_t Call;
 
 	Call.ThreadId = GetCurrentThreadId();
@@ -63,7 +106,18 @@ void ProfilerExit(__int64 InCounter, void* InCallerAddress)
 
 	if( bTrackCallerData )
 	{
+		volatile LONG* pInProfiler = GetInProfilerFlag();
+		if( pInProfiler )
+		{
+			*pInProfiler = 1;
+		}
+
 		CallerExit(Call);
+
+		if( pInProfiler )
+		{
+			*pInProfiler = 0;
+		}
 	}
 }
 
@@ -85,9 +139,39 @@ BOOL APIENTRY DllMain( HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReser
 			DebugLog("***** DLL_PROCESS_ATTACH *****");
 
 			ModuleHandle = hModule;
+
+			ProfilerStartTime = __rdtsc();
+			GetSystemTimeAsFileTime((FILETIME*)&ProfilerStartFileTime);
 			ApplicationProcessId = GetCurrentProcessId();
 			ApplicationThreadId = GetCurrentThreadId();
 
+			ReadProfilerOptions();
+
+			CoverageMode = GetProfilerOptionInt(OPTION_COVERAGE_MODE);
+			if( (CoverageMode < COVERAGE_MODE_OFF) || (CoverageMode > COVERAGE_MODE_PATCH) )
+			{
+				CoverageMode = COVERAGE_MODE_OFF;
+			}
+
+			InitCoverage();
+
+			gModuleTable = (CModuleTable*)GlobalAllocator.AllocateBytes(sizeof(CModuleTable), sizeof(void*));
+			new(gModuleTable) CModuleTable(CoverageMode != COVERAGE_MODE_OFF);
+
+			if( CoverageMode == COVERAGE_MODE_OFF )
+			{
+				ReadSizingHintsFile(GetProfilerOptionString(OPTION_SIZING_HINTS_FILE));
+
+				StartBlockPool(GetProfilerOptionInt(OPTION_BLOCK_POOL_SIZE));
+				GlobalAllocator.SetUseBlockPool(true);  // (function records and their hash table are allocated while handling a call)
+
+				StartSampler(GetProfilerOptionInt(OPTION_EXTERNAL_SAMPLE_INTERVAL), GetProfilerOptionInt(OPTION_LINE_SAMPLES) > 0);
+
+				FaultCounterSampleRate = max(GetProfilerOptionInt(OPTION_FAULT_COUNTER_SAMPLE_RATE), 0);
+
+				bDeferredEdges = (GetProfilerOptionInt(OPTION_DEFERRED_EDGES) > 0);
+			}
+
 			InitializeCriticalSection(&gCriticalSection);
 			SetCriticalSectionSpinCount(&gCriticalSection, 4000);  // 4000 is what the Windows heap manager uses (https://msdn.microsoft.com/en-us/library/windows/desktop/ms686197%28v=vs.85%29.aspx)
 
@@ -104,6 +188,12 @@ BOOL APIENTRY DllMain( HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReser
 			ClockFreq = Counter_Freq * (RDTSC_After - RDTSC_Before) / (Counter_After - Counter_Before);
 			TicksPerHundredNanoseconds = (int)(ClockFreq / 10000000);
 
+			if( FaultCounterSampleRate > 0 )
+			{
+				ThreadCyclesPerHundredNanoseconds = CalibrateThreadCycles(TicksPerHundredNanoseconds);
+				DebugLog("Thread cycles per 100ns: %.2f", ThreadCyclesPerHundredNanoseconds);
+			}
+
 			DialogCallTreeThreadId = ApplicationThreadId;  // get the current thread id (this should be "main()" or "WinMain()")
 
 			// Get the process name that's loading us
@@ -123,6 +213,9 @@ BOOL APIENTRY DllMain( HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReser
 
 			DebugLog("***** DLL_PROCESS_DETACH *****");
 
+			StopSampler();
+			StopBlockPool();
+
 			HandleExit();
 
 			if( DialogThreadHandle )
@@ -137,6 +230,12 @@ BOOL APIENTRY DllMain( HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReser
 
 			DeleteCriticalSection(&gCriticalSection);
 
+			if( gModuleTable )
+			{
+				gModuleTable->~CModuleTable();  // unregisters the module unload notification (the memory was allocated from the GlobalAllocator)
+				gModuleTable = nullptr;
+			}
+
 			if( gDebugLog )
 			{
 				gDebugLog->~CDebugLog();